@@ -0,0 +1,212 @@
+/**
+ * libzt C API example
+ *
+ * Multicast benchmark
+ *
+ * receiver: Joins a multicast group (IPv4 or IPv6) and reports the datagrams
+ * received per second. Run it on any number of nodes.
+ *
+ * sender: Sends datagrams to the group for the given number of seconds, then
+ * sends the same datagrams once to each listed receiver via unicast, as an
+ * application without multicast support would have to. For both methods it
+ * reports datagrams sent per second, copies delivered per second (assuming
+ * every receiver gets every datagram, compare with the receivers' reports) and
+ * the CPU time spent per datagram sent.
+ */
+
+#include "ZeroTierSockets.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DATAGRAM_SIZE 1024
+
+static long long now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static long long cpu_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int join_group(int fd, int family, char* local_addr, char* group_addr)
+{
+    if (family == ZTS_AF_INET) {
+        zts_ip_mreq mreq;
+        memset(&mreq, 0, sizeof(mreq));
+        zts_inet_pton(ZTS_AF_INET, group_addr, &mreq.imr_multiaddr);
+        zts_inet_pton(ZTS_AF_INET, local_addr, &mreq.imr_interface);
+        return zts_bsd_setsockopt(fd, ZTS_IPPROTO_IP, ZTS_IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq));
+    }
+    zts_ipv6_mreq mreq;
+    memset(&mreq, 0, sizeof(mreq));
+    zts_inet_pton(ZTS_AF_INET6, group_addr, &mreq.ipv6mr_multiaddr);
+    return zts_bsd_setsockopt(fd, ZTS_IPPROTO_IPV6, ZTS_IPV6_JOIN_GROUP, &mreq, sizeof(mreq));
+}
+
+static int run_receiver(int family, char* local_addr, char* group_addr, unsigned short port)
+{
+    int fd = zts_bsd_socket(family, ZTS_SOCK_DGRAM, 0);
+    struct zts_sockaddr_storage addr;
+    zts_socklen_t addrlen = sizeof(addr);
+    // Bind to the wildcard address, datagrams are addressed to the group
+    zts_util_ipstr_to_saddr(family == ZTS_AF_INET ? "0.0.0.0" : "::", port, (struct zts_sockaddr*)&addr, &addrlen);
+    if (fd < 0 || zts_bsd_bind(fd, (struct zts_sockaddr*)&addr, addrlen) != ZTS_ERR_OK) {
+        printf("Unable to bind to port %d (zts_errno=%d). Exiting.\n", port, zts_errno);
+        exit(1);
+    }
+    if (join_group(fd, family, local_addr, group_addr) != ZTS_ERR_OK) {
+        printf("Unable to join group %s (zts_errno=%d). Exiting.\n", group_addr, zts_errno);
+        exit(1);
+    }
+    printf("Joined group %s, receiving on port %d\n", group_addr, port);
+    zts_set_recv_timeout(fd, 1, 0);   // Report even when nothing arrives
+    char buf[DATAGRAM_SIZE];
+    long long received = 0, last_report = now_ms();
+    while (1) {
+        if (zts_bsd_recv(fd, buf, sizeof(buf), 0) > 0) {
+            received++;
+        }
+        long long now = now_ms();
+        if (now - last_report >= 1000) {
+            if (received) {
+                printf("%lld datagrams/s\n", received * 1000 / (now - last_report));
+            }
+            received = 0;
+            last_report = now;
+        }
+    }
+    return 0;
+}
+
+static void
+send_for(int fd, struct zts_sockaddr_storage* dests, zts_socklen_t* destlens, int num_dests, int seconds, int copies)
+{
+    char buf[DATAGRAM_SIZE] = { 0 };
+    long long sent = 0, start = now_ms(), cpu_start = cpu_ms();
+    while (now_ms() - start < seconds * 1000LL) {
+        for (int i = 0; i < num_dests; i++) {
+            if (zts_bsd_sendto(fd, buf, sizeof(buf), 0, (struct zts_sockaddr*)&dests[i], destlens[i]) > 0) {
+                sent++;
+            }
+            else {
+                zts_util_delay(1);   // Out of buffers, let the stack drain
+            }
+        }
+    }
+    long long elapsed = now_ms() - start, cpu = cpu_ms() - cpu_start;
+    long long rate = elapsed ? sent * 1000 / elapsed : 0;
+    printf(
+        "  %lld datagrams/s sent, %lld copies/s delivered, %.1f us CPU per datagram\n",
+        rate,
+        rate * copies,
+        sent ? cpu * 1000.0 / sent : 0.0);
+}
+
+static int run_sender(
+    int family,
+    char* local_addr,
+    char* group_addr,
+    unsigned short port,
+    int seconds,
+    char** receivers,
+    int num_receivers)
+{
+    int fd = zts_bsd_socket(family, ZTS_SOCK_DGRAM, 0);
+    struct zts_sockaddr_storage addr;
+    zts_socklen_t addrlen = sizeof(addr);
+    // Binding the source address selects the ZeroTier netif for the group
+    zts_util_ipstr_to_saddr(local_addr, 0, (struct zts_sockaddr*)&addr, &addrlen);
+    if (fd < 0 || zts_bsd_bind(fd, (struct zts_sockaddr*)&addr, addrlen) != ZTS_ERR_OK) {
+        printf("Unable to bind to %s (zts_errno=%d). Exiting.\n", local_addr, zts_errno);
+        exit(1);
+    }
+    if (family == ZTS_AF_INET) {
+        struct zts_in_addr ifaddr;
+        zts_inet_pton(ZTS_AF_INET, local_addr, &ifaddr);
+        zts_bsd_setsockopt(fd, ZTS_IPPROTO_IP, ZTS_IP_MULTICAST_IF, &ifaddr, sizeof(ifaddr));
+    }
+    int num_dests = num_receivers > 0 ? num_receivers : 1;
+    struct zts_sockaddr_storage* dests = calloc(num_dests, sizeof(*dests));
+    zts_socklen_t* destlens = calloc(num_dests, sizeof(*destlens));
+
+    destlens[0] = sizeof(*dests);
+    zts_util_ipstr_to_saddr(group_addr, port, (struct zts_sockaddr*)&dests[0], &destlens[0]);
+    printf("Multicast to %s:\n", group_addr);
+    send_for(fd, dests, destlens, 1, seconds, num_receivers);
+
+    if (num_receivers > 0) {
+        for (int i = 0; i < num_receivers; i++) {
+            destlens[i] = sizeof(*dests);
+            zts_util_ipstr_to_saddr(receivers[i], port, (struct zts_sockaddr*)&dests[i], &destlens[i]);
+        }
+        printf("Unicast to %d receivers:\n", num_receivers);
+        // Every datagram sent is one copy delivered
+        send_for(fd, dests, destlens, num_receivers, seconds, 1);
+    }
+    free(dests);
+    free(destlens);
+    zts_bsd_close(fd);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 7) {
+        printf("\nlibzt multicast benchmark\n");
+        printf("mcastbench <id_storage_path> <net_id> receiver <local_addr> <group_addr> <port>\n");
+        printf("mcastbench <id_storage_path> <net_id> sender <local_addr> <group_addr> <port> [seconds] "
+               "[receiver_addr ...]\n");
+        printf("  e.g. group_addr 239.1.2.3 or ff0e::1:2:3\n");
+        exit(0);
+    }
+    char* storage_path = argv[1];
+    long long int net_id = strtoull(argv[2], NULL, 16);   // At least 64 bits
+    char* mode = argv[3];
+    char* local_addr = argv[4];
+    char* group_addr = argv[5];
+    unsigned short port = atoi(argv[6]);
+    int seconds = argc > 7 ? atoi(argv[7]) : 10;
+    int err = ZTS_ERR_OK;
+
+    if ((err = zts_init_from_storage(storage_path)) != ZTS_ERR_OK) {
+        printf("Unable to start service, error = %d. Exiting.\n", err);
+        exit(1);
+    }
+    if ((err = zts_node_start()) != ZTS_ERR_OK) {
+        printf("Unable to start service, error = %d. Exiting.\n", err);
+        exit(1);
+    }
+    printf("Waiting for node to come online\n");
+    while (! zts_node_is_online()) {
+        zts_util_delay(50);
+    }
+    printf("Joining network %llx\n", net_id);
+    if (zts_net_join(net_id) != ZTS_ERR_OK) {
+        printf("Unable to join network. Exiting.\n");
+        exit(1);
+    }
+    while (! zts_net_transport_is_ready(net_id)) {
+        zts_util_delay(50);
+    }
+    int family = zts_util_get_ip_family(local_addr);
+    while (! zts_addr_is_assigned(net_id, family)) {
+        zts_util_delay(50);
+    }
+
+    if (! strcmp(mode, "receiver")) {
+        run_receiver(family, local_addr, group_addr, port);
+    }
+    else {
+        run_sender(family, local_addr, group_addr, port, seconds, argv + 8, argc > 8 ? argc - 8 : 0);
+    }
+    return zts_node_stop();
+}
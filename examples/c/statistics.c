@@ -125,6 +125,14 @@ int main(int argc, char** argv)
             s.nd6_rx,
             s.nd6_drop,
             s.nd6_err);
+        printf("   tcp_time_wait=%9d,    tcp_time_wait_recycled=%9d\n", s.tcp_time_wait, s.tcp_time_wait_recycled);
+        printf(
+            "   tcp_listen_queued=%9d,    tcp_listen_overflows=%9d,    tcp_syncookies_sent=%9d,    "
+            "tcp_syncookies_accepted=%9d\n",
+            s.tcp_listen_queued,
+            s.tcp_listen_overflows,
+            s.tcp_syncookies_sent,
+            s.tcp_syncookies_accepted);
     }
     return zts_node_stop();
 }
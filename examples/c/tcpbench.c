@@ -0,0 +1,221 @@
+/**
+ * libzt C API example
+ *
+ * TCP benchmarks
+ *
+ * server/client: Goodput. Run the server on one node and the client on
+ * another. To compare loss recovery and congestion control on lossy or long
+ * paths, emulate the path on the underlying physical interface of either
+ * host, e.g.:
+ *
+ *   tc qdisc add dev eth0 root netem delay 50ms loss 1%
+ *
+ * churn: Sustained connection rate. Runs on a single node, repeatedly opening a
+ * connection to itself and closing it again, server side first (as an
+ * HTTP/1.0 or RPC server would) so that TIME_WAIT accumulates on the server.
+ * Reports connections per second and TIME_WAIT occupancy once per second.
+ */
+
+#include "ZeroTierSockets.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BUF_SIZE (64 * 1024)
+
+static long long now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void print_tcp_info(int fd)
+{
+    zts_tcp_info_t info;
+    if (zts_get_tcp_info(fd, &info) == ZTS_ERR_OK) {
+        printf(
+            "srtt=%u ms, rto=%u ms, cwnd=%u, ssthresh=%u, rcv_wnd_limit=%u, snd_buf_limit=%u\n",
+            info.srtt_ms,
+            info.rto_ms,
+            info.cwnd,
+            info.ssthresh,
+            info.rcv_wnd_limit,
+            info.snd_buf_limit);
+    }
+}
+
+static int run_server(char* local_addr, unsigned short local_port)
+{
+    char remote_addr[ZTS_INET6_ADDRSTRLEN] = { 0 };
+    unsigned short remote_port = 0;
+    char* buf = (char*)malloc(BUF_SIZE);
+    while (1) {
+        int fd = zts_tcp_server(local_addr, local_port, remote_addr, ZTS_INET6_ADDRSTRLEN, &remote_port);
+        if (fd < 0) {
+            printf("Error (fd=%d, zts_errno=%d). Exiting.\n", fd, zts_errno);
+            exit(1);
+        }
+        printf("Accepted connection from %s:%d\n", remote_addr, remote_port);
+        long long total = 0, start = now_ms();
+        int bytes;
+        while ((bytes = zts_read(fd, buf, BUF_SIZE)) > 0) {
+            total += bytes;
+        }
+        long long elapsed = now_ms() - start;
+        printf(
+            "Received %lld bytes in %lld ms (%.2f Mbit/s)\n",
+            total,
+            elapsed,
+            elapsed ? (total * 8.0 / 1000.0) / elapsed : 0.0);
+        zts_close(fd);
+    }
+    return 0;
+}
+
+static int run_client(char* remote_addr, unsigned short remote_port, int seconds, int algorithm)
+{
+    int fd;
+    while ((fd = zts_tcp_client(remote_addr, remote_port)) < 0) {
+        printf("Re-attempting to connect...\n");
+    }
+    if (zts_set_congestion_control(fd, algorithm) != ZTS_ERR_OK) {
+        printf("Unable to select congestion control algorithm %d\n", algorithm);
+    }
+    char* buf = (char*)calloc(1, BUF_SIZE);
+    long long total = 0, start = now_ms(), last_report = start;
+    while (now_ms() - start < seconds * 1000LL) {
+        int bytes = zts_write(fd, buf, BUF_SIZE);
+        if (bytes < 0) {
+            printf("Error (fd=%d, ret=%d, zts_errno=%d). Exiting.\n", fd, bytes, zts_errno);
+            exit(1);
+        }
+        total += bytes;
+        if (now_ms() - last_report >= 1000) {
+            last_report = now_ms();
+            print_tcp_info(fd);
+        }
+    }
+    long long elapsed = now_ms() - start;
+    printf("Sent %lld bytes in %lld ms (%.2f Mbit/s)\n", total, elapsed, (total * 8.0 / 1000.0) / elapsed);
+    print_tcp_info(fd);
+    zts_close(fd);
+    return 0;
+}
+
+/**
+ * Open a connection to ourselves and return both ends
+ */
+static int connect_pair(int listen_fd, char* addr, unsigned short port, int* acc_fd)
+{
+    int fd = zts_socket(zts_util_get_ip_family(addr), ZTS_SOCK_STREAM, 0);
+    if (fd < 0 || zts_connect(fd, addr, port, 0) != ZTS_ERR_OK) {
+        return ZTS_ERR_SOCKET;
+    }
+    char remote_addr[ZTS_INET6_ADDRSTRLEN] = { 0 };
+    unsigned short remote_port = 0;
+    if ((*acc_fd = zts_accept(listen_fd, remote_addr, ZTS_INET6_ADDRSTRLEN, &remote_port)) < 0) {
+        return ZTS_ERR_SOCKET;
+    }
+    return fd;
+}
+
+static int open_listener(char* addr, unsigned short port)
+{
+    int listen_fd = zts_socket(zts_util_get_ip_family(addr), ZTS_SOCK_STREAM, 0);
+    if (zts_bind(listen_fd, addr, port) != ZTS_ERR_OK || zts_listen(listen_fd, 1) != ZTS_ERR_OK) {
+        printf("Error (fd=%d, zts_errno=%d). Exiting.\n", listen_fd, zts_errno);
+        exit(1);
+    }
+    return listen_fd;
+}
+
+static int run_churn(char* addr, unsigned short port, int seconds)
+{
+    int listen_fd = open_listener(addr, port);
+    printf("%12s %12s %12s\n", "conn/s", "time_wait", "recycled");
+    long long total = 0, start = now_ms(), last_report = start, last_total = 0;
+    while (now_ms() - start < seconds * 1000LL) {
+        int acc_fd, fd;
+        if ((fd = connect_pair(listen_fd, addr, port, &acc_fd)) < 0) {
+            printf("Unable to open connection %lld (zts_errno=%d)\n", total, zts_errno);
+            break;
+        }
+        zts_close(acc_fd);
+        zts_close(fd);
+        total++;
+        long long now = now_ms();
+        if (now - last_report >= 1000) {
+            zts_stats_counter_t s = { 0 };
+            zts_stats_get_all(&s);
+            printf(
+                "%12.0f %12u %12u\n",
+                (total - last_total) * 1000.0 / (now - last_report),
+                s.tcp_time_wait,
+                s.tcp_time_wait_recycled);
+            last_report = now;
+            last_total = total;
+        }
+    }
+    long long elapsed = now_ms() - start;
+    printf("%lld connections in %lld ms (%.0f conn/s)\n", total, elapsed, total * 1000.0 / elapsed);
+    return zts_close(listen_fd);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 6) {
+        printf("\nlibzt TCP benchmarks\n");
+        printf("tcpbench <id_storage_path> <net_id> server <local_addr> <local_port>\n");
+        printf("tcpbench <id_storage_path> <net_id> client <remote_addr> <remote_port> [seconds] [cc]\n");
+        printf("  cc: 0 = NewReno (default), 1 = CUBIC, 2 = BBR-style\n");
+        printf("tcpbench <id_storage_path> <net_id> churn <local_addr> <local_port> [seconds]\n");
+        exit(0);
+    }
+    char* storage_path = argv[1];
+    long long int net_id = strtoull(argv[2], NULL, 16);   // At least 64 bits
+    char* mode = argv[3];
+    char* addr = argv[4];
+    unsigned short port = atoi(argv[5]);
+    int seconds = argc > 6 ? atoi(argv[6]) : 10;
+    int algorithm = argc > 7 ? atoi(argv[7]) : ZTS_TCP_CC_NEWRENO;
+    int err = ZTS_ERR_OK;
+
+    if ((err = zts_init_from_storage(storage_path)) != ZTS_ERR_OK) {
+        printf("Unable to start service, error = %d. Exiting.\n", err);
+        exit(1);
+    }
+    if ((err = zts_node_start()) != ZTS_ERR_OK) {
+        printf("Unable to start service, error = %d. Exiting.\n", err);
+        exit(1);
+    }
+    printf("Waiting for node to come online\n");
+    while (! zts_node_is_online()) {
+        zts_util_delay(50);
+    }
+    printf("Joining network %llx\n", net_id);
+    if (zts_net_join(net_id) != ZTS_ERR_OK) {
+        printf("Unable to join network. Exiting.\n");
+        exit(1);
+    }
+    while (! zts_net_transport_is_ready(net_id)) {
+        zts_util_delay(50);
+    }
+    int family = zts_util_get_ip_family(addr);
+    while (! zts_addr_is_assigned(net_id, family)) {
+        zts_util_delay(50);
+    }
+
+    if (! strcmp(mode, "server")) {
+        run_server(addr, port);
+    }
+    else if (! strcmp(mode, "churn")) {
+        run_churn(addr, port, seconds);
+    }
+    else {
+        run_client(addr, port, seconds, algorithm);
+    }
+    return zts_node_stop();
+}
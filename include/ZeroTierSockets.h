@@ -190,6 +190,35 @@ typedef enum {
     ZTS_EVENT_STORE_NETWORK = 274
 } zts_event_t;
 
+//----------------------------------------------------------------------------//
+// Event classes                                                              //
+//----------------------------------------------------------------------------//
+
+/** `ZTS_EVENT_NODE_*` */
+#define ZTS_EVENT_CLASS_NODE 0x01
+/** `ZTS_EVENT_NETWORK_*` */
+#define ZTS_EVENT_CLASS_NETWORK 0x02
+/** `ZTS_EVENT_STACK_*` */
+#define ZTS_EVENT_CLASS_STACK 0x04
+/** `ZTS_EVENT_NETIF_*` */
+#define ZTS_EVENT_CLASS_NETIF 0x08
+/** `ZTS_EVENT_PEER_*` */
+#define ZTS_EVENT_CLASS_PEER 0x10
+/** `ZTS_EVENT_ROUTE_*` */
+#define ZTS_EVENT_CLASS_ROUTE 0x20
+/** `ZTS_EVENT_ADDR_*` */
+#define ZTS_EVENT_CLASS_ADDR 0x40
+/** `ZTS_EVENT_STORE_*` */
+#define ZTS_EVENT_CLASS_STORE 0x80
+/** All of the above */
+#define ZTS_EVENT_CLASS_ALL 0xff
+
+/**
+ * Default number of events that may wait for the event handler, see
+ * `zts_init_set_event_queue_len()`
+ */
+#define ZTS_EVENT_QUEUE_DEFAULT_LEN 1024
+
 //----------------------------------------------------------------------------//
 // zts_errno Error codes                                                      //
 //----------------------------------------------------------------------------//
@@ -585,6 +614,16 @@ struct zts_hostent {
  */
 struct zts_hostent* zts_bsd_gethostbyname(const char* name);
 
+/**
+ * Called with the addresses of a name looked up with zts_getaddrinfo_async():
+ * `err` is `ZTS_ERR_OK` with `count` (> 0) addresses in `addrs` (IPv6 ones
+ * first, ports are zero), `ZTS_ERR_NO_RESULT` if the name has no addresses of
+ * the family asked for, or `ZTS_ERR_GENERAL` if no DNS server answered or too
+ * many queries were in progress.
+ * `addrs` is only valid during the call.
+ */
+typedef void (*zts_getaddrinfo_cb)(void* arg, int err, const struct zts_sockaddr_storage* addrs, unsigned int count);
+
 struct zts_ip4_addr {
     uint32_t addr;
 };
@@ -1004,6 +1043,118 @@ typedef struct {
     zts_path_t paths[ZTS_MAX_PEER_NETWORK_PATHS];
 } zts_peer_info_t;
 
+/**
+ * Compact IP address in a snapshot (see `zts_core_query_snapshot()`)
+ */
+typedef struct {
+    /**
+     * Address in network byte order. IPv4 uses the first four bytes
+     */
+    uint8_t addr[16];
+
+    /**
+     * Port, or number of netmask bits for assigned addresses and route targets
+     */
+    uint16_t port;
+
+    /**
+     * `ZTS_AF_INET`, `ZTS_AF_INET6`, or 0 if there is no address
+     */
+    uint8_t family;
+
+    uint8_t unused_0;
+} zts_snapshot_addr_t;
+
+/**
+ * Network in a snapshot. Its addresses, routes and multicast subscriptions are
+ * the given ranges of the snapshot's arrays.
+ */
+typedef struct {
+    uint64_t net_id;
+    uint64_t mac;
+    char name[ZTS_MAX_NETWORK_SHORT_NAME_LENGTH + 1];
+    zts_network_status_t status;
+    zts_net_info_type_t type;
+    unsigned int mtu;
+    unsigned long netconf_rev;
+    unsigned int addr_first;
+    unsigned int addr_count;
+    unsigned int route_first;
+    unsigned int route_count;
+    unsigned int mc_first;
+    unsigned int mc_count;
+} zts_snapshot_net_t;
+
+/**
+ * Route in a snapshot
+ */
+typedef struct {
+    /**
+     * Target network, netmask bits in `port`
+     */
+    zts_snapshot_addr_t target;
+
+    /**
+     * Gateway, `family` is 0 for LAN-local routes
+     */
+    zts_snapshot_addr_t via;
+
+    uint16_t flags;
+    uint16_t metric;
+} zts_snapshot_route_t;
+
+/**
+ * Physical path in a snapshot
+ */
+typedef struct {
+    uint64_t last_tx;
+    uint64_t last_rx;
+    uint64_t trusted_path_id;
+    zts_snapshot_addr_t address;
+    uint8_t expired;
+    uint8_t preferred;
+} zts_snapshot_path_t;
+
+/**
+ * Peer in a snapshot. Its paths are the given range of the snapshot's `paths`.
+ */
+typedef struct {
+    uint64_t peer_id;
+    int ver_major;
+    int ver_minor;
+    int ver_rev;
+    int latency;
+    zts_peer_role_t role;
+    unsigned int path_first;
+    unsigned int path_count;
+} zts_snapshot_peer_t;
+
+/**
+ * Snapshot of all networks and peers, at the start of the buffer filled by
+ * `zts_core_query_snapshot()`. The arrays follow it in the same buffer.
+ */
+typedef struct {
+    /**
+     * Changes whenever a network's configuration, the set of peers or their
+     * paths change. Latencies and path timestamps may change without it.
+     */
+    uint64_t generation;
+
+    unsigned int net_count;
+    unsigned int addr_count;
+    unsigned int route_count;
+    unsigned int mc_count;
+    unsigned int peer_count;
+    unsigned int path_count;
+
+    zts_snapshot_net_t* nets;
+    zts_snapshot_addr_t* addrs;
+    zts_snapshot_route_t* routes;
+    zts_multicast_group_t* mcs;
+    zts_snapshot_peer_t* peers;
+    zts_snapshot_path_t* paths;
+} zts_snapshot_t;
+
 #define ZTS_MAX_NUM_ROOTS          16
 #define ZTS_MAX_ENDPOINTS_PER_ROOT 32
 
@@ -1078,6 +1229,25 @@ typedef struct {
     int len;
 } zts_event_msg_t;
 
+/**
+ * Event counts of one event class
+ */
+typedef struct {
+    /**
+     * Events passed to the event handler
+     */
+    uint64_t sent;
+    /**
+     * Events discarded because the queue was full
+     */
+    uint64_t dropped;
+    /**
+     * Events replaced by a later one about the same peer, network or address
+     * before they were sent
+     */
+    uint64_t coalesced;
+} zts_event_stats_t;
+
 //----------------------------------------------------------------------------//
 // ZeroTier Service and Network Controls                                      //
 //----------------------------------------------------------------------------//
@@ -1098,7 +1268,11 @@ typedef struct {
 // Central API                                                                //
 //----------------------------------------------------------------------------//
 
+// Off unless the library was built with it (-DZTS_DISABLE_CENTRAL_API=0), in
+// which case applications using it define ZTS_ENABLE_CENTRAL_API as well
+#if ! defined(ZTS_ENABLE_CENTRAL_API) && ! defined(ZTS_DISABLE_CENTRAL_API)
 #define ZTS_DISABLE_CENTRAL_API 1
+#endif
 
 #ifndef ZTS_DISABLE_CENTRAL_API
 
@@ -1117,6 +1291,80 @@ typedef struct {
 #define ZTS_CENTRAL_READ  1
 #define ZTS_CENTRAL_WRITE 2
 
+#define ZTS_CENTRAL_DEFAULT_PARALLEL 8
+
+/**
+ * One request of a batch run by `zts_central_req_batch()`
+ */
+typedef struct {
+    /**
+     * `ZTS_HTTP_GET`, `ZTS_HTTP_POST` or `ZTS_HTTP_DELETE`
+     */
+    int method;
+
+    /**
+     * Path on the server, for instance `/api/network/8056c2e21c000001/member`
+     */
+    const char* route;
+
+    /**
+     * `JSON` body of a `POST`, or `NULL`
+     */
+    const char* post_data;
+
+    /**
+     * Destination for this request's response, always `NUL`-terminated, or
+     * `NULL` to discard it
+     */
+    char* resp_buf;
+
+    /**
+     * Size of `resp_buf`
+     */
+    int resp_buf_len;
+
+    /**
+     * [out] Length of the response stored in `resp_buf`
+     */
+    int resp_len;
+
+    /**
+     * [out] Standard HTTP response code, 0 if no response was received
+     */
+    int http_resp_code;
+
+    /**
+     * [out] `ZTS_ERR_OK` if a response was received, `ZTS_ERR_ARG` if the
+     * request is invalid, `ZTS_ERR_SERVICE` if it failed or the response did
+     * not fit in `resp_buf`
+     */
+    int err;
+} zts_central_req_t;
+
+/**
+ * One member of a bulk operation such as `zts_central_node_auth_bulk()`
+ */
+typedef struct {
+    uint64_t net_id;
+    uint64_t node_id;
+
+    /**
+     * `JSON` member record to post, used by `zts_central_member_update_bulk()`
+     */
+    const char* post_data;
+
+    /**
+     * [out] Standard HTTP response code, 0 if no response was received
+     */
+    int http_resp_code;
+
+    /**
+     * [out] `ZTS_ERR_OK` if a response was received, `ZTS_ERR_ARG` if an ID
+     * or `post_data` is missing, `ZTS_ERR_SERVICE` if the request failed
+     */
+    int err;
+} zts_central_member_op_t;
+
 /**
  * @brief Enable read/write capability. Default before calling this is
  * read-only: `ZTS_CENTRAL_READ`
@@ -1164,6 +1412,22 @@ ZTS_API void ZTCALL zts_central_cleanup();
  */
 ZTS_API int ZTCALL zts_central_get_last_resp_buf(char* dst, int len);
 
+/**
+ * @brief Run many requests concurrently, each with its own response buffer.
+ *
+ * Requests reuse the client's kept-alive connections, so large batches cost
+ * few handshakes. Thread-safe, and may run alongside single requests.
+ *
+ * @param reqs Requests to run, their results are filled in
+ * @param count Number of requests
+ * @param max_parallel Most requests in flight at once (`0` for
+ *     `ZTS_CENTRAL_DEFAULT_PARALLEL`)
+ * @return `ZTS_ERR_OK` once every request has completed or failed (see each
+ *     request's `err`), `ZTS_ERR_ARG` if invalid argument, `ZTS_ERR_SERVICE`
+ *     if the client is not initialized.
+ */
+ZTS_API int ZTCALL zts_central_req_batch(zts_central_req_t* reqs, unsigned int count, unsigned int max_parallel);
+
 /**
  * @brief Get the status of the Central API server.
  *
@@ -1242,10 +1506,44 @@ ZTS_API int ZTCALL zts_central_member_update(int* http_resp_code, uint64_t net_i
  */
 ZTS_API int ZTCALL zts_central_node_auth(int* http_resp_code, uint64_t net_id, uint64_t node_id, uint8_t is_authed);
 
+/**
+ * @brief Update or add many members concurrently.
+ *
+ * Responses are discarded, each member's result is in its `http_resp_code` and `err`.
+ *
+ * @param ops Members to post, each with its own `post_data`
+ * @param count Number of members
+ * @param max_parallel Most requests in flight at once (`0` for `ZTS_CENTRAL_DEFAULT_PARALLEL`)
+ * @return `ZTS_ERR_OK` once every request has completed or failed, `ZTS_ERR_ARG` if invalid
+ *     argument, `ZTS_ERR_SERVICE` if the client is not initialized.
+ */
+ZTS_API int ZTCALL
+zts_central_member_update_bulk(zts_central_member_op_t* ops, unsigned int count, unsigned int max_parallel);
+
+/**
+ * @brief Authorize or (De)authorize many nodes concurrently. This operation is idempotent.
+ *
+ * Responses are discarded, each member's result is in its `http_resp_code` and `err`.
+ *
+ * @param ops Members to authorize (`post_data` is ignored)
+ * @param count Number of members
+ * @param is_authed Boolean value for whether these nodes should be authorized
+ * @param max_parallel Most requests in flight at once (`0` for `ZTS_CENTRAL_DEFAULT_PARALLEL`)
+ * @return `ZTS_ERR_OK` once every request has completed or failed, `ZTS_ERR_ARG` if invalid
+ *     argument, `ZTS_ERR_SERVICE` if the client is not initialized.
+ */
+ZTS_API int ZTCALL zts_central_node_auth_bulk(
+    zts_central_member_op_t* ops,
+    unsigned int count,
+    uint8_t is_authed,
+    unsigned int max_parallel);
+
 /**
  * @brief Get All Members of a Network.
  *
  * Get all members of a network for which you have at least read access.
+ * The last list received is kept and revalidated with its `ETag`, an
+ * unchanged list is copied from it and reported as `200`.
  *
  * @return Standard HTTP response codes.
  */
@@ -1266,6 +1564,10 @@ ZTS_API int ZTCALL zts_central_net_get_members(int* http_resp_code, uint64_t net
  * @brief Generates a node identity (public/secret key-pair) and stores it in a
  *     user-provided buffer.
  *
+ * The search for a key-pair runs on all cores, the first one found is used.
+ * If a pool was started with `zts_id_pool_start()` and holds an identity, that
+ * one is returned at once.
+ *
  * @param key User-provided destination buffer
  * @param key_buf_len Length of user-provided destination buffer. Will be set
  *     to the number of bytes copied.
@@ -1273,6 +1575,38 @@ ZTS_API int ZTCALL zts_central_net_get_members(int* http_resp_code, uint64_t net
  */
 ZTS_API int ZTCALL zts_id_new(char* key, unsigned int* key_buf_len);
 
+/**
+ * @brief Keep a number of node identities generated in the background
+ *
+ * Generation uses all cores until the pool holds `size` identities, and
+ * resumes as they are taken with `zts_id_pool_take()` or `zts_id_new()`. A node
+ * started without an identity also takes its identity from the pool. Calling
+ * this again changes the size. May be called at any time.
+ *
+ * @param size Number of identities to keep
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_id_pool_start(unsigned int size);
+
+/**
+ * @brief Stop generating identities in the background and discard those in
+ *     the pool
+ *
+ * @return `ZTS_ERR_OK` if successful.
+ */
+ZTS_API int ZTCALL zts_id_pool_stop();
+
+/**
+ * @brief Take a pre-generated node identity from the pool without waiting
+ *
+ * @param key User-provided destination buffer
+ * @param key_buf_len Length of user-provided destination buffer. Will be set
+ *     to the number of bytes copied.
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_NO_RESULT` if the pool is
+ *     empty, `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_id_pool_take(char* key, unsigned int* key_buf_len);
+
 /**
  * @brief Verifies that a key-pair is valid. Checks formatting and pairing of
  *    key to address.
@@ -1354,6 +1688,68 @@ int zts_init_set_event_handler(jobject obj_ref, jmethodID id);
 ZTS_API int ZTCALL zts_init_set_event_handler(void (*callback)(void*));
 #endif
 
+/**
+ * @brief Set which classes of events are sent to the event handler. Events of
+ * other classes are discarded before they are built, which matters on nodes
+ * with many peers. This is an initialization function that can only be called
+ * before `zts_node_start()`, see `zts_event_enable()` to change the set later.
+ *
+ * @param classes Bitwise OR of `ZTS_EVENT_CLASS_*` (default `ZTS_EVENT_CLASS_ALL`)
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem, `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_init_set_event_mask(uint64_t classes);
+
+/**
+ * @brief Start sending events of the given classes to the event handler
+ *
+ * @param classes Bitwise OR of `ZTS_EVENT_CLASS_*`
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem, `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_event_enable(uint64_t classes);
+
+/**
+ * @brief Stop sending events of the given classes to the event handler. Events
+ * of these classes that are already queued are discarded as well. Peer events
+ * that would have been sent while disabled are not sent later, once enabled
+ * again every known peer is reported anew.
+ *
+ * @param classes Bitwise OR of `ZTS_EVENT_CLASS_*`
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem, `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_event_disable(uint64_t classes);
+
+/**
+ * @brief Set how many events may wait for the event handler. This is an
+ * initialization function that can only be called before `zts_node_start()`.
+ *
+ * While the handler lags behind, a new `ZTS_EVENT_PEER_DIRECT`, `_RELAY` or
+ * `_UNREACHABLE`, address or `ZTS_EVENT_NETWORK_UPDATE` event replaces one about
+ * the same peer, address or network that is still waiting, so only the latest
+ * state is sent. Events are never replaced across a node, stack or network
+ * status event, which are sent in order with the rest. Once the queue is full
+ * other events of these classes (and of the netif, route and store classes)
+ * are dropped. Node, stack and network status events are never dropped.
+ *
+ * @param len Number of events (default `ZTS_EVENT_QUEUE_DEFAULT_LEN`)
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem, `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_init_set_event_queue_len(unsigned int len);
+
+/**
+ * @brief Get the number of events of a class that were sent, dropped or
+ * coalesced so far
+ *
+ * @param event_class One of `ZTS_EVENT_CLASS_*`, except `ZTS_EVENT_CLASS_ALL`
+ * @param stats Structure to be populated
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem, `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_event_get_stats(uint64_t event_class, zts_event_stats_t* stats);
+
 /**
  * @brief Set TCP relay for ZeroTier to use instead of P2P UDP
  *
@@ -1422,6 +1818,18 @@ ZTS_API int ZTCALL zts_init_set_low_bandwidth_mode(int enabled);
  */
 ZTS_API int ZTCALL zts_init_set_port(unsigned short port);
 
+/**
+ * @brief Set the maximum number of sockets that can be open at any one time.
+ * Once reached, socket creation and accept fail with `zts_errno` set to
+ * `ZTS_EMFILE` (pending connections stay queued). This is an initialization
+ * function that can only be called before `zts_node_start()`.
+ *
+ * @param max_sockets Number of sockets, `[1, ZTS_MAX_SOCKETS]` (default `ZTS_MAX_SOCKETS`)
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem, `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_init_set_max_sockets(unsigned int max_sockets);
+
 /**
  * @brief Set range that random ports will be selected from. This is an initialization function that can
  * only be called before `zts_node_start()`.
@@ -1456,6 +1864,21 @@ ZTS_API int ZTCALL zts_init_allow_secondary_port(unsigned int allowed);
  */
 ZTS_API int ZTCALL zts_init_allow_port_mapping(unsigned int allowed);
 
+/**
+ * @brief Allow or disallow carrying traffic to other libzt nodes on the same host over shared
+ * memory instead of encrypted UDP. This is disabled by default. Only nodes running as the same user
+ * find each other, and a peer is only reached this way after ZeroTier has delivered traffic from it
+ * on the network, and for as long as ZeroTier keeps doing so: a peer that loses access to the network
+ * may keep reaching this node for up to a minute. Note that network flow rules are not applied to this
+ * traffic. Not available on Windows. This is an initialization function that can
+ * only be called before `zts_node_start()`.
+ *
+ * @param allowed Whether or not this feature is enabled
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem, `ZTS_ERR_ARG` if invalid argument.
+ */
+ZTS_API int ZTCALL zts_init_allow_local_transport(unsigned int allowed);
+
 /**
  * @brief Enable or disable whether the node will cache network details
  * (enabled by default when `zts_init_from_storage()` is used.) Must be called before
@@ -1745,6 +2168,92 @@ ZTS_API int ZTCALL zts_net_get_type(uint64_t net_id);
  */
 ZTS_API int ZTCALL zts_route_is_assigned(uint64_t net_id, unsigned int family);
 
+/**
+ * Transmit classes of frames sent to a network, see `zts_net_set_tx_rate()`
+ */
+#define ZTS_TX_CLASS_CONTROL     0
+#define ZTS_TX_CLASS_INTERACTIVE 1
+#define ZTS_TX_CLASS_DEFAULT     2
+#define ZTS_TX_CLASS_BULK        3
+#define ZTS_TX_CLASS_COUNT       4
+
+/**
+ * Statistics of a transmit class
+ */
+typedef struct {
+    /**
+     * Frames and bytes sent
+     */
+    uint64_t sent_frames;
+    uint64_t sent_bytes;
+
+    /**
+     * Frames that waited for the rate limit
+     */
+    uint64_t delayed_frames;
+
+    /**
+     * Frames dropped because the class's queue was full
+     */
+    uint64_t dropped_frames;
+
+    /**
+     * Frames and bytes waiting now
+     */
+    unsigned int queue_len;
+    unsigned int queue_bytes;
+} zts_tx_class_stats_t;
+
+/**
+ * @brief Limit the rate at which frames are sent to a network
+ *
+ * Frames beyond the limit wait in one queue per transmit class. Waiting frames of
+ * `ZTS_TX_CLASS_CONTROL` go first, the other classes share the rate by weight (see
+ * `zts_net_set_tx_class_weight()`). A frame's class follows from its DSCP (see
+ * `zts_set_tx_class()`): CS5 and above are `ZTS_TX_CLASS_CONTROL`, CS2 to AF43
+ * `ZTS_TX_CLASS_INTERACTIVE`, CS1, AF1x and LE `ZTS_TX_CLASS_BULK`, the rest
+ * `ZTS_TX_CLASS_DEFAULT`. ARP, IGMP, neighbour discovery and MLD are control traffic.
+ *
+ * Without a limit nothing waits here and classes make no difference. To protect
+ * latency-sensitive traffic, set a limit just below the capacity of the uplink.
+ *
+ * @param net_id Network ID
+ * @param bytes_per_sec Rate limit, `0` for none (the default)
+ * @param burst Most bytes sent at once after an idle period, `0` for 10 ms worth
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem, `ZTS_ERR_ARG` if invalid argument,
+ *     `ZTS_ERR_NO_RESULT` if the network is not joined.
+ */
+ZTS_API int ZTCALL zts_net_set_tx_rate(uint64_t net_id, uint64_t bytes_per_sec, unsigned int burst);
+
+/**
+ * @brief Set the share of the rate limit a transmit class gets while frames wait
+ *
+ * Defaults: `ZTS_TX_CLASS_CONTROL` 0, `ZTS_TX_CLASS_INTERACTIVE` 8,
+ * `ZTS_TX_CLASS_DEFAULT` 4, `ZTS_TX_CLASS_BULK` 1.
+ *
+ * @param net_id Network ID
+ * @param tx_class `ZTS_TX_CLASS_*`
+ * @param weight Share relative to other classes, `0` for strict priority over all
+ *     weighted classes (and over higher-numbered classes with weight `0`)
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem, `ZTS_ERR_ARG` if invalid argument,
+ *     `ZTS_ERR_NO_RESULT` if the network is not joined.
+ */
+ZTS_API int ZTCALL zts_net_set_tx_class_weight(uint64_t net_id, int tx_class, unsigned int weight);
+
+/**
+ * @brief Get the statistics of a transmit class of a network
+ *
+ * @param net_id Network ID
+ * @param tx_class `ZTS_TX_CLASS_*`
+ * @param stats Structure to fill
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem, `ZTS_ERR_ARG` if invalid argument,
+ *     `ZTS_ERR_NO_RESULT` if the network is not joined.
+ */
+ZTS_API int ZTCALL zts_net_get_tx_class_stats(uint64_t net_id, int tx_class, zts_tx_class_stats_t* stats);
+
 /**
  * @brief Start the ZeroTier node. Should be called after calling the relevant
  *    `zts_init_*` functions for your application. To enable storage call
@@ -1930,6 +2439,20 @@ typedef struct {
     uint32_t nd6_drop;
     /** Aggregate number of ND6 errors */
     uint32_t nd6_err;
+
+    /** Number of TCP connections currently in TIME_WAIT */
+    uint32_t tcp_time_wait;
+    /** Number of TIME_WAIT connections recycled for a new incoming connection */
+    uint32_t tcp_time_wait_recycled;
+
+    /** Number of incoming connections (half-open or not yet accepted) in listen queues */
+    uint32_t tcp_listen_queued;
+    /** Number of SYNs that arrived while their listen queue was full */
+    uint32_t tcp_listen_overflows;
+    /** Number of SYN cookies sent in place of a SYN-ACK from a full listen queue */
+    uint32_t tcp_syncookies_sent;
+    /** Number of connections established from a valid SYN cookie */
+    uint32_t tcp_syncookies_accepted;
 } zts_stats_counter_t;
 
 /**
@@ -2046,6 +2569,12 @@ struct zts_linger {
 #define ZTS_TCP_KEEPIDLE  0x0003
 #define ZTS_TCP_KEEPINTVL 0x0004
 #define ZTS_TCP_KEEPCNT   0x0005
+#define ZTS_TCP_INFO      0x000b   // Read-only, see zts_get_tcp_info()
+#define ZTS_TCP_CONGESTION 0x000d  // See zts_set_congestion_control()
+// Congestion control algorithms (ZTS_TCP_CONGESTION)
+#define ZTS_TCP_CC_NEWRENO 0
+#define ZTS_TCP_CC_CUBIC   1
+#define ZTS_TCP_CC_BBR     2
 // IPPROTO_IPV6 options
 #define ZTS_IPV6_CHECKSUM                                                                                              \
     0x0007 /* RFC3542: calculate and insert the ICMPv6 checksum for raw                                                \
@@ -2189,7 +2718,13 @@ ZTS_API int ZTCALL zts_bsd_close(int fd);
 /* FD_SET used for lwip_select */
 
 #define LWIP_SOCKET_OFFSET 0
-#define MEMP_NUM_NETCONN   1024
+#define MEMP_NUM_NETCONN   16384   // Must match lwipopts.h
+
+/**
+ * Maximum number of sockets that can be open at any one time. A lower limit
+ * can be set with `zts_init_set_max_sockets()`.
+ */
+#define ZTS_MAX_SOCKETS MEMP_NUM_NETCONN
 
 #ifndef ZTS_FD_SET
 #undef ZTS_FD_SETSIZE
@@ -2895,6 +3430,20 @@ ZTS_API int ZTCALL zts_set_ttl(int fd, int ttl);
  */
 ZTS_API int ZTCALL zts_get_ttl(int fd);
 
+/**
+ * @brief Mark the packets of a socket for a transmit class
+ *
+ * Sets the DSCP bits of `IP_TOS` (the IPv6 traffic class) to EF, AF41, 0 or
+ * CS1 for `ZTS_TX_CLASS_CONTROL`, `ZTS_TX_CLASS_INTERACTIVE`,
+ * `ZTS_TX_CLASS_DEFAULT` or `ZTS_TX_CLASS_BULK`. See `zts_net_set_tx_rate()`.
+ *
+ * @param fd Socket file descriptor
+ * @param tx_class `ZTS_TX_CLASS_*`
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem, `ZTS_ERR_ARG` if invalid argument. Sets `zts_errno`
+ */
+ZTS_API int ZTCALL zts_set_tx_class(int fd, int tx_class);
+
 /**
  * @brief Change blocking behavior `O_NONBLOCK`
  *
@@ -2934,6 +3483,121 @@ ZTS_API int ZTCALL zts_set_keepalive(int fd, int enabled);
  */
 ZTS_API int ZTCALL zts_get_keepalive(int fd);
 
+/**
+ * Snapshot of the internal state of a TCP connection, analogous to Linux's
+ * `struct tcp_info`. Times are in milliseconds, windows and buffers in bytes.
+ */
+typedef struct {
+    /** lwIP TCP state (`0`=CLOSED, `1`=LISTEN, ... `4`=ESTABLISHED, ... `10`=TIME_WAIT) */
+    uint32_t state;
+    /** Maximum segment size used for sending */
+    uint32_t mss;
+    /** Smoothed round-trip time estimate */
+    uint32_t srtt_ms;
+    /** Round-trip time variance estimate */
+    uint32_t rttvar_ms;
+    /** Current retransmission timeout */
+    uint32_t rto_ms;
+    /** Congestion window */
+    uint32_t cwnd;
+    /** Slow start threshold */
+    uint32_t ssthresh;
+    /** Send window most recently advertised by the remote host */
+    uint32_t snd_wnd;
+    /** Largest send window ever advertised by the remote host */
+    uint32_t snd_wnd_max;
+    /** Receive window currently available */
+    uint32_t rcv_wnd;
+    /** Receive window most recently announced to the remote host */
+    uint32_t rcv_ann_wnd;
+    /** Window scale factor applied to the send window */
+    uint32_t snd_wscale;
+    /** Window scale factor applied to the receive window */
+    uint32_t rcv_wscale;
+    /** Available space in the send buffer */
+    uint32_t snd_buf;
+    /** Number of pbufs currently queued for sending */
+    uint32_t snd_queuelen;
+    /** Bytes sent but not yet acknowledged */
+    uint32_t bytes_in_flight;
+    /** Bytes queued but not yet sent */
+    uint32_t bytes_unsent;
+    /** Number of consecutive retransmissions of the oldest unacknowledged segment */
+    uint32_t retransmits;
+    /** Number of duplicate ACKs received for the current `lastack` */
+    uint32_t dupacks;
+    /** Number of out-of-order segments held in the reassembly queue */
+    uint32_t ooseq_segs;
+    /** Number of bytes held in the reassembly queue */
+    uint32_t ooseq_bytes;
+    /** `1` if the connection is currently in fast recovery, otherwise `0` */
+    uint32_t in_fast_recovery;
+    /** Autotuned upper bound of the receive window, see zts_set_tcp_mem_limit() */
+    uint32_t rcv_wnd_limit;
+    /** Autotuned size of the send buffer, see zts_set_tcp_mem_limit() */
+    uint32_t snd_buf_limit;
+} zts_tcp_info_t;
+
+/**
+ * @brief Get a snapshot of the internal state of a TCP connection (`TCP_INFO`)
+ *
+ * @param fd Socket file descriptor
+ * @param info Pointer to structure that will be populated
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem, `ZTS_ERR_ARG` if invalid argument. Sets `zts_errno`
+ *     to `ZTS_ENOPROTOOPT` if the socket is not a TCP socket.
+ */
+ZTS_API int ZTCALL zts_get_tcp_info(int fd, zts_tcp_info_t* info);
+
+/**
+ * @brief Select the congestion control algorithm of a TCP socket
+ *
+ * `ZTS_TCP_CC_NEWRENO` is lwIP's built-in algorithm and the default.
+ * `ZTS_TCP_CC_CUBIC` (RFC 8312) grows the window as a function of the time
+ * since the last loss and is better suited to paths with a large
+ * bandwidth-delay product. `ZTS_TCP_CC_BBR` sizes the window from the measured
+ * bottleneck bandwidth and minimum RTT instead of reacting to loss, but
+ * without packet pacing. Listening sockets pass their selection on to
+ * accepted sockets.
+ *
+ * @param fd Socket file descriptor
+ * @param algorithm `ZTS_TCP_CC_NEWRENO`, `ZTS_TCP_CC_CUBIC` or `ZTS_TCP_CC_BBR`
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem, `ZTS_ERR_ARG` if invalid argument. Sets `zts_errno`
+ */
+ZTS_API int ZTCALL zts_set_congestion_control(int fd, int algorithm);
+
+/**
+ * @brief Return the congestion control algorithm of a TCP socket
+ *
+ * @param fd Socket file descriptor
+ * @return `ZTS_TCP_CC_*` value, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem, `ZTS_ERR_ARG` if invalid argument. Sets `zts_errno`
+ */
+ZTS_API int ZTCALL zts_get_congestion_control(int fd);
+
+/**
+ * @brief Limit the memory committed to TCP receive windows and send buffers
+ *
+ * Each TCP connection starts with a small receive window and send buffer
+ * which grow with the connection's measured bandwidth-delay product. This
+ * sets the total across all connections (64 MB by default). When lowered below
+ * the current usage, connections shrink their windows and buffers until usage
+ * is below the limit again. May be called at any time after the node is online.
+ *
+ * @param max_bytes Maximum total size in bytes
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_SERVICE` if the node
+ *     experiences a problem
+ */
+ZTS_API int ZTCALL zts_set_tcp_mem_limit(unsigned int max_bytes);
+
+/**
+ * @brief Return the memory committed to TCP receive windows and send buffers
+ *
+ * @return Total size in bytes, `ZTS_ERR_SERVICE` if the node experiences a problem
+ */
+ZTS_API int ZTCALL zts_get_tcp_mem_usage();
+
 /**
  * Initialize one of the DNS servers.
  *
@@ -2951,6 +3615,30 @@ ZTS_API int ZTCALL zts_dns_set_server(uint8_t index, const zts_ip_addr* addr);
  */
 ZTS_API const zts_ip_addr* ZTCALL zts_dns_get_server(uint8_t index);
 
+/**
+ * @brief Look up the addresses of a host name without blocking
+ *
+ * Any number of lookups may be in progress at a time, lookups of the same name
+ * share one query. Answers are cached for as long as their TTL allows (also
+ * that a name doesn't exist), and names in use are refreshed shortly before
+ * they expire. Names in the DNS domain of a joined network are sent to the
+ * DNS servers of that network, others to the servers set with
+ * `zts_dns_set_server()`, or to the servers of any joined network if none are
+ * set. Numeric addresses are returned as they are.
+ *
+ * The callback is called from a thread of the resolver, never before this
+ * function returns, and may use the socket API.
+ *
+ * @param name A null-terminated host name, or numeric address
+ * @param family `ZTS_AF_INET`, `ZTS_AF_INET6` or `ZTS_AF_UNSPEC` (both)
+ * @param callback Function called with the result
+ * @param arg Passed to `callback`
+ * @return `ZTS_ERR_OK` if the callback will be called, `ZTS_ERR_SERVICE` if
+ *     the node experiences a problem, `ZTS_ERR_ARG` if invalid argument,
+ *     `ZTS_ERR_GENERAL` if the resolver's thread can't be started
+ */
+ZTS_API int ZTCALL zts_getaddrinfo_async(const char* name, int family, zts_getaddrinfo_cb callback, void* arg);
+
 //----------------------------------------------------------------------------//
 // Core query sub-API (Used for simplifying high-level language wrappers)     //
 //----------------------------------------------------------------------------//
@@ -3080,6 +3768,28 @@ ZTS_API int ZTCALL zts_core_query_mc_count(uint64_t net_id);
  */
 ZTS_API int ZTCALL zts_core_query_mc(uint64_t net_id, unsigned int idx, uint64_t* mac, uint32_t* adi);
 
+/**
+ * @brief Copy all networks with their addresses, routes and multicast subscriptions, and
+ * all peers with their paths, into one buffer in a single consistent pass.
+ *
+ * Does its own locking, do not call it between zts_core_lock_obtain() and
+ * zts_core_lock_release(). The buffer starts with a `zts_snapshot_t` whose array pointers
+ * point further into the buffer, so it must be aligned for `uint64_t` (as from `malloc()`).
+ *
+ * Pass the generation of the last snapshot you processed (0 for none) to learn cheaply that
+ * nothing changed. If the buffer is too small `len` is set to the size needed and
+ * `generation` is left alone, so retry with a larger buffer (peers may have been added in
+ * between).
+ *
+ * @param buf Buffer to fill, may be `NULL` to learn the size needed
+ * @param len [in, out] Size of `buf`, set to the number of bytes used or needed
+ * @param generation [in, out] Generation already seen, set to that of the snapshot
+ * @return `ZTS_ERR_OK` if the buffer was filled. `ZTS_ERR_NO_RESULT` if the generation is
+ *     unchanged. `ZTS_ERR_ARG` if the buffer is too small or an argument is `NULL`.
+ *     `ZTS_ERR_SERVICE` if the core service is unavailable.
+ */
+ZTS_API int ZTCALL zts_core_query_snapshot(void* buf, unsigned int* len, uint64_t* generation);
+
 //----------------------------------------------------------------------------//
 // Utilities                                                                  //
 //----------------------------------------------------------------------------//
@@ -11,6 +11,23 @@
  */
 /****/
 
+/**
+ * @file
+ *
+ * Central API client
+ *
+ * All transfers share one connection cache, DNS cache and TLS session cache,
+ * so a run of requests to the same server reuses kept-alive connections
+ * instead of paying for DNS, TCP and TLS handshakes every time. Easy handles
+ * are pooled too. The single-request calls fill the buffer given to
+ * zts_central_init(), zts_central_req_batch() runs requests concurrently on
+ * one multi handle, each into its own buffer.
+ *
+ * Member lists are fetched with If-None-Match, the last list received for
+ * each network being kept with its ETag, so that polling an unchanged list
+ * costs a 304 response instead of a download.
+ */
+
 #include "ZeroTierSockets.h"
 
 #ifndef ZTS_DISABLE_CENTRAL_API
@@ -22,6 +39,9 @@
 #include <cstdint>
 #include <cstring>
 #include <curl/curl.h>
+#include <map>
+#include <string>
+#include <vector>
 
 #define REQ_LEN 64
 
@@ -40,6 +60,61 @@ using namespace ZeroTier;
 
 Mutex _responseBuffer_m;
 
+/**
+ * One request in flight: its handle, headers and response buffer
+ */
+struct CentralTransfer {
+    CURL* curl;
+    struct curl_slist* hs;
+    char* buf;   // NULL to discard the response
+    int len;
+    int offset;
+    char etag[128];
+};
+
+/**
+ * Last response to a cached GET
+ */
+struct CentralCacheEntry {
+    std::string etag;
+    std::string body;
+};
+
+static std::map<std::string, CentralCacheEntry> _cache;   // By route, guarded by _responseBuffer_m
+
+static CURLSH* _share;
+static Mutex _share_m[CURL_LOCK_DATA_LAST];
+static std::vector<CURL*> _handles;   // Idle, reset
+static Mutex _handles_m;
+
+static void central_share_lock(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr)
+{
+    _share_m[data].lock();
+}
+
+static void central_share_unlock(CURL* handle, curl_lock_data data, void* userptr)
+{
+    _share_m[data].unlock();
+}
+
+static CURL* central_handle_take()
+{
+    Mutex::Lock _l(_handles_m);
+    if (_handles.empty()) {
+        return curl_easy_init();
+    }
+    CURL* curl = _handles.back();
+    _handles.pop_back();
+    return curl;
+}
+
+static void central_handle_give(CURL* curl)
+{
+    curl_easy_reset(curl);
+    Mutex::Lock _l(_handles_m);
+    _handles.push_back(curl);
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -47,17 +122,47 @@ extern "C" {
 size_t on_data(void* buffer, size_t size, size_t nmemb, void* userp)
 {
     DEBUG_INFO("buf=%p,size=%zu,nmemb=%zu,userp=%p", buffer, size, nmemb, userp);
+    CentralTransfer* t = (CentralTransfer*)userp;
     int byte_count = (size * nmemb);
-    if (_resp_buf_offset + byte_count >= _resp_buf_len) {
+    if (! t->buf) {
+        t->offset += byte_count;
+        return byte_count;
+    }
+    if (t->offset + byte_count >= t->len) {
         DEBUG_INFO("Out of buffer space. Cannot store response from server");
         return 0;   // Signal to libcurl that our buffer is full (triggers a
                     // write error.)
     }
-    memcpy(_resp_buf + _resp_buf_offset, buffer, byte_count);
-    _resp_buf_offset += byte_count;
+    memcpy(t->buf + t->offset, buffer, byte_count);
+    t->offset += byte_count;
+    t->buf[t->offset] = 0;
     return byte_count;
 }
 
+size_t on_header(char* buffer, size_t size, size_t nitems, void* userp)
+{
+    CentralTransfer* t = (CentralTransfer*)userp;
+    size_t len = size * nitems;
+    if (len > 5 && ! strncmp(buffer, "HTTP/", 5)) {
+        t->etag[0] = 0;   // Response after a redirect
+    }
+    if (len > 5 && curl_strnequal(buffer, "ETag:", 5)) {
+        size_t start = 5;
+        while (start < len && buffer[start] == ' ') {
+            start++;
+        }
+        size_t end = len;
+        while (end > start && (buffer[end - 1] == '\r' || buffer[end - 1] == '\n' || buffer[end - 1] == ' ')) {
+            end--;
+        }
+        if (end - start < sizeof(t->etag)) {
+            memcpy(t->etag, buffer + start, end - start);
+            t->etag[end - start] = 0;
+        }
+    }
+    return len;
+}
+
 int zts_central_set_access_mode(int8_t modes)
 {
     if (! (modes & ZTS_CENTRAL_READ) && ! (modes & ZTS_CENTRAL_WRITE)) {
@@ -96,6 +201,17 @@ int zts_central_init(const char* url_str, const char* token_str, char* resp_buf,
     _resp_buf_offset = 0;
     // Initialize all curl internal submodules
     curl_global_init(CURL_GLOBAL_ALL);
+    if (! _share) {
+        // Connections, DNS answers and TLS sessions outlive each request
+        _share = curl_share_init();
+        if (_share) {
+            curl_share_setopt(_share, CURLSHOPT_LOCKFUNC, central_share_lock);
+            curl_share_setopt(_share, CURLSHOPT_UNLOCKFUNC, central_share_unlock);
+            curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+            curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+            curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        }
+    }
 
     int url_len = strnlen(url_str, ZTS_CENTRAL_MAX_URL_LEN);
     if (url_len < 3 || url_len > ZTS_CENTRAL_MAX_URL_LEN) {
@@ -119,18 +235,30 @@ int zts_central_init(const char* url_str, const char* token_str, char* resp_buf,
 
 void zts_central_cleanup()
 {
+    _bInit = false;
+    {
+        Mutex::Lock _l(_responseBuffer_m);
+        _cache.clear();
+    }
+    {
+        Mutex::Lock _l(_handles_m);
+        for (size_t i = 0; i < _handles.size(); i++) {
+            curl_easy_cleanup(_handles[i]);
+        }
+        _handles.clear();
+    }
+    if (_share) {
+        curl_share_cleanup(_share);
+        _share = NULL;
+    }
     curl_global_cleanup();
 }
 
-int central_req(
-    int request_type,
-    char* central_str,
-    char* api_route_str,
-    char* token_str,
-    int* response_code,
-    char* post_data)
+/**
+ * Check that the client is initialized and allowed to make this request
+ */
+static int central_check(int request_type)
 {
-    int err = ZTS_ERR_OK;
     if (! _bInit) {
         DEBUG_INFO("Error: Central API must be initialized first. Call "
                    "zts_central_init()");
@@ -145,7 +273,27 @@ int central_req(
                    "permission");
         return ZTS_ERR_SERVICE;
     }
-    zts_central_clear_resp_buf();
+    return ZTS_ERR_OK;
+}
+
+/**
+ * Take a handle from the pool and set it up for a request. The response goes
+ * to `t->buf`, which must be set along with `t->len`. A response ETag goes to
+ * `t->etag`.
+ */
+static int central_transfer_begin(
+    CentralTransfer* t,
+    int request_type,
+    const char* central_str,
+    const char* api_route_str,
+    const char* token_str,
+    const char* post_data,
+    const char* if_none_match = NULL)
+{
+    t->curl = NULL;
+    t->hs = NULL;
+    t->offset = 0;
+    t->etag[0] = 0;
     int central_strlen = strnlen(central_str, ZTS_CENTRAL_MAX_URL_LEN);
     int api_route_strlen = strnlen(api_route_str, ZTS_CENTRAL_MAX_URL_LEN);
     int token_strlen = strnlen(token_str, ZTS_CENTRAL_TOKEN_LEN);
@@ -153,37 +301,43 @@ int central_req(
     if (token_strlen > ZTS_CENTRAL_TOKEN_LEN) {
         return ZTS_ERR_ARG;
     }
-    if (url_len > ZTS_CENTRAL_MAX_URL_LEN) {
+    if (url_len >= ZTS_CENTRAL_MAX_URL_LEN) {
         return ZTS_ERR_ARG;
     }
     char req_url[ZTS_CENTRAL_MAX_URL_LEN] = { 0 };
-    strncpy(req_url, central_str, ZTS_CENTRAL_MAX_URL_LEN);
-    strncat(req_url, api_route_str, ZTS_CENTRAL_MAX_URL_LEN);
+    OSUtils::ztsnprintf(req_url, ZTS_CENTRAL_MAX_URL_LEN, "%s%s", central_str, api_route_str);
 
-    CURL* curl;
-    CURLcode res;
-    curl = curl_easy_init();
-    if (! curl) {
+    t->curl = central_handle_take();
+    if (! t->curl) {
         return ZTS_ERR_GENERAL;
     }
-
-    struct curl_slist* hs = NULL;
     char auth_str[ZTS_CENTRAL_TOKEN_LEN + 32] = { 0 };   // + Authorization: Bearer
     if (token_strlen == ZTS_CENTRAL_TOKEN_LEN) {
         OSUtils::ztsnprintf(auth_str, ZTS_CENTRAL_TOKEN_LEN + 32, "Authorization: Bearer %s", token_str);
     }
-
-    hs = curl_slist_append(hs, auth_str);
-    hs = curl_slist_append(hs, "Content-Type: application/json");
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, hs);
-    curl_easy_setopt(curl, CURLOPT_URL, req_url);
+    t->hs = curl_slist_append(t->hs, auth_str);
+    t->hs = curl_slist_append(t->hs, "Content-Type: application/json");
+    if (if_none_match) {
+        std::string inm = std::string("If-None-Match: ") + if_none_match;
+        t->hs = curl_slist_append(t->hs, inm.c_str());
+    }
+    if (_share) {
+        curl_easy_setopt(t->curl, CURLOPT_SHARE, _share);
+    }
+    curl_easy_setopt(t->curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(t->curl, CURLOPT_PRIVATE, t);
+    curl_easy_setopt(t->curl, CURLOPT_HTTPHEADER, t->hs);
+    curl_easy_setopt(t->curl, CURLOPT_URL, req_url);
     // example.com is redirected, so we tell libcurl to follow redirection
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(t->curl, CURLOPT_FOLLOWLOCATION, 1L);
     if (_bIsVerbose) {
-        curl_easy_setopt(curl, CURLOPT_VERBOSE, 1);
+        curl_easy_setopt(t->curl, CURLOPT_VERBOSE, 1);
     }
     // Tell curl to use our write function
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, on_data);
+    curl_easy_setopt(t->curl, CURLOPT_WRITEFUNCTION, on_data);
+    curl_easy_setopt(t->curl, CURLOPT_WRITEDATA, t);
+    curl_easy_setopt(t->curl, CURLOPT_HEADERFUNCTION, on_header);
+    curl_easy_setopt(t->curl, CURLOPT_HEADERDATA, t);
 
     if (request_type == ZTS_HTTP_GET) {
         // Nothing
@@ -192,35 +346,195 @@ int central_req(
     if (request_type == ZTS_HTTP_POST) {
         DEBUG_INFO("Request (POST) = %s", api_route_str);
         if (post_data) {
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, post_data);
+            curl_easy_setopt(t->curl, CURLOPT_POSTFIELDS, post_data);
         }
-        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "POST");
+        curl_easy_setopt(t->curl, CURLOPT_CUSTOMREQUEST, "POST");
     }
     if (request_type == ZTS_HTTP_DELETE) {
-        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
+        curl_easy_setopt(t->curl, CURLOPT_CUSTOMREQUEST, "DELETE");
     }
-    // curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L); // Consider 400-500
+    // curl_easy_setopt(t->curl, CURLOPT_FAILONERROR, 1L); // Consider 400-500
     // series code as failures
-    // Perform request
-    res = curl_easy_perform(curl);
-    if (res == CURLE_OK) {
-        // char* url;
-        double elapsed_time = 0.0;
-        long hrc = 0;
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &hrc);
-        curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &elapsed_time);
-        DEBUG_INFO("Req. took %f second(s). HTTP code (%ld)", elapsed_time, hrc);
-        *response_code = hrc;
-        // curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url);
-    }
-    else {
+    return ZTS_ERR_OK;
+}
+
+/**
+ * Report how a finished request went
+ */
+static int central_transfer_result(CentralTransfer* t, CURLcode res, int* response_code)
+{
+    if (res != CURLE_OK) {
         DEBUG_INFO("%s", curl_easy_strerror(res));
-        err = ZTS_ERR_SERVICE;
+        return ZTS_ERR_SERVICE;
     }
-    curl_easy_cleanup(curl);
+    double elapsed_time = 0.0;
+    long hrc = 0;
+    curl_easy_getinfo(t->curl, CURLINFO_RESPONSE_CODE, &hrc);
+    curl_easy_getinfo(t->curl, CURLINFO_TOTAL_TIME, &elapsed_time);
+    DEBUG_INFO("Req. took %f second(s). HTTP code (%ld)", elapsed_time, hrc);
+    *response_code = hrc;
+    return ZTS_ERR_OK;
+}
+
+/**
+ * Return the handle to the pool. Its connection stays in the shared cache.
+ */
+static void central_transfer_end(CentralTransfer* t)
+{
+    if (t->curl) {
+        central_handle_give(t->curl);
+        t->curl = NULL;
+    }
+    curl_slist_free_all(t->hs);
+    t->hs = NULL;
+}
+
+int central_req(
+    int request_type,
+    char* central_str,
+    char* api_route_str,
+    char* token_str,
+    int* response_code,
+    char* post_data)
+{
+    int err = central_check(request_type);
+    if (err != ZTS_ERR_OK) {
+        return err;
+    }
+    // The response buffer is shared by all single requests
+    Mutex::Lock _l(_responseBuffer_m);
+    memset(_resp_buf, 0, _resp_buf_len);
+    _resp_buf_offset = 0;
+    CentralTransfer t;
+    t.buf = _resp_buf;
+    t.len = _resp_buf_len;
+    if ((err = central_transfer_begin(&t, request_type, central_str, api_route_str, token_str, post_data))
+        == ZTS_ERR_OK) {
+        err = central_transfer_result(&t, curl_easy_perform(t.curl), response_code);
+    }
+    _resp_buf_offset = t.offset;
+    central_transfer_end(&t);
     return err;
 }
 
+/**
+ * GET into the shared response buffer, revalidating the last response to the
+ * same route instead of downloading it again. An unchanged response is
+ * reported as the 200 it was.
+ */
+static int central_req_cached(char* api_route_str, int* response_code)
+{
+    int err = central_check(ZTS_HTTP_GET);
+    if (err != ZTS_ERR_OK) {
+        return err;
+    }
+    Mutex::Lock _l(_responseBuffer_m);
+    memset(_resp_buf, 0, _resp_buf_len);
+    _resp_buf_offset = 0;
+    std::map<std::string, CentralCacheEntry>::iterator c = _cache.find(api_route_str);
+    if (c != _cache.end() && (int)c->second.body.size() >= _resp_buf_len) {
+        _cache.erase(c);   // Would not fit anymore
+        c = _cache.end();
+    }
+    CentralTransfer t;
+    t.buf = _resp_buf;
+    t.len = _resp_buf_len;
+    const char* etag = c != _cache.end() ? c->second.etag.c_str() : NULL;
+    if ((err = central_transfer_begin(&t, ZTS_HTTP_GET, api_url, api_route_str, api_token, NULL, etag))
+        == ZTS_ERR_OK) {
+        err = central_transfer_result(&t, curl_easy_perform(t.curl), response_code);
+    }
+    if (err == ZTS_ERR_OK && *response_code == 304 && c != _cache.end()) {
+        DEBUG_INFO("Unchanged: %s", api_route_str);
+        memcpy(_resp_buf, c->second.body.data(), c->second.body.size());
+        t.offset = c->second.body.size();
+        *response_code = 200;
+    }
+    else if (err == ZTS_ERR_OK && *response_code == 200 && t.etag[0]) {
+        _cache[api_route_str].etag = t.etag;
+        _cache[api_route_str].body.assign(_resp_buf, t.offset);
+    }
+    else if (c != _cache.end()) {
+        _cache.erase(c);
+    }
+    _resp_buf_offset = t.offset;
+    central_transfer_end(&t);
+    return err;
+}
+
+int zts_central_req_batch(zts_central_req_t* reqs, unsigned int count, unsigned int max_parallel)
+{
+    if (! _bInit) {
+        return ZTS_ERR_SERVICE;
+    }
+    if (! reqs || ! count) {
+        return ZTS_ERR_ARG;
+    }
+    if (! max_parallel) {
+        max_parallel = ZTS_CENTRAL_DEFAULT_PARALLEL;
+    }
+    CURLM* multi = curl_multi_init();
+    if (! multi) {
+        return ZTS_ERR_GENERAL;
+    }
+    std::vector<CentralTransfer> xfers(count);
+    unsigned int next = 0;
+    unsigned int running = 0;
+    while (next < count || running) {
+        // Keep up to max_parallel requests in flight
+        while (next < count && running < max_parallel) {
+            zts_central_req_t* r = &reqs[next];
+            CentralTransfer* t = &xfers[next++];
+            t->curl = NULL;
+            t->hs = NULL;
+            r->resp_len = 0;
+            r->http_resp_code = 0;
+            if (! r->route || (r->resp_buf && r->resp_buf_len <= 0)) {
+                r->err = ZTS_ERR_ARG;
+                continue;
+            }
+            if (r->resp_buf) {
+                r->resp_buf[0] = 0;
+            }
+            t->buf = r->resp_buf;
+            t->len = r->resp_buf_len;
+            if ((r->err = central_check(r->method)) != ZTS_ERR_OK
+                || (r->err = central_transfer_begin(t, r->method, api_url, r->route, api_token, r->post_data))
+                       != ZTS_ERR_OK
+                || curl_multi_add_handle(multi, t->curl) != CURLM_OK) {
+                r->err = r->err != ZTS_ERR_OK ? r->err : ZTS_ERR_GENERAL;
+                central_transfer_end(t);
+                continue;
+            }
+            running++;
+        }
+        int still_running = 0;
+        curl_multi_perform(multi, &still_running);
+        bool finished = false;
+        int msgs_left = 0;
+        CURLMsg* msg;
+        while ((msg = curl_multi_info_read(multi, &msgs_left))) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            CentralTransfer* t = NULL;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**)&t);
+            zts_central_req_t* r = &reqs[t - &xfers[0]];
+            r->err = central_transfer_result(t, msg->data.result, &(r->http_resp_code));
+            r->resp_len = t->offset;
+            curl_multi_remove_handle(multi, t->curl);
+            central_transfer_end(t);
+            running--;
+            finished = true;
+        }
+        if (running && ! finished) {
+            curl_multi_wait(multi, NULL, 0, 1000, NULL);
+        }
+    }
+    curl_multi_cleanup(multi);
+    return ZTS_ERR_OK;
+}
+
 int zts_central_get_last_resp_buf(char* dest_buffer, int dest_buf_len)
 {
     if (dest_buf_len <= _resp_buf_offset) {
@@ -306,7 +620,60 @@ int zts_central_net_get_members(int* resp_code, uint64_t net_id)
 {
     char req[REQ_LEN] = { 0 };
     OSUtils::ztsnprintf(req, REQ_LEN, "/api/network/%llx/member", net_id);
-    return central_req(ZTS_HTTP_GET, api_url, req, api_token, resp_code, NULL);
+    return central_req_cached(req, resp_code);
+}
+
+/**
+ * POST to each member in `ops`, with `post_data` or else the item's own
+ */
+static int central_member_post_bulk(
+    zts_central_member_op_t* ops,
+    unsigned int count,
+    const char* post_data,
+    unsigned int max_parallel)
+{
+    if (! ops || ! count) {
+        return ZTS_ERR_ARG;
+    }
+    std::vector<zts_central_req_t> reqs(count);
+    std::vector<std::string> routes(count);
+    for (unsigned int i = 0; i < count; i++) {
+        char req[REQ_LEN] = { 0 };
+        OSUtils::ztsnprintf(req, REQ_LEN, "/api/network/%llx/member/%llx", ops[i].net_id, ops[i].node_id);
+        routes[i] = req;
+        reqs[i].method = ZTS_HTTP_POST;
+        reqs[i].post_data = post_data ? post_data : ops[i].post_data;
+        if (ops[i].net_id != 0 && ops[i].node_id != 0 && reqs[i].post_data) {
+            reqs[i].route = routes[i].c_str();   // Otherwise ZTS_ERR_ARG
+        }
+    }
+    int err = zts_central_req_batch(&reqs[0], count, max_parallel);
+    for (unsigned int i = 0; i < count; i++) {
+        ops[i].http_resp_code = reqs[i].http_resp_code;
+        ops[i].err = reqs[i].err;
+    }
+    return err;
+}
+
+int zts_central_member_update_bulk(zts_central_member_op_t* ops, unsigned int count, unsigned int max_parallel)
+{
+    return central_member_post_bulk(ops, count, NULL, max_parallel);
+}
+
+int zts_central_node_auth_bulk(
+    zts_central_member_op_t* ops,
+    unsigned int count,
+    uint8_t is_authed,
+    unsigned int max_parallel)
+{
+    if (is_authed != 0 && is_authed != 1) {
+        return ZTS_ERR_ARG;
+    }
+    return central_member_post_bulk(
+        ops,
+        count,
+        is_authed ? "{\"config\": {\"authorized\": true} }" : "{\"config\": {\"authorized\": false} }",
+        max_parallel);
 }
 
 #ifdef __cplusplus
@@ -0,0 +1,265 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * Internet checksum kernels
+ *
+ * Every kernel adds the data as native-endian 16-bit words into wider
+ * accumulators and folds the result at the end. Since the one's complement sum
+ * is independent of byte order, the result equals lwIP's
+ * lwip_standard_chksum() on every platform. Available kernels:
+ *
+ * - generic: 32 bits at a time into a 64-bit accumulator
+ * - sse2: 16 bytes at a time (x86, always available on x86-64)
+ * - avx2: 32 bytes at a time (x86, selected at runtime)
+ * - neon: 16 bytes at a time (ARM64)
+ *
+ * Each kernel also exists in a copying variant that stores the data it has just
+ * loaded, so that copying a packet and summing it takes a single pass.
+ */
+
+#include "Checksum.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define CHKSUM_HAVE_SSE2 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(_MSC_VER)
+#define CHKSUM_HAVE_AVX2 1
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define CHKSUM_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) && ! defined(_MSC_VER)
+#define CHKSUM_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CHKSUM_TARGET_AVX2
+#endif
+
+// Blocks a vector kernel may add before its 32-bit lanes could overflow (each
+// lane takes two 16-bit words per block)
+#define CHKSUM_SIMD_BLOCKS 16384
+
+namespace ZeroTier {
+
+typedef uint16_t (*chksum_fn)(uint8_t* dst, const uint8_t* src, size_t len);
+
+static uint16_t chksum_fold(uint64_t sum)
+{
+    sum = (sum & 0xffffffff) + (sum >> 32);
+    sum = (sum & 0xffffffff) + (sum >> 32);
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    return (uint16_t)sum;
+}
+
+/**
+ * Add (and copy) the remaining bytes that don't fill a whole vector
+ */
+template <bool copy> static uint64_t chksum_tail(uint8_t* dst, const uint8_t* src, size_t len, uint64_t sum)
+{
+    if (copy) {
+        memcpy(dst, src, len);
+    }
+    for (; len >= 4; src += 4, len -= 4) {
+        uint32_t w;
+        memcpy(&w, src, 4);
+        sum += w;
+    }
+    if (len >= 2) {
+        uint16_t w;
+        memcpy(&w, src, 2);
+        sum += w;
+        src += 2;
+        len -= 2;
+    }
+    if (len) {
+        // A trailing byte is padded with a zero byte in memory order
+        uint16_t w = 0;
+        memcpy(&w, src, 1);
+        sum += w;
+    }
+    return sum;
+}
+
+template <bool copy> static uint16_t chksum_generic(uint8_t* dst, const uint8_t* src, size_t len)
+{
+    uint64_t sum = 0;
+    for (; len >= 8; src += 8, dst += 8, len -= 8) {
+        uint32_t w[2];
+        memcpy(w, src, 8);
+        if (copy) {
+            memcpy(dst, w, 8);
+        }
+        sum += (uint64_t)w[0] + w[1];
+    }
+    return chksum_fold(chksum_tail<copy>(dst, src, len, sum));
+}
+
+#ifdef CHKSUM_HAVE_SSE2
+template <bool copy> static uint16_t chksum_sse2(uint8_t* dst, const uint8_t* src, size_t len)
+{
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t sum = 0;
+    while (len >= 16) {
+        size_t blocks = len / 16 < CHKSUM_SIMD_BLOCKS ? len / 16 : CHKSUM_SIMD_BLOCKS;
+        __m128i acc = zero;
+        for (size_t i = 0; i < blocks; i++, src += 16, dst += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)src);
+            if (copy) {
+                _mm_storeu_si128((__m128i*)dst, v);
+            }
+            acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(v, zero));
+            acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(v, zero));
+        }
+        len -= blocks * 16;
+        uint32_t lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, acc);
+        sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    return chksum_fold(chksum_tail<copy>(dst, src, len, sum));
+}
+#endif
+
+#ifdef CHKSUM_HAVE_AVX2
+template <bool copy> CHKSUM_TARGET_AVX2 static uint16_t chksum_avx2(uint8_t* dst, const uint8_t* src, size_t len)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t sum = 0;
+    while (len >= 32) {
+        size_t blocks = len / 32 < CHKSUM_SIMD_BLOCKS ? len / 32 : CHKSUM_SIMD_BLOCKS;
+        __m256i acc = zero;
+        for (size_t i = 0; i < blocks; i++, src += 32, dst += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)src);
+            if (copy) {
+                _mm256_storeu_si256((__m256i*)dst, v);
+            }
+            acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(v, zero));
+            acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(v, zero));
+        }
+        len -= blocks * 32;
+        uint32_t lanes[8];
+        _mm256_storeu_si256((__m256i*)lanes, acc);
+        for (int i = 0; i < 8; i++) {
+            sum += lanes[i];
+        }
+    }
+    return chksum_fold(chksum_tail<copy>(dst, src, len, sum));
+}
+
+static bool chksum_cpu_has_avx2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    // AVX and OSXSAVE, and the OS saves the YMM registers
+    if ((info[2] & (1 << 28)) == 0 || (info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+#ifdef CHKSUM_HAVE_NEON
+template <bool copy> static uint16_t chksum_neon(uint8_t* dst, const uint8_t* src, size_t len)
+{
+    uint64_t sum = 0;
+    while (len >= 16) {
+        size_t blocks = len / 16 < CHKSUM_SIMD_BLOCKS ? len / 16 : CHKSUM_SIMD_BLOCKS;
+        uint32x4_t acc = vdupq_n_u32(0);
+        for (size_t i = 0; i < blocks; i++, src += 16, dst += 16) {
+            uint8x16_t v = vld1q_u8(src);
+            if (copy) {
+                vst1q_u8(dst, v);
+            }
+            acc = vpadalq_u16(acc, vreinterpretq_u16_u8(v));
+        }
+        len -= blocks * 16;
+        sum += vaddlvq_u32(acc);
+    }
+    return chksum_fold(chksum_tail<copy>(dst, src, len, sum));
+}
+#endif
+
+struct chksum_kernel {
+    const char* name;
+    chksum_fn sum;
+    chksum_fn sum_copy;
+};
+
+static chksum_kernel chksum_select()
+{
+#ifdef CHKSUM_HAVE_AVX2
+    if (chksum_cpu_has_avx2()) {
+        return { "avx2", chksum_avx2<false>, chksum_avx2<true> };
+    }
+#endif
+#ifdef CHKSUM_HAVE_SSE2
+    return { "sse2", chksum_sse2<false>, chksum_sse2<true> };
+#elif defined(CHKSUM_HAVE_NEON)
+    return { "neon", chksum_neon<false>, chksum_neon<true> };
+#else
+    return { "generic", chksum_generic<false>, chksum_generic<true> };
+#endif
+}
+
+static const chksum_kernel chksum_impl = chksum_select();
+
+}   // namespace ZeroTier
+
+using namespace ZeroTier;
+
+extern "C" uint16_t zts_chksum(const void* data, int len)
+{
+    if (len <= 0) {
+        return 0;
+    }
+    // Headers alone (e.g. IPv4) are too short to fill a vector
+    if (len < 32) {
+        return chksum_generic<false>((uint8_t*)data, (const uint8_t*)data, (size_t)len);
+    }
+    // Nothing is stored when not copying
+    return chksum_impl.sum((uint8_t*)data, (const uint8_t*)data, (size_t)len);
+}
+
+extern "C" uint16_t zts_chksum_copy(void* dst, const void* src, uint16_t len)
+{
+    return chksum_impl.sum_copy((uint8_t*)dst, (const uint8_t*)src, len);
+}
+
+extern "C" uint16_t zts_chksum_generic(const void* data, int len)
+{
+    if (len <= 0) {
+        return 0;
+    }
+    return chksum_generic<false>((uint8_t*)data, (const uint8_t*)data, (size_t)len);
+}
+
+extern "C" const char* zts_chksum_kernel(void)
+{
+    return chksum_impl.name;
+}
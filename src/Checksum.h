@@ -0,0 +1,63 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * Internet checksum (RFC 1071) used by lwIP (see LWIP_CHKSUM in lwipopts.h) and
+ * by the virtual tap driver. This file is included by lwIP and must remain
+ * valid C.
+ */
+
+#ifndef ZTS_CHECKSUM_H
+#define ZTS_CHECKSUM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Compute the one's complement sum of a buffer, using the fastest kernel
+ * supported by the CPU. Same semantics as lwIP's `lwip_standard_chksum()`.
+ *
+ * @return The (not complemented) 16-bit sum in network byte order
+ */
+uint16_t zts_chksum(const void* data, int len);
+
+/**
+ * Copy a buffer and compute its one's complement sum in the same pass
+ *
+ * @return The (not complemented) 16-bit sum in network byte order
+ */
+uint16_t zts_chksum_copy(void* dst, const void* src, uint16_t len);
+
+/**
+ * Compute the one's complement sum of a buffer with the portable kernel. Only
+ * useful as a reference for tests and benchmarks.
+ *
+ * @return The (not complemented) 16-bit sum in network byte order
+ */
+uint16_t zts_chksum_generic(const void* data, int len);
+
+/**
+ * Return the name of the kernel used by `zts_chksum()` (e.g. `"avx2"`)
+ */
+const char* zts_chksum_kernel(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
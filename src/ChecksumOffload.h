@@ -0,0 +1,55 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * Which outgoing TCP segments get their checksum from lwIP and which from the
+ * virtual tap driver (see "Checksum offload" in VirtualTap.cpp), exposed as C
+ * so that the selftest can exercise it without a peer
+ */
+
+#ifndef ZTS_CHECKSUM_OFFLOAD_H
+#define ZTS_CHECKSUM_OFFLOAD_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Return whether a TCP segment of `tcp_len` bytes (header included) is sent
+ * in one frame over an MTU of `mtu` (0 for none), or fragmented. lwIP
+ * generates the checksum of fragmented segments.
+ *
+ * @return `1` if the segment fits, otherwise `0`
+ */
+int zts_tcp_fits_mtu(unsigned int tcp_len, int ipv6, unsigned int mtu);
+
+/**
+ * Locate the TCP header of an outgoing IPv4 or IPv6 packet of `len` bytes whose
+ * checksum the virtual tap driver fills in for a peer without checksum
+ * offload. Fragments and segments whose checksum lwIP generated are sent as
+ * they are. The first `avail` bytes of the packet are at `ip`.
+ *
+ * @return Offset of the TCP header, or -1. `tcp_len` is set to the length of
+ * the segment.
+ */
+int zts_tcp_fill_offset(const uint8_t* ip, int len, int avail, unsigned int etherType, int* tcp_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -18,9 +18,13 @@
  */
 
 #include "Events.hpp"
+#include "IdentityPool.hpp"
 #include "NodeService.hpp"
 #include "Signals.hpp"
+#include "TcpSynCookies.hpp"
+#include "TcpTimeWait.hpp"
 #include "VirtualTap.hpp"
+#include "lwip/tcpip.h"
 
 #include <string.h>
 
@@ -47,6 +51,7 @@ extern void (*_userEventCallback)(void*);
 #endif
 extern uint8_t allowNetworkCaching;
 extern uint8_t allowPeerCaching;
+extern unsigned int max_sockets;
 
 NodeService* zts_service;
 Events* zts_events;
@@ -121,6 +126,66 @@ int zts_init_set_event_handler(PythonDirectorCallbackClass* callback)
     return ZTS_ERR_OK;
 }
 
+int zts_init_set_event_mask(uint64_t classes)
+{
+    ACQUIRE_SERVICE_OFFLINE();
+    if (classes & ~(uint64_t)ZTS_EVENT_CLASS_ALL) {
+        return ZTS_ERR_ARG;
+    }
+    zts_events->setMask(classes);
+    return ZTS_ERR_OK;
+}
+
+int zts_event_enable(uint64_t classes)
+{
+    Mutex::Lock _ls(service_m);
+    if (! zts_events) {
+        return ZTS_ERR_SERVICE;
+    }
+    if (classes & ~(uint64_t)ZTS_EVENT_CLASS_ALL) {
+        return ZTS_ERR_ARG;
+    }
+    zts_events->enableClasses(classes);
+    return ZTS_ERR_OK;
+}
+
+int zts_event_disable(uint64_t classes)
+{
+    Mutex::Lock _ls(service_m);
+    if (! zts_events) {
+        return ZTS_ERR_SERVICE;
+    }
+    if (classes & ~(uint64_t)ZTS_EVENT_CLASS_ALL) {
+        return ZTS_ERR_ARG;
+    }
+    zts_events->disableClasses(classes);
+    return ZTS_ERR_OK;
+}
+
+int zts_init_set_event_queue_len(unsigned int len)
+{
+    ACQUIRE_SERVICE_OFFLINE();
+    if (! len) {
+        return ZTS_ERR_ARG;
+    }
+    zts_events->setQueueLen(len);
+    return ZTS_ERR_OK;
+}
+
+int zts_event_get_stats(uint64_t event_class, zts_event_stats_t* stats)
+{
+    Mutex::Lock _ls(service_m);
+    if (! zts_events) {
+        return ZTS_ERR_SERVICE;
+    }
+    // Exactly one class
+    if (! stats || ! event_class || (event_class & (event_class - 1)) || event_class > ZTS_EVENT_CLASS_ALL) {
+        return ZTS_ERR_ARG;
+    }
+    zts_events->getStats(event_class, stats);
+    return ZTS_ERR_OK;
+}
+
 int zts_init_set_tcp_relay(const char* tcp_relay_addr, unsigned short tcp_relay_port)
 {
     ACQUIRE_SERVICE_OFFLINE();
@@ -174,6 +239,16 @@ int zts_init_set_random_port_range(unsigned short start_port, unsigned short end
     return ZTS_ERR_OK;
 }
 
+int zts_init_set_max_sockets(unsigned int max)
+{
+    ACQUIRE_SERVICE_OFFLINE();
+    if (max < 1 || max > ZTS_MAX_SOCKETS) {
+        return ZTS_ERR_ARG;
+    }
+    max_sockets = max;
+    return ZTS_ERR_OK;
+}
+
 int zts_init_allow_secondary_port(unsigned int allowed)
 {
     ACQUIRE_SERVICE_OFFLINE();
@@ -186,6 +261,12 @@ int zts_init_allow_port_mapping(unsigned int allowed)
     return zts_service->allowPortMapping(allowed);
 }
 
+int zts_init_allow_local_transport(unsigned int allowed)
+{
+    ACQUIRE_SERVICE_OFFLINE();
+    return zts_service->allowLocalTransport(allowed);
+}
+
 int zts_init_allow_peer_cache(unsigned int allowed)
 {
     ACQUIRE_SERVICE_OFFLINE();
@@ -269,15 +350,8 @@ uint64_t zts_net_compute_adhoc_id(unsigned short start_port, unsigned short end_
     return strtoull(net_id_str, NULL, 16);
 }
 
-int zts_id_new(char* key, unsigned int* dst_len)
+static int copy_id(const std::string& idser, char* key, unsigned int* dst_len)
 {
-    if (key == NULL || *dst_len != ZT_IDENTITY_STRING_BUFFER_LENGTH) {
-        return ZTS_ERR_ARG;
-    }
-    Identity id;
-    id.generate();
-    char idtmp[1024] = { 0 };
-    std::string idser = id.toString(true, idtmp);
     unsigned int key_pair_len = idser.length();
     if (key_pair_len > *dst_len) {
         return ZTS_ERR_ARG;
@@ -287,6 +361,41 @@ int zts_id_new(char* key, unsigned int* dst_len)
     return ZTS_ERR_OK;
 }
 
+int zts_id_new(char* key, unsigned int* dst_len)
+{
+    if (key == NULL || dst_len == NULL || *dst_len != ZT_IDENTITY_STRING_BUFFER_LENGTH) {
+        return ZTS_ERR_ARG;
+    }
+    return copy_id(identity_take(), key, dst_len);
+}
+
+int zts_id_pool_start(unsigned int size)
+{
+    if (size == 0) {
+        return ZTS_ERR_ARG;
+    }
+    identity_pool_resize(size);
+    return ZTS_ERR_OK;
+}
+
+int zts_id_pool_stop()
+{
+    identity_pool_resize(0);
+    return ZTS_ERR_OK;
+}
+
+int zts_id_pool_take(char* key, unsigned int* dst_len)
+{
+    if (key == NULL || dst_len == NULL || *dst_len != ZT_IDENTITY_STRING_BUFFER_LENGTH) {
+        return ZTS_ERR_ARG;
+    }
+    std::string idser;
+    if (! identity_pool_try_take(idser)) {
+        return ZTS_ERR_NO_RESULT;
+    }
+    return copy_id(idser, key, dst_len);
+}
+
 int zts_id_pair_is_valid(const char* key, unsigned int len)
 {
     if (key == NULL || len != ZT_IDENTITY_STRING_BUFFER_LENGTH) {
@@ -445,6 +554,12 @@ int zts_core_query_mc(uint64_t net_id, unsigned int idx, uint64_t* mac, uint32_t
     return zts_service->getMulticastSubAtIdx(net_id, idx, mac, adi);
 }
 
+int zts_core_query_snapshot(void* buf, unsigned int* len, uint64_t* generation)
+{
+    ACQUIRE_SERVICE(ZTS_ERR_SERVICE);
+    return zts_service->snapshot(buf, len, generation);
+}
+
 int zts_net_join(const uint64_t net_id)
 {
     ACQUIRE_SERVICE(ZTS_ERR_SERVICE);
@@ -519,6 +634,24 @@ int zts_net_get_type(uint64_t net_id)
     return zts_service->getNetworkType(net_id);
 }
 
+int zts_net_set_tx_rate(uint64_t net_id, uint64_t bytes_per_sec, unsigned int burst)
+{
+    ACQUIRE_SERVICE(ZTS_ERR_SERVICE);
+    return zts_service->setNetworkTxRate(net_id, bytes_per_sec, burst);
+}
+
+int zts_net_set_tx_class_weight(uint64_t net_id, int tx_class, unsigned int weight)
+{
+    ACQUIRE_SERVICE(ZTS_ERR_SERVICE);
+    return zts_service->setNetworkTxClassWeight(net_id, tx_class, weight);
+}
+
+int zts_net_get_tx_class_stats(uint64_t net_id, int tx_class, zts_tx_class_stats_t* stats)
+{
+    ACQUIRE_SERVICE(ZTS_ERR_SERVICE);
+    return zts_service->getNetworkTxClassStats(net_id, tx_class, stats);
+}
+
 int zts_route_is_assigned(uint64_t net_id, unsigned int family)
 {
     ACQUIRE_SERVICE(ZTS_ERR_SERVICE);
@@ -733,6 +866,16 @@ int zts_stats_get_all(zts_stats_counter_t* dst)
     dst->nd6_err = lws.nd6.chkerr + lws.nd6.lenerr + lws.nd6.memerr + lws.nd6.rterr + lws.nd6.proterr + lws.nd6.opterr
                    + lws.nd6.err;
 
+    // tcp TIME_WAIT and listen queues
+    LOCK_TCPIP_CORE();
+    tcp_tw_get_stats(&dst->tcp_time_wait, &dst->tcp_time_wait_recycled);
+    tcp_syncookie_get_stats(
+        &dst->tcp_listen_queued,
+        &dst->tcp_listen_overflows,
+        &dst->tcp_syncookies_sent,
+        &dst->tcp_syncookies_accepted);
+    UNLOCK_TCPIP_CORE();
+
     // TODO: Add mem and sys stats
 
     return ZTS_ERR_OK;
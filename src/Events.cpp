@@ -23,6 +23,10 @@
 #include "NodeService.hpp"
 #include "concurrentqueue.h"
 
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+
 #ifdef ZTS_ENABLE_JAVA
 #include <jni.h>
 #endif
@@ -77,6 +81,11 @@ void (*_userEventCallback)(void*);
 
 moodycamel::ConcurrentQueue<zts_event_msg_t*> _callbackMsgQueue;
 
+// Wakes the callback thread when an event is enqueued. Never destroyed, the
+// thread may wait on them until the process exits.
+static std::mutex& callback_wake_m = *new std::mutex;
+static std::condition_variable& callback_wake_cv = *new std::condition_variable;
+
 void Events::run()
 {
     while (getState(ZTS_STATE_CALLBACKS_RUNNING) || _callbackMsgQueue.size_approx() > 0) {
@@ -84,27 +93,149 @@ void Events::run()
         size_t sz = _callbackMsgQueue.size_approx();
         for (size_t j = 0; j < sz; j++) {
             if (_callbackMsgQueue.try_dequeue(msg)) {
+                forget(msg);
                 events_m.lock();
                 sendToUser(msg);
                 events_m.unlock();
             }
         }
-        zts_util_delay(ZTS_CALLBACK_PROCESSING_INTERVAL);
+        std::unique_lock<std::mutex> l(callback_wake_m);
+        callback_wake_cv.wait(l, [this] {
+            return ! getState(ZTS_STATE_CALLBACKS_RUNNING) || _callbackMsgQueue.size_approx() > 0;
+        });
+    }
+}
+
+/**
+ * Return the bit number of the `ZTS_EVENT_CLASS_*` of an event, or -1
+ */
+static int event_class_index(unsigned int event_code)
+{
+    if (ZTS_NODE_EVENT(event_code)) {
+        return 0;
+    }
+    if (ZTS_NETWORK_EVENT(event_code)) {
+        return 1;
+    }
+    if (ZTS_STACK_EVENT(event_code)) {
+        return 2;
+    }
+    if (ZTS_NETIF_EVENT(event_code)) {
+        return 3;
+    }
+    if (ZTS_PEER_EVENT(event_code)) {
+        return 4;
+    }
+    if (ZTS_ROUTE_EVENT(event_code)) {
+        return 5;
+    }
+    if (ZTS_ADDR_EVENT(event_code)) {
+        return 6;
+    }
+    if (ZTS_STORE_EVENT(event_code)) {
+        return 7;
+    }
+    return -1;
+}
+
+/**
+ * Return the `ZTS_EVENT_CLASS_*` of an event
+ */
+static uint64_t event_class(unsigned int event_code)
+{
+    int i = event_class_index(event_code);
+    return i < 0 ? 0 : (uint64_t)1 << i;
+}
+
+/**
+ * Return whether an event marks a change the user application must not miss:
+ * the node, the stack or a network coming up or going down
+ */
+static bool is_lifecycle_event(unsigned int event_code)
+{
+    return ZTS_NODE_EVENT(event_code) || ZTS_STACK_EVENT(event_code)
+           || (ZTS_NETWORK_EVENT(event_code) && event_code != ZTS_EVENT_NETWORK_UPDATE);
+}
+
+/**
+ * Return whether an event reports the state of a peer, address or network,
+ * and if so set `key` to what it reports on. Of two such events with the
+ * same key only the later one needs to be sent. Path events report a change
+ * rather than a state, they are never coalesced.
+ */
+static bool coalesce_key(const zts_event_msg_t* msg, std::string& key)
+{
+    uint64_t id;
+    if (msg->event_code == ZTS_EVENT_NETWORK_UPDATE && msg->network) {
+        id = msg->network->net_id;
+    }
+    else if (
+        (msg->event_code == ZTS_EVENT_PEER_DIRECT || msg->event_code == ZTS_EVENT_PEER_RELAY
+         || msg->event_code == ZTS_EVENT_PEER_UNREACHABLE)
+        && msg->peer) {
+        id = msg->peer->peer_id;
+    }
+    else if (ZTS_ADDR_EVENT(msg->event_code) && msg->addr) {
+        id = msg->addr->net_id;
+    }
+    else {
+        return false;
+    }
+    char cls = (char)event_class_index(msg->event_code);
+    key.assign(&cls, 1);
+    key.append((const char*)&id, sizeof(id));
+    if (ZTS_ADDR_EVENT(msg->event_code)) {
+        // Added and removed events of one address share a key
+        key.append((const char*)&(msg->addr->addr), sizeof(msg->addr->addr));
+    }
+    return true;
+}
+
+void Events::setMask(uint64_t classes)
+{
+    _mask = classes;
+}
+
+void Events::enableClasses(uint64_t classes)
+{
+    _mask |= classes;
+}
+
+void Events::disableClasses(uint64_t classes)
+{
+    _mask &= ~classes;
+}
+
+void Events::setQueueLen(unsigned int len)
+{
+    _queueLen = len;
+}
+
+void Events::getStats(uint64_t eventClass, zts_event_stats_t* stats)
+{
+    for (int i = 0; i < ZTS_EVENT_CLASS_COUNT; i++) {
+        if (eventClass == (uint64_t)1 << i) {
+            stats->sent = _sent[i];
+            stats->dropped = _dropped[i];
+            stats->coalesced = _coalesced[i];
+        }
     }
 }
 
+bool Events::wants(unsigned int event_code)
+{
+    return _enabled && (_mask.load(std::memory_order_relaxed) & event_class(event_code));
+}
+
 bool Events::enqueue(unsigned int event_code, const void* arg, int len)
 {
     if (! _enabled) {
         return false;
     }
-    if (_callbackMsgQueue.size_approx() > 1024) {
-        /* Rate-limit number of events. This value should only grow if the
-        user application isn't returning from the event handler in a timely manner.
-        For most applications it should hover around 1 to 2 */
+    // Always queued, the callback thread stops once it has handled it
+    if (event_code != ZTS_EVENT_STACK_DOWN && ! wants(event_code)) {
         return false;
     }
-    
     zts_event_msg_t* msg = new zts_event_msg_t();
     msg->event_code = event_code;
 
@@ -140,13 +271,63 @@ bool Events::enqueue(unsigned int event_code, const void* arg, int len)
         msg->len = len;
     }
 
-    //
-    // ownership of arg is now transferred
-    //
-    _callbackMsgQueue.enqueue(msg);
+    int cls = event_class_index(event_code);
+    std::string key;
+    {
+        std::lock_guard<std::mutex> l(_pending_m);
+        if (coalesce_key(msg, key)) {
+            std::map<std::string, zts_event_msg_t*>::iterator p = _pending.find(key);
+            if (p != _pending.end()) {
+                // Takes the place of the queued event, whose contents are freed
+                std::swap(*(p->second), *msg);
+                destroy(msg);
+                _coalesced[cls]++;
+                return true;
+            }
+        }
+        /* The queue should only grow if the user application isn't returning
+        from the event handler in a timely manner. For most applications it
+        should hover around 1 to 2 */
+        if (! is_lifecycle_event(event_code) && _callbackMsgQueue.size_approx() >= _queueLen) {
+            delete msg;
+            if (cls >= 0) {
+                _dropped[cls]++;
+            }
+            return false;
+        }
+        if (! key.empty()) {
+            _pending[key] = msg;
+        }
+        else if (is_lifecycle_event(event_code)) {
+            // Later state events queue behind it, so that none reaches the
+            // user application before it
+            _pending.clear();
+        }
+        //
+        // ownership of arg is now transferred
+        //
+        _callbackMsgQueue.enqueue(msg);
+    }
+    {
+        std::lock_guard<std::mutex> l(callback_wake_m);
+    }
+    callback_wake_cv.notify_one();
     return true;
 }
 
+void Events::forget(zts_event_msg_t* msg)
+{
+    std::lock_guard<std::mutex> l(_pending_m);
+    std::string key;
+    if (coalesce_key(msg, key)) {
+        // Unless a later event with this key was queued behind a lifecycle event
+        std::map<std::string, zts_event_msg_t*>::iterator p = _pending.find(key);
+        if (p != _pending.end() && p->second == msg) {
+            _pending.erase(p);
+        }
+    }
+}
+
 void Events::destroy(zts_event_msg_t* msg)
 {
     if (! msg) {
@@ -177,44 +358,48 @@ void Events::destroy(zts_event_msg_t* msg)
 void Events::sendToUser(zts_event_msg_t* msg)
 {
     bool bShouldStopCallbackThread = (msg->event_code == ZTS_EVENT_STACK_DOWN);
+    // Its class may have been disabled since the event was queued
+    if (_mask.load(std::memory_order_relaxed) & event_class(msg->event_code)) {
+        _sent[event_class_index(msg->event_code)]++;
 #ifdef ZTS_ENABLE_PYTHON
-    PyGILState_STATE state = PyGILState_Ensure();
-    _userEventCallback->on_zerotier_event(msg);
-    PyGILState_Release(state);
+        PyGILState_STATE state = PyGILState_Ensure();
+        _userEventCallback->on_zerotier_event(msg);
+        PyGILState_Release(state);
 #endif
 #ifdef ZTS_ENABLE_JAVA
-    if (javaCbMethodId) {
-        JNIEnv* env;
+        if (javaCbMethodId) {
+            JNIEnv* env;
 #if defined(__ANDROID__)
-        jvm->AttachCurrentThread(&env, NULL);
+            jvm->AttachCurrentThread(&env, NULL);
 #else
-        jvm->AttachCurrentThread((void**)&env, NULL);
+            jvm->AttachCurrentThread((void**)&env, NULL);
 #endif
-        uint64_t id = 0;
-        if (ZTS_NODE_EVENT(msg->event_code)) {
-            id = msg->node ? msg->node->node_id : 0;
-        }
-        if (ZTS_NETWORK_EVENT(msg->event_code)) {
-            id = msg->network ? msg->network->net_id : 0;
-        }
-        if (ZTS_PEER_EVENT(msg->event_code)) {
-            id = msg->peer ? msg->peer->peer_id : 0;
-        }
-        env->CallVoidMethod(javaCbObjRef, javaCbMethodId, id, msg->event_code);
+            uint64_t id = 0;
+            if (ZTS_NODE_EVENT(msg->event_code)) {
+                id = msg->node ? msg->node->node_id : 0;
+            }
+            if (ZTS_NETWORK_EVENT(msg->event_code)) {
+                id = msg->network ? msg->network->net_id : 0;
+            }
+            if (ZTS_PEER_EVENT(msg->event_code)) {
+                id = msg->peer ? msg->peer->peer_id : 0;
+            }
+            env->CallVoidMethod(javaCbObjRef, javaCbMethodId, id, msg->event_code);
 
-        jvm->DetachCurrentThread();
-    }
+            jvm->DetachCurrentThread();
+        }
 #endif   // ZTS_ENABLE_JAVA
 #ifdef ZTS_ENABLE_PINVOKE
-    if (_userEventCallback) {
-        _userEventCallback(msg);
-    }
+        if (_userEventCallback) {
+            _userEventCallback(msg);
+        }
 #endif
 #ifdef ZTS_C_API_ONLY
-    if (_userEventCallback) {
-        _userEventCallback(msg);
-    }
+        if (_userEventCallback) {
+            _userEventCallback(msg);
+        }
 #endif
+    }
     destroy(msg);
     if (bShouldStopCallbackThread) {
         /* Ensure last possible callback ZTS_EVENT_STACK_DOWN is
@@ -22,6 +22,11 @@
 
 #include "ZeroTierSockets.h"
 
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+
 #ifdef __WINDOWS__
 #include <basetsd.h>
 #endif
@@ -90,12 +95,37 @@ inline int transport_ok()
  */
 #define ZTS_CALLBACK_PROCESSING_INTERVAL 25
 
+/**
+ * Number of ZTS_EVENT_CLASS_* bits
+ */
+#define ZTS_EVENT_CLASS_COUNT 8
+
 class Events {
     bool _enabled;
+    std::atomic<uint64_t> _mask;
+    unsigned int _queueLen;
+
+    // Queued events that a later one may replace, by coalesce_key()
+    std::map<std::string, zts_event_msg_t*> _pending;
+    std::mutex _pending_m;
+
+    std::atomic<uint64_t> _sent[ZTS_EVENT_CLASS_COUNT];
+    std::atomic<uint64_t> _dropped[ZTS_EVENT_CLASS_COUNT];
+    std::atomic<uint64_t> _coalesced[ZTS_EVENT_CLASS_COUNT];
+
+    /**
+     * Remove a dequeued event from the pending events
+     */
+    void forget(zts_event_msg_t* msg);
 
   public:
-    Events() : _enabled(false)
+    Events() : _enabled(false), _mask(ZTS_EVENT_CLASS_ALL), _queueLen(ZTS_EVENT_QUEUE_DEFAULT_LEN)
     {
+        for (int i = 0; i < ZTS_EVENT_CLASS_COUNT; i++) {
+            _sent[i] = 0;
+            _dropped[i] = 0;
+            _coalesced[i] = 0;
+        }
     }
 
     /**
@@ -114,8 +144,42 @@ class Events {
     void disable();
 
     /**
-     * Enqueue an event to be sent to the user application
-     * 
+     * Set the classes of events sent to the user application
+     */
+    void setMask(uint64_t classes);
+
+    /**
+     * Add classes of events sent to the user application
+     */
+    void enableClasses(uint64_t classes);
+
+    /**
+     * Remove classes of events sent to the user application
+     */
+    void disableClasses(uint64_t classes);
+
+    /**
+     * Set the number of events that may wait for the user application
+     */
+    void setQueueLen(unsigned int len);
+
+    /**
+     * Get the counts of one event class
+     */
+    void getStats(uint64_t eventClass, zts_event_stats_t* stats);
+
+    /**
+     * Return whether an event would be sent to the user application. Checked
+     * before an event is built.
+     */
+    bool wants(unsigned int event_code);
+
+    /**
+     * Enqueue an event to be sent to the user application. Lifecycle events
+     * are always queued, state events replace a queued one with the same
+     * coalesce_key() (unless a lifecycle event was queued since) and any other
+     * event is dropped if the queue is full.
+     *
      * Returns true if arg was enqueued.
      * If enqueued, then ownership of arg has been transferred.
      * If NOT enqueued, then ownership of arg has NOT been transferred.
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * Parallel and pre-generated identity creation
+ *
+ * Generating an identity means trying key pairs until the memory-hard hash of
+ * one meets the hashcash criterion, about 15 tries on average. Identity only
+ * offers this as a whole, so instead of splitting one search, every core runs
+ * its own and the first identity found is used. The number of identities
+ * wanted is the pool size plus the number of callers waiting, workers stop
+ * starting new searches once it is met and discard what searches in progress
+ * find beyond it.
+ */
+
+#include "IdentityPool.hpp"
+
+#include "Identity.hpp"
+#include "Thread.hpp"
+#include "Utils.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace ZeroTier {
+
+class IdentityWorker {
+  public:
+    void threadMain() throw();
+};
+
+// Never destroyed, workers use them until the process exits
+static std::mutex& pool_m = *new std::mutex;
+static std::condition_variable& pool_cv = *new std::condition_variable;   // `ready` or demand changed
+static std::deque<std::string>& ready = *new std::deque<std::string>;
+static unsigned int pool_size = 0;
+static unsigned int waiting = 0;
+static unsigned int workers = 0;
+static IdentityWorker worker;
+
+static bool identity_wanted()
+{
+    return ready.size() < pool_size + waiting;
+}
+
+static std::string identity_generate()
+{
+    Identity id;
+    id.generate();
+    char buf[ZT_IDENTITY_STRING_BUFFER_LENGTH] = { 0 };
+    std::string s(id.toString(true, buf));
+    Utils::burn(buf, sizeof(buf));
+    return s;
+}
+
+void IdentityWorker::threadMain() throw()
+{
+    std::unique_lock<std::mutex> l(pool_m);
+    while (true) {
+        pool_cv.wait(l, identity_wanted);
+        l.unlock();
+        std::string id = identity_generate();
+        l.lock();
+        if (identity_wanted()) {
+            ready.push_back(id);
+            pool_cv.notify_all();
+        }
+    }
+}
+
+/**
+ * Start one worker per core, once. They wait for demand when there is none.
+ * Called with `pool_m` held.
+ */
+static void identity_start_workers()
+{
+    if (workers) {
+        return;
+    }
+    unsigned int n = std::thread::hardware_concurrency();
+    for (unsigned int i = 0; i < (n ? n : 1); i++) {
+        try {
+            Thread::start(&worker);
+            workers++;
+        }
+        catch (...) {
+            break;
+        }
+    }
+}
+
+std::string identity_take()
+{
+    std::unique_lock<std::mutex> l(pool_m);
+    if (ready.empty()) {
+        identity_start_workers();
+        if (! workers) {
+            l.unlock();
+            return identity_generate();
+        }
+        waiting++;
+        pool_cv.notify_all();
+        pool_cv.wait(l, [] { return ! ready.empty(); });
+        waiting--;
+    }
+    std::string id = ready.front();
+    ready.pop_front();
+    pool_cv.notify_all();   // Refill the pool
+    return id;
+}
+
+bool identity_pool_try_take(std::string& id)
+{
+    std::unique_lock<std::mutex> l(pool_m);
+    if (ready.empty()) {
+        return false;
+    }
+    id = ready.front();
+    ready.pop_front();
+    pool_cv.notify_all();
+    return true;
+}
+
+void identity_pool_resize(unsigned int size)
+{
+    std::unique_lock<std::mutex> l(pool_m);
+    pool_size = size;
+    if (size > 0) {
+        identity_start_workers();
+    }
+    while (ready.size() > pool_size + waiting) {
+        ready.pop_back();
+    }
+    pool_cv.notify_all();
+}
+
+}   // namespace ZeroTier
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * Parallel and pre-generated identity creation
+ */
+
+#ifndef ZTS_IDENTITY_POOL_HPP
+#define ZTS_IDENTITY_POOL_HPP
+
+#include <string>
+
+namespace ZeroTier {
+
+/**
+ * Return a new identity (secret key-pair string): a pre-generated one if the
+ * pool has one, otherwise the first one generated by a worker on each core
+ */
+std::string identity_take();
+
+/**
+ * Return a pre-generated identity, if the pool has one
+ *
+ * @return Whether `id` was set
+ */
+bool identity_pool_try_take(std::string& id);
+
+/**
+ * Keep `size` identities generated in the background (0 discards them and
+ * stops generating)
+ */
+void identity_pool_resize(unsigned int size);
+
+}   // namespace ZeroTier
+
+#endif
@@ -0,0 +1,686 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * Shared-memory transport between libzt nodes on the same host
+ *
+ * Files in the rendezvous directory (/dev/shm/libzt-<uid>, or /tmp/libzt-<uid>
+ * where there is no /dev/shm):
+ *
+ * - <node>.sock: Datagram socket of a node, receives the messages below
+ * - <from>-<to>.ring: Frames from one node to another, created by the sender
+ *
+ * Messages:
+ *
+ * - HELLO: The sender accepts our frames on a network, and its ring for us
+ *   exists. Answered with our own HELLOs if the sender is a new process.
+ * - BYE: The sender no longer accepts our frames on a network
+ * - DOORBELL: The sender wrote to its ring for us while we were asleep
+ */
+
+#include "LocalTransport.hpp"
+
+#include "OSUtils.hpp"
+
+#ifndef __WINDOWS__
+#include <algorithm>
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+#endif
+
+#define ZTS_LOCAL_MAGIC 0x7a74736c   // "ztsl"
+#define ZTS_LOCAL_PAD   0xffffffff   // Record length marking the unused end of the ring
+
+#define ZTS_LOCAL_MSG_HELLO    1
+#define ZTS_LOCAL_MSG_BYE      2
+#define ZTS_LOCAL_MSG_DOORBELL 3
+
+namespace ZeroTier {
+
+LocalTransport::Peer::Peer() : tx(NULL), rx(NULL), rxInode(0), pid(0), local(false), lastProbe(0), dead(false)
+{
+}
+
+void LocalTransport::revalidationFrame(uint8_t frame[ZTS_LOCAL_REVALIDATE_FRAME_LEN])
+{
+    memset(frame, 0, ZTS_LOCAL_REVALIDATE_FRAME_LEN);
+    frame[0] = 0x60;   // Version 6
+    frame[6] = 59;     // No next header
+}
+
+bool LocalTransport::isRevalidationFrame(unsigned int etherType, const void* data, unsigned int len)
+{
+    const uint8_t* ip = (const uint8_t*)data;
+    // Payload length 0, no next header
+    return etherType == 0x86dd && len == ZTS_LOCAL_REVALIDATE_FRAME_LEN && (ip[0] >> 4) == 6 && ! ip[4] && ! ip[5]
+           && ip[6] == 59;
+}
+
+#ifndef __WINDOWS__
+
+struct LocalMessage {
+    uint32_t magic;
+    uint32_t type;
+    uint64_t node;
+    uint64_t net_id;
+    int32_t pid;
+    uint32_t reserved;
+};
+
+/**
+ * Header of a ring, followed by ZTS_LOCAL_RING_SIZE bytes of records. Positions
+ * count bytes since the ring was created and wrap around at 2^32. The sender
+ * and the receiver each write to their own cache line.
+ */
+struct LocalRing {
+    uint32_t magic;
+    uint32_t size;
+    uint8_t pad0[56];
+    std::atomic<uint32_t> head;      // Written by the sender
+    std::atomic<uint32_t> waiting;   // Set by the receiver before it sleeps
+    uint8_t pad1[56];
+    std::atomic<uint32_t> tail;   // Written by the receiver
+    uint8_t pad2[60];
+
+    uint8_t* data()
+    {
+        return reinterpret_cast<uint8_t*>(this + 1);
+    }
+};
+
+/**
+ * Record in a ring, followed by the frame and padded to 8 bytes
+ */
+struct LocalRecord {
+    uint32_t len;   // Of the frame, or ZTS_LOCAL_PAD
+    uint16_t etherType;
+    uint16_t vlanId;
+    uint64_t net_id;
+    uint64_t from;
+    uint64_t to;
+};
+
+#define ZTS_LOCAL_RING_BYTES (sizeof(LocalRing) + ZTS_LOCAL_RING_SIZE)
+
+static uint32_t local_record_size(uint32_t len)
+{
+    return (uint32_t)((sizeof(LocalRecord) + len + 7) & ~(size_t)7);
+}
+
+static LocalRing* local_ring_map(int fd)
+{
+    void* m = mmap(NULL, ZTS_LOCAL_RING_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return m == MAP_FAILED ? NULL : (LocalRing*)m;
+}
+
+static void local_ring_unmap(LocalRing* r)
+{
+    if (r) {
+        munmap(r, ZTS_LOCAL_RING_BYTES);
+    }
+}
+
+static LocalRing* local_ring_create(const std::string& path)
+{
+    ::unlink(path.c_str());
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return NULL;
+    }
+    // The file is zero-filled, i.e. the ring is empty
+    LocalRing* r = (ftruncate(fd, ZTS_LOCAL_RING_BYTES) == 0) ? local_ring_map(fd) : NULL;
+    ::close(fd);
+    if (! r) {
+        ::unlink(path.c_str());
+        return NULL;
+    }
+    r->size = ZTS_LOCAL_RING_SIZE;
+    r->magic = ZTS_LOCAL_MAGIC;
+    return r;
+}
+
+LocalTransport::LocalTransport(
+    uint64_t nodeId,
+    void (*handler)(void*, uint64_t, const MAC&, const MAC&, unsigned int, unsigned int, const void*, unsigned int),
+    void (*batchHandler)(void*),
+    void* arg)
+    : _handler(handler)
+    , _batchHandler(batchHandler)
+    , _arg(arg)
+    , _nodeId(nodeId)
+    , _fd(-1)
+    , _run(false)
+{
+}
+
+LocalTransport::~LocalTransport()
+{
+    if (_run) {
+        _run = false;
+        ::write(_shutdownSignalPipe[1], "\0", 1);
+        Thread::join(_thread);
+        ::close(_shutdownSignalPipe[0]);
+        ::close(_shutdownSignalPipe[1]);
+    }
+    Mutex::Lock _l(_peers_m);
+    for (std::map<uint64_t, Peer>::iterator i(_peers.begin()); i != _peers.end(); ++i) {
+        // Peers stop sending to us at once instead of noticing that we exited
+        if (i->second.local) {
+            for (std::map<uint64_t, int64_t>::iterator a(i->second.authorized.begin());
+                 a != i->second.authorized.end();
+                 ++a) {
+                _hello(i->first, i->second, a->first, ZTS_LOCAL_MSG_BYE);
+            }
+        }
+        _drop(i->first, i->second);
+    }
+    _peers.clear();
+    if (_fd >= 0) {
+        ::close(_fd);
+        ::unlink(_sockPath(_nodeId).c_str());
+    }
+}
+
+bool LocalTransport::start()
+{
+    char dir[128] = { 0 };
+    OSUtils::ztsnprintf(
+        dir,
+        sizeof(dir),
+        "%s/libzt-%u",
+        OSUtils::fileExists("/dev/shm", false) ? "/dev/shm" : "/tmp",
+        (unsigned int)getuid());
+    _dir = dir;
+    ::mkdir(dir, 0700);
+    // Anyone who can write here can inject frames, make sure only we can
+    struct stat st;
+    if (lstat(dir, &st) != 0 || ! S_ISDIR(st.st_mode) || st.st_uid != getuid() || (st.st_mode & 077)) {
+        return false;
+    }
+    // Rings left behind by an earlier process with this identity
+    char prefix[32] = { 0 };
+    OSUtils::ztsnprintf(prefix, sizeof(prefix), "%.10llx-", (unsigned long long)_nodeId);
+    std::vector<std::string> files(OSUtils::listDirectory(dir));
+    for (std::vector<std::string>::iterator f(files.begin()); f != files.end(); ++f) {
+        if (f->compare(0, strlen(prefix), prefix) == 0) {
+            ::unlink((_dir + "/" + *f).c_str());
+        }
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::string path(_sockPath(_nodeId));
+    if (path.length() >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    memcpy(addr.sun_path, path.c_str(), path.length());
+    _fd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (_fd < 0) {
+        return false;
+    }
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+    fcntl(_fd, F_SETFD, FD_CLOEXEC);
+    ::unlink(path.c_str());
+    if (::bind(_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || ::pipe(_shutdownSignalPipe) != 0) {
+        ::close(_fd);
+        _fd = -1;
+        return false;
+    }
+    _run = true;
+    _thread = Thread::start(this);
+    return true;
+}
+
+void LocalTransport::authorize(uint64_t net_id, uint64_t peer)
+{
+    if (peer == _nodeId) {
+        return;
+    }
+    const int64_t now = OSUtils::now();
+    Mutex::Lock _l(_peers_m);
+    Peer& p = _peers[peer];
+    int64_t& last = p.authorized[net_id];
+    const bool renewed = (now - last) >= ZTS_LOCAL_AUTH_TIMEOUT;
+    last = now;
+    if (renewed && _probe(peer, p, now)) {
+        _hello(peer, p, net_id, ZTS_LOCAL_MSG_HELLO);
+    }
+}
+
+void LocalTransport::revoke(uint64_t net_id)
+{
+    Mutex::Lock _l(_peers_m);
+    for (std::map<uint64_t, Peer>::iterator i(_peers.begin()); i != _peers.end(); ++i) {
+        Peer& p = i->second;
+        if (p.authorized.erase(net_id) && p.local) {
+            _hello(i->first, p, net_id, ZTS_LOCAL_MSG_BYE);
+        }
+        p.accepted.erase(net_id);
+        p.lastCoreSend.erase(net_id);
+    }
+}
+
+bool LocalTransport::send(
+    uint64_t net_id,
+    const MAC& from,
+    const MAC& to,
+    unsigned int etherType,
+    unsigned int vlanId,
+    const void* data,
+    unsigned int len,
+    bool& revalidate)
+{
+    // Bridged frames carry a source MAC that isn't ours, leave them to the core
+    if (to.isMulticast() || from.toAddress(net_id).toInt() != _nodeId) {
+        return false;
+    }
+    const uint64_t peer = to.toAddress(net_id).toInt();
+    const int64_t now = OSUtils::now();
+    Mutex::Lock _l(_peers_m);
+    std::map<uint64_t, Peer>::iterator i(_peers.find(peer));
+    if (i == _peers.end() || ! i->second.tx || ! i->second.accepted.count(net_id)) {
+        return false;
+    }
+    // Whether the peer accepts us is up to its core (see LocalTransport.hpp),
+    // our own view of the peer only decides what we accept from it
+    Peer& p = i->second;
+    int64_t& lastCoreSend = p.lastCoreSend[net_id];
+    if ((now - lastCoreSend) >= ZTS_LOCAL_REVALIDATE_INTERVAL) {
+        lastCoreSend = now;
+        revalidate = true;
+    }
+
+    LocalRing* r = p.tx;
+    uint32_t head = r->head.load(std::memory_order_relaxed);
+    const uint32_t tail = r->tail.load(std::memory_order_acquire);
+    const uint32_t off = head & (ZTS_LOCAL_RING_SIZE - 1);
+    const uint32_t need = local_record_size(len);
+    const uint32_t pad = (off + need > ZTS_LOCAL_RING_SIZE) ? ZTS_LOCAL_RING_SIZE - off : 0;
+    if (ZTS_LOCAL_RING_SIZE - (head - tail) < pad + need) {
+        return false;   // Full, the core path still works
+    }
+    if (pad) {
+        reinterpret_cast<LocalRecord*>(r->data() + off)->len = ZTS_LOCAL_PAD;
+        head += pad;
+    }
+    LocalRecord* rec = reinterpret_cast<LocalRecord*>(r->data() + (head & (ZTS_LOCAL_RING_SIZE - 1)));
+    rec->len = len;
+    rec->etherType = (uint16_t)etherType;
+    rec->vlanId = (uint16_t)vlanId;
+    rec->net_id = net_id;
+    rec->from = from.toInt();
+    rec->to = to.toInt();
+    memcpy(rec + 1, data, len);
+    r->head.store(head + need);
+    if (r->waiting.exchange(0)) {
+        _hello(peer, p, 0, ZTS_LOCAL_MSG_DOORBELL);
+    }
+    return true;
+}
+
+void LocalTransport::threadMain() throw()
+{
+    int64_t lastHousekeeping = 0;
+    bool hasPeers = true;
+    while (_run) {
+        // Messages first, a HELLO may bring a new ring
+        LocalMessage msg;
+        ssize_t n;
+        while ((n = ::recv(_fd, &msg, sizeof(msg), 0)) > 0) {
+            _onMessage(&msg, (unsigned int)n);
+        }
+        const int64_t now = OSUtils::now();
+        if ((now - lastHousekeeping) >= ZTS_LOCAL_HOUSEKEEPING_INTERVAL) {
+            lastHousekeeping = now;
+            hasPeers = _housekeeping(now);
+        }
+        if (_drain()) {
+            continue;
+        }
+        // Ask senders for a doorbell, then make sure nothing arrived before
+        // they could see that
+        _setWaiting(1);
+        if (! _drain()) {
+            struct pollfd fds[2];
+            fds[0].fd = _fd;
+            fds[0].events = POLLIN;
+            fds[1].fd = _shutdownSignalPipe[0];
+            fds[1].events = POLLIN;
+            // Without peers, housekeeping only needs to catch one that the
+            // core authorized meanwhile within its authorization timeout
+            poll(fds, 2, hasPeers ? ZTS_LOCAL_HOUSEKEEPING_INTERVAL : ZTS_LOCAL_AUTH_TIMEOUT);
+        }
+        _setWaiting(0);
+    }
+}
+
+bool LocalTransport::_probe(uint64_t peerId, Peer& p, int64_t now)
+{
+    if (p.lastProbe && (now - p.lastProbe) < ZTS_LOCAL_AUTH_TIMEOUT) {
+        return p.local;
+    }
+    p.lastProbe = now;
+    struct stat st;
+    p.local = stat(_sockPath(peerId).c_str(), &st) == 0 && S_ISSOCK(st.st_mode);
+    return p.local;
+}
+
+void LocalTransport::_hello(uint64_t peerId, Peer& p, uint64_t net_id, unsigned int type)
+{
+    if (type == ZTS_LOCAL_MSG_HELLO && ! p.tx) {
+        if (! (p.tx = local_ring_create(_ringPath(_nodeId, peerId)))) {
+            return;
+        }
+    }
+    LocalMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.magic = ZTS_LOCAL_MAGIC;
+    msg.type = type;
+    msg.node = _nodeId;
+    msg.net_id = net_id;
+    msg.pid = (int32_t)getpid();
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::string path(_sockPath(peerId));
+    memcpy(addr.sun_path, path.c_str(), std::min(path.length(), sizeof(addr.sun_path) - 1));
+    if (::sendto(_fd, &msg, sizeof(msg), 0, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        // A socket left behind by a process that has exited. This may run
+        // on the core's thread, _housekeeping() unmaps the rings.
+        if (type == ZTS_LOCAL_MSG_HELLO && (errno == ECONNREFUSED || errno == ENOENT)) {
+            p.dead = true;
+            p.accepted.clear();
+            p.local = false;
+        }
+    }
+}
+
+void LocalTransport::_onMessage(const void* data, unsigned int len)
+{
+    const LocalMessage* msg = (const LocalMessage*)data;
+    if (len != sizeof(LocalMessage) || msg->magic != ZTS_LOCAL_MAGIC || msg->node == _nodeId) {
+        return;
+    }
+    if (msg->type == ZTS_LOCAL_MSG_DOORBELL) {
+        return;   // Waking us up was all it had to do
+    }
+    Mutex::Lock _l(_peers_m);
+    Peer& p = _peers[msg->node];
+    if (msg->type == ZTS_LOCAL_MSG_BYE) {
+        p.accepted.erase(msg->net_id);
+        return;
+    }
+    if (msg->type != ZTS_LOCAL_MSG_HELLO) {
+        return;
+    }
+    if (p.dead) {
+        _drop(msg->node, p);
+    }
+    const bool restarted = p.pid != msg->pid;
+    if (restarted) {
+        // A new process with the same identity starts over with fresh rings
+        if (p.pid) {
+            _drop(msg->node, p);
+        }
+        p.pid = msg->pid;
+    }
+    p.local = true;
+    p.lastProbe = OSUtils::now();
+
+    // Map the peer's ring for us, unless it's the one already mapped
+    int fd = ::open(_ringPath(msg->node, _nodeId).c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_uid != getuid() || (size_t)st.st_size < ZTS_LOCAL_RING_BYTES) {
+        ::close(fd);
+        return;
+    }
+    if (! p.rx || p.rxInode != (uint64_t)st.st_ino) {
+        local_ring_unmap(p.rx);
+        p.rx = local_ring_map(fd);
+        p.rxInode = (uint64_t)st.st_ino;
+        if (p.rx && (p.rx->magic != ZTS_LOCAL_MAGIC || p.rx->size != ZTS_LOCAL_RING_SIZE)) {
+            local_ring_unmap(p.rx);
+            p.rx = NULL;
+        }
+    }
+    ::close(fd);
+    if (! p.rx) {
+        return;
+    }
+    p.accepted.insert(msg->net_id);
+
+    // Tell a new process (or one we hear from for the first time) on which
+    // networks we accept it
+    if (restarted) {
+        const int64_t now = OSUtils::now();
+        for (std::map<uint64_t, int64_t>::iterator a(p.authorized.begin()); a != p.authorized.end(); ++a) {
+            if ((now - a->second) < ZTS_LOCAL_AUTH_TIMEOUT) {
+                _hello(msg->node, p, a->first, ZTS_LOCAL_MSG_HELLO);
+            }
+        }
+    }
+}
+
+void LocalTransport::_drop(uint64_t peerId, Peer& p)
+{
+    local_ring_unmap(p.rx);
+    p.rx = NULL;
+    p.rxInode = 0;
+    if (p.tx) {
+        local_ring_unmap(p.tx);
+        p.tx = NULL;
+        ::unlink(_ringPath(_nodeId, peerId).c_str());
+    }
+    p.pid = 0;
+    p.lastProbe = 0;
+    p.accepted.clear();
+    p.dead = false;
+}
+
+bool LocalTransport::_housekeeping(int64_t now)
+{
+    Mutex::Lock _l(_peers_m);
+    for (std::map<uint64_t, Peer>::iterator i(_peers.begin()); i != _peers.end();) {
+        Peer& p = i->second;
+        if (p.dead || (p.pid && kill(p.pid, 0) != 0 && errno == ESRCH)) {
+            _drop(i->first, p);
+        }
+        // The core hasn't vouched for the peer in a while
+        for (std::map<uint64_t, int64_t>::iterator a(p.authorized.begin()); a != p.authorized.end();) {
+            if ((now - a->second) >= ZTS_LOCAL_AUTH_TIMEOUT) {
+                if (p.tx) {
+                    _hello(i->first, p, a->first, ZTS_LOCAL_MSG_BYE);
+                }
+                p.lastCoreSend.erase(a->first);
+                p.authorized.erase(a++);
+            }
+            else {
+                ++a;
+            }
+        }
+        if (p.authorized.empty() && ! p.tx && ! p.rx) {
+            _peers.erase(i++);
+        }
+        else {
+            ++i;
+        }
+    }
+    return ! _peers.empty();
+}
+
+bool LocalTransport::_drain()
+{
+    struct Source {
+        uint64_t peer;
+        LocalRing* rx;
+        std::vector<uint64_t> nets;   // On which the peer may send to us
+    };
+    std::vector<Source> sources;
+    {
+        const int64_t now = OSUtils::now();
+        Mutex::Lock _l(_peers_m);
+        for (std::map<uint64_t, Peer>::iterator i(_peers.begin()); i != _peers.end(); ++i) {
+            if (! i->second.rx) {
+                continue;
+            }
+            Source s;
+            s.peer = i->first;
+            s.rx = i->second.rx;
+            for (std::map<uint64_t, int64_t>::iterator a(i->second.authorized.begin());
+                 a != i->second.authorized.end();
+                 ++a) {
+                if ((now - a->second) < ZTS_LOCAL_AUTH_TIMEOUT) {
+                    s.nets.push_back(a->first);
+                }
+            }
+            sources.push_back(s);
+        }
+    }
+    // Rings are only unmapped by this thread (other threads mark the peer
+    // dead), no need to hold the lock while delivering (which may send frames
+    // in turn)
+    bool progress = false;
+    bool delivered = false;
+    for (std::vector<Source>::iterator s(sources.begin()); s != sources.end(); ++s) {
+        LocalRing* r = s->rx;
+        uint32_t tail = r->tail.load(std::memory_order_relaxed);
+        const uint32_t head = r->head.load(std::memory_order_acquire);
+        if (tail == head) {
+            continue;
+        }
+        progress = true;
+        while (tail != head) {
+            const uint32_t off = tail & (ZTS_LOCAL_RING_SIZE - 1);
+            const LocalRecord* rec = reinterpret_cast<const LocalRecord*>(r->data() + off);
+            if (rec->len == ZTS_LOCAL_PAD) {
+                tail += ZTS_LOCAL_RING_SIZE - off;
+                continue;
+            }
+            const uint32_t need = local_record_size(rec->len);
+            if (rec->len > ZTS_LOCAL_RING_SIZE || off + need > ZTS_LOCAL_RING_SIZE || need > head - tail) {
+                tail = head;   // Corrupt, discard everything
+                break;
+            }
+            const MAC from(rec->from);
+            const MAC to(rec->to);
+            if (std::find(s->nets.begin(), s->nets.end(), rec->net_id) != s->nets.end()
+                && from.toAddress(rec->net_id).toInt() == s->peer
+                && to.toAddress(rec->net_id).toInt() == _nodeId) {
+                _handler(_arg, rec->net_id, from, to, rec->etherType, rec->vlanId, rec + 1, rec->len);
+                delivered = true;
+            }
+            tail += need;
+        }
+        r->tail.store(tail, std::memory_order_release);
+    }
+    if (delivered) {
+        _batchHandler(_arg);
+    }
+    return progress;
+}
+
+void LocalTransport::_setWaiting(uint32_t waiting)
+{
+    Mutex::Lock _l(_peers_m);
+    for (std::map<uint64_t, Peer>::iterator i(_peers.begin()); i != _peers.end(); ++i) {
+        if (i->second.rx) {
+            i->second.rx->waiting.store(waiting);
+        }
+    }
+}
+
+std::string LocalTransport::_sockPath(uint64_t node) const
+{
+    char name[32] = { 0 };
+    OSUtils::ztsnprintf(name, sizeof(name), "/%.10llx.sock", (unsigned long long)node);
+    return _dir + name;
+}
+
+std::string LocalTransport::_ringPath(uint64_t from, uint64_t to) const
+{
+    char name[48] = { 0 };
+    OSUtils::ztsnprintf(name, sizeof(name), "/%.10llx-%.10llx.ring", (unsigned long long)from, (unsigned long long)to);
+    return _dir + name;
+}
+
+#else   // __WINDOWS__
+
+// Not available, every frame goes through the core
+
+LocalTransport::LocalTransport(
+    uint64_t nodeId,
+    void (*handler)(void*, uint64_t, const MAC&, const MAC&, unsigned int, unsigned int, const void*, unsigned int),
+    void (*batchHandler)(void*),
+    void* arg)
+    : _handler(handler)
+    , _batchHandler(batchHandler)
+    , _arg(arg)
+    , _nodeId(nodeId)
+    , _fd(-1)
+    , _run(false)
+{
+}
+
+LocalTransport::~LocalTransport()
+{
+}
+
+bool LocalTransport::start()
+{
+    return false;
+}
+
+void LocalTransport::authorize(uint64_t, uint64_t)
+{
+}
+
+void LocalTransport::revoke(uint64_t)
+{
+}
+
+bool LocalTransport::send(
+    uint64_t,
+    const MAC&,
+    const MAC&,
+    unsigned int,
+    unsigned int,
+    const void*,
+    unsigned int,
+    bool&)
+{
+    return false;
+}
+
+void LocalTransport::threadMain() throw()
+{
+}
+
+#endif   // __WINDOWS__
+
+}   // namespace ZeroTier
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * Shared-memory transport between libzt nodes on the same host
+ */
+
+#ifndef ZTS_LOCAL_TRANSPORT_HPP
+#define ZTS_LOCAL_TRANSPORT_HPP
+
+#include "MAC.hpp"
+#include "Mutex.hpp"
+#include "Thread.hpp"
+
+#include <map>
+#include <set>
+#include <stdint.h>
+#include <string>
+
+// Bytes of frames that may be in flight from one node to another (power of 2)
+#define ZTS_LOCAL_RING_SIZE (4 * 1024 * 1024)
+// A peer may exchange frames over shared memory for this long (ms) after the
+// core last delivered a frame from it
+#define ZTS_LOCAL_AUTH_TIMEOUT 60000
+// How often (ms) an empty frame is sent to a peer through the core, so that
+// the peer's core keeps vouching for this node
+#define ZTS_LOCAL_REVALIDATE_INTERVAL (ZTS_LOCAL_AUTH_TIMEOUT / 4)
+// Length of that frame: an IPv6 header without payload or next header
+#define ZTS_LOCAL_REVALIDATE_FRAME_LEN 40
+// How often (ms) peers are checked for expired authorizations and exited
+// processes
+#define ZTS_LOCAL_HOUSEKEEPING_INTERVAL 1000
+
+namespace ZeroTier {
+
+struct LocalRing;
+
+/**
+ * Carries frames between the taps of libzt nodes that run in different
+ * processes on the same host, bypassing encryption and the kernel's UDP path.
+ *
+ * Nodes find each other through a Unix socket named after their node ID in a
+ * directory only accessible to the current user. Each node writes the frames
+ * for a peer into a ring in a shared file that the peer maps, and rings a
+ * doorbell on the peer's socket when the peer is asleep.
+ *
+ * The core still decides who may talk to whom: a node accepts frames from a
+ * peer on a network over this path only after its core has delivered a frame
+ * from that peer on that network (see authorize()), and tells the peer so. To
+ * keep that decision current, every ZTS_LOCAL_REVALIDATE_INTERVAL an empty
+ * frame (see revalidationFrame()) is sent to the peer through the core while
+ * data keeps flowing here, and authorizations the core hasn't renewed within
+ * ZTS_LOCAL_AUTH_TIMEOUT are withdrawn. Flow rules of the network are only
+ * applied by the core, i.e. not to frames carried here. A network whose rules
+ * drop the empty frame falls back to the core path every
+ * ZTS_LOCAL_AUTH_TIMEOUT until the core delivers other traffic again.
+ */
+class LocalTransport {
+  public:
+    LocalTransport(
+        uint64_t nodeId,
+        void (*handler)(void*, uint64_t, const MAC&, const MAC&, unsigned int, unsigned int, const void*, unsigned int),
+        void (*batchHandler)(void*),
+        void* arg);
+
+    ~LocalTransport();
+
+    /**
+     * Bind the rendezvous socket and start receiving
+     *
+     * @return Whether the transport is available on this host
+     */
+    bool start();
+
+    /**
+     * Record that the core has delivered a frame from `peer` on `net_id`. Called
+     * for every frame the core delivers.
+     */
+    void authorize(uint64_t net_id, uint64_t peer);
+
+    /**
+     * Withdraw all authorizations on a network, e.g. when it goes down
+     */
+    void revoke(uint64_t net_id);
+
+    /**
+     * Send a frame to the peer owning `to` over shared memory
+     *
+     * @param revalidate Set if a revalidation frame is due on the core path
+     * @return `true` if sent, otherwise the frame must go through the core
+     */
+    bool send(
+        uint64_t net_id,
+        const MAC& from,
+        const MAC& to,
+        unsigned int etherType,
+        unsigned int vlanId,
+        const void* data,
+        unsigned int len,
+        bool& revalidate);
+
+    /**
+     * Write the frame sent through the core to revalidate a peer: an IPv6
+     * header (ethertype 0x86dd) without payload or next header. It passes the
+     * usual flow rules, carries nothing and is discarded on arrival, so it
+     * can't overtake data sent over shared memory.
+     */
+    static void revalidationFrame(uint8_t frame[ZTS_LOCAL_REVALIDATE_FRAME_LEN]);
+
+    /**
+     * Return whether a frame delivered by the core is a revalidation frame
+     */
+    static bool isRevalidationFrame(unsigned int etherType, const void* data, unsigned int len);
+
+    void threadMain() throw();
+
+  private:
+    struct Peer {
+        Peer();
+
+        LocalRing* tx;   // Ours, frames to the peer
+        LocalRing* rx;   // The peer's, frames from it
+        uint64_t rxInode;
+        int pid;
+        bool local;          // Whether the peer runs on this host
+        int64_t lastProbe;   // When `local` was last determined
+        // Network -> last frame from the peer delivered by the core
+        std::map<uint64_t, int64_t> authorized;
+        // Network -> last revalidation frame to the peer
+        std::map<uint64_t, int64_t> lastCoreSend;
+        // Networks on which the peer accepts our frames
+        std::set<uint64_t> accepted;
+        // Sending to the peer failed, its rings are dropped by the transport
+        // thread (which reads them without holding the lock)
+        bool dead;
+    };
+
+    bool _probe(uint64_t peerId, Peer& p, int64_t now);
+    void _hello(uint64_t peerId, Peer& p, uint64_t net_id, unsigned int type);
+    void _onMessage(const void* data, unsigned int len);
+    void _drop(uint64_t peerId, Peer& p);
+    bool _housekeeping(int64_t now);
+    bool _drain();
+    void _setWaiting(uint32_t waiting);
+    std::string _sockPath(uint64_t node) const;
+    std::string _ringPath(uint64_t from, uint64_t to) const;
+
+    void (*_handler)(void*, uint64_t, const MAC&, const MAC&, unsigned int, unsigned int, const void*, unsigned int);
+    void (*_batchHandler)(void*);
+    void* _arg;
+    uint64_t _nodeId;
+    std::string _dir;
+    int _fd;
+    int _shutdownSignalPipe[2] = { -1, -1 };
+    volatile bool _run;
+    Thread _thread;
+
+    std::map<uint64_t, Peer> _peers;
+    Mutex _peers_m;
+};
+
+}   // namespace ZeroTier
+
+#endif
@@ -22,9 +22,11 @@
 #include "NodeService.hpp"
 
 #include "Events.hpp"
+#include "IdentityPool.hpp"
 #include "InetAddress.hpp"
 #include "Mutex.hpp"
 #include "Node.hpp"
+#include "Resolver.hpp"
 #include "Utilities.hpp"
 #include "VirtualTap.hpp"
 
@@ -165,6 +167,29 @@ static void StapFrameHandler(
     reinterpret_cast<NodeService*>(uptr)->tapFrameHandler(net_id, from, to, etherType, vlanId, data, len);
 }
 
+static void StapLocalFrameHandler(
+    void* uptr,
+    uint64_t net_id,
+    const MAC& from,
+    const MAC& to,
+    unsigned int etherType,
+    unsigned int vlanId,
+    const void* data,
+    unsigned int len)
+{
+    reinterpret_cast<NodeService*>(uptr)->localFrameHandler(net_id, from, to, etherType, vlanId, data, len);
+}
+
+static void StapLocalBatchHandler(void* uptr)
+{
+    reinterpret_cast<NodeService*>(uptr)->localBatchHandler();
+}
+
+static void StapMulticastHandler(void* uptr)
+{
+    reinterpret_cast<NodeService*>(uptr)->tapMulticastChanged();
+}
+
 NodeService::NodeService()
     : _phy(this, false, true)
     , _node((Node*)0)
@@ -183,8 +208,11 @@ NodeService::NodeService()
     , _tcpFallbackTunnel((TcpConnection*)0)
     , _lastRestart(0)
     , _nextBackgroundTaskDeadline(0)
+    , _multicastChanged(false)
     , _run(false)
     , _termReason(ONE_STILL_RUNNING)
+    , _allowLocalTransport(false)
+    , _localTransport((LocalTransport*)0)
     , _allowPortMapping(true)
 #ifdef ZT_USE_MINIUPNPC
     , _portMapper((PortMapper*)0)
@@ -341,6 +369,17 @@ NodeService::ReasonForTermination NodeService::run()
         }
 #endif
 
+        // Carry frames to nodes in other processes on this host over shared
+        // memory, if the host allows it
+        if (_allowLocalTransport) {
+            _localTransport =
+                new LocalTransport(_node->address(), StapLocalFrameHandler, StapLocalBatchHandler, (void*)this);
+            if (! _localTransport->start()) {
+                delete _localTransport;
+                _localTransport = (LocalTransport*)0;
+            }
+        }
+
         // Join existing networks in networks.d
         if (_allowNetworkCaching) {
             std::vector<std::string> networksDotD(
@@ -430,9 +469,11 @@ NodeService::ReasonForTermination NodeService::run()
                 _phy.close(_tcpFallbackTunnel->sock);
             }
 
-            // Sync multicast group memberships
-            if ((now - lastTapMulticastGroupCheck) >= ZT_TAP_CHECK_MULTICAST_INTERVAL) {
+            // Sync multicast group memberships, at once if a tap's network
+            // stack joined or left a group
+            if ((now - lastTapMulticastGroupCheck) >= ZT_TAP_CHECK_MULTICAST_INTERVAL || _multicastChanged) {
                 lastTapMulticastGroupCheck = now;
+                _multicastChanged = false;
                 std::vector<std::pair<uint64_t, std::pair<std::vector<MulticastGroup>, std::vector<MulticastGroup> > > >
                     mgChanges;
                 {
@@ -499,6 +540,17 @@ NodeService::ReasonForTermination NodeService::run()
             const unsigned long delay = (dl > now) ? (unsigned long)(dl - now) : 100;
             clockShouldBe = now + (uint64_t)delay;
             _phy.poll(delay);
+
+            // TCP segments received during the poll may have been held for
+            // merging, see VirtualTap.cpp
+            {
+                Mutex::Lock _l(_nets_m);
+                for (std::map<uint64_t, NetworkState>::iterator n(_nets.begin()); n != _nets.end(); ++n) {
+                    if (n->second.tap) {
+                        n->second.tap->flushReceiveBatch();
+                    }
+                }
+            }
         }
     }
     catch (std::exception& e) {
@@ -515,10 +567,14 @@ NodeService::ReasonForTermination NodeService::run()
     {
         Mutex::Lock _l(_nets_m);
         for (std::map<uint64_t, NetworkState>::iterator n(_nets.begin()); n != _nets.end(); ++n) {
+            resolver_remove_network(n->first);
             delete n->second.tap;
         }
         _nets.clear();
     }
+    // After the taps, which may send through it until they are gone
+    delete _localTransport;
+    _localTransport = (LocalTransport*)0;
 
     switch (_termReason) {
         case ONE_NORMAL_TERMINATION:
@@ -584,19 +640,19 @@ void NodeService::syncManagedStuff(NetworkState& n)
                 fprintf(stderr, "ERROR: unable to remove ip address %s" ZT_EOL_S, ip->toString(ipbuf));
             }
             else {
-                zts_addr_info_t* ad = new zts_addr_info_t();
-                ad->net_id = n.tap->_net_id;
+                zts_addr_info_t ad = zts_addr_info_t();
+                ad.net_id = n.tap->_net_id;
                 if ((*ip).isV4()) {
-                    struct sockaddr_in* in4 = (struct sockaddr_in*)&(ad->addr);
+                    struct sockaddr_in* in4 = (struct sockaddr_in*)&(ad.addr);
                     memcpy(&(in4->sin_addr.s_addr), (*ip).rawIpData(), 4);
                     in4->sin_family = ZTS_AF_INET;
-                    sendEventToUser(ZTS_EVENT_ADDR_REMOVED_IP4, (void*)ad);
+                    sendEventToUser(ZTS_EVENT_ADDR_REMOVED_IP4, (void*)&ad);
                 }
                 if ((*ip).isV6()) {
-                    struct sockaddr_in6* in6 = (struct sockaddr_in6*)&(ad->addr);
+                    struct sockaddr_in6* in6 = (struct sockaddr_in6*)&(ad.addr);
                     memcpy(&(in6->sin6_addr.s6_addr), (*ip).rawIpData(), 16);
                     in6->sin6_family = ZTS_AF_INET6;
-                    sendEventToUser(ZTS_EVENT_ADDR_REMOVED_IP6, (void*)ad);
+                    sendEventToUser(ZTS_EVENT_ADDR_REMOVED_IP6, (void*)&ad);
                 }
             }
         }
@@ -607,19 +663,19 @@ void NodeService::syncManagedStuff(NetworkState& n)
                 fprintf(stderr, "ERROR: unable to add ip address %s" ZT_EOL_S, ip->toString(ipbuf));
             }
             else {
-                zts_addr_info_t* ad = new zts_addr_info_t();
-                ad->net_id = n.tap->_net_id;
+                zts_addr_info_t ad = zts_addr_info_t();
+                ad.net_id = n.tap->_net_id;
                 if ((*ip).isV4()) {
-                    struct sockaddr_in* in4 = (struct sockaddr_in*)&(ad->addr);
+                    struct sockaddr_in* in4 = (struct sockaddr_in*)&(ad.addr);
                     memcpy(&(in4->sin_addr.s_addr), (*ip).rawIpData(), 4);
                     in4->sin_family = ZTS_AF_INET;
-                    sendEventToUser(ZTS_EVENT_ADDR_ADDED_IP4, (void*)ad);
+                    sendEventToUser(ZTS_EVENT_ADDR_ADDED_IP4, (void*)&ad);
                 }
                 if ((*ip).isV6()) {
-                    struct sockaddr_in6* in6 = (struct sockaddr_in6*)&(ad->addr);
+                    struct sockaddr_in6* in6 = (struct sockaddr_in6*)&(ad.addr);
                     memcpy(&(in6->sin6_addr.s6_addr), (*ip).rawIpData(), 16);
                     in6->sin6_family = ZTS_AF_INET6;
-                    sendEventToUser(ZTS_EVENT_ADDR_ADDED_IP6, (void*)ad);
+                    sendEventToUser(ZTS_EVENT_ADDR_ADDED_IP6, (void*)&ad);
                 }
             }
         }
@@ -852,6 +908,7 @@ int NodeService::nodeVirtualNetworkConfigFunction(
 {
     Mutex::Lock _l(_nets_m);
     NetworkState& n = _nets[net_id];
+    _snapshotGeneration++;
 
     switch (op) {
         case ZT_VIRTUAL_NETWORK_CONFIG_OPERATION_UP:
@@ -866,6 +923,7 @@ int NodeService::nodeVirtualNetworkConfigFunction(
                     (void*)this);
                 *nuptr = (void*)&n;
                 n.tap->setUserEventSystem(_events);
+                n.tap->setMulticastHandler(StapMulticastHandler);
             }
             // After setting up tap, fall through to CONFIG_UPDATE since we
             // also want to do this...
@@ -874,6 +932,11 @@ int NodeService::nodeVirtualNetworkConfigFunction(
             if (n.tap) {   // sanity check
                 syncManagedStuff(n);
                 n.tap->setMtu(nwc->mtu);
+                std::vector<InetAddress> dnsServers;
+                for (int i = 0; i < ZT_MAX_DNS_SERVERS; i++) {
+                    dnsServers.push_back(InetAddress(nwc->dns.server_addr[i]));
+                }
+                resolver_set_network_servers(net_id, nwc->dns.domain, dnsServers);
             }
             else {
                 _nets.erase(net_id);
@@ -886,10 +949,17 @@ int NodeService::nodeVirtualNetworkConfigFunction(
         case ZT_VIRTUAL_NETWORK_CONFIG_OPERATION_DOWN:
         case ZT_VIRTUAL_NETWORK_CONFIG_OPERATION_DESTROY:
             sendEventToUser(ZTS_EVENT_NETWORK_DOWN, (void*)&n);
+            resolver_remove_network(net_id);
+            if (_localTransport) {
+                _localTransport->revoke(net_id);
+            }
             if (n.tap) {   // sanity check
                 *nuptr = (void*)0;
                 delete n.tap;
                 _nets.erase(net_id);
+                if (_nets.empty()) {
+                    zts_lwip_hibernate_driver();
+                }
                 if (_allowNetworkCaching) {
                     if (op == ZT_VIRTUAL_NETWORK_CONFIG_OPERATION_DESTROY) {
                         char nlcpath[256] = { 0 };
@@ -948,7 +1018,7 @@ void NodeService::nodeEventCallback(enum ZT_Event event, const void* metaData)
 
 void NodeService::sendEventToUser(unsigned int zt_event_code, const void* obj, unsigned int len)
 {
-    if (! _events) {
+    if (! _events || ! _events->wants(zt_event_code)) {
         return;
     }
 
@@ -959,6 +1029,7 @@ void NodeService::sendEventToUser(unsigned int zt_event_code, const void* obj, u
     zts_node_info_t* nd;
     zts_net_info_t* nt;
     zts_peer_info_t* pr;
+    zts_addr_info_t* ad;
 
     switch (zt_event_code) {
         case ZTS_EVENT_NODE_UP:
@@ -1041,16 +1112,11 @@ void NodeService::sendEventToUser(unsigned int zt_event_code, const void* obj, u
             break;
         }
         case ZTS_EVENT_ADDR_ADDED_IP4:
-            objptr = (void*)obj;
-            break;
         case ZTS_EVENT_ADDR_ADDED_IP6:
-            objptr = (void*)obj;
-            break;
         case ZTS_EVENT_ADDR_REMOVED_IP4:
-            objptr = (void*)obj;
-            break;
         case ZTS_EVENT_ADDR_REMOVED_IP6:
-            objptr = (void*)obj;
+            ad = new zts_addr_info_t(*(const zts_addr_info_t*)obj);
+            objptr = (void*)ad;
             break;
         case ZTS_EVENT_STORE_IDENTITY_PUBLIC:
             objptr = (void*)obj;
@@ -1117,12 +1183,10 @@ void NodeService::sendEventToUser(unsigned int zt_event_code, const void* obj, u
                     break;
                 }
                 case ZTS_EVENT_ADDR_ADDED_IP4:
-                    break;
                 case ZTS_EVENT_ADDR_ADDED_IP6:
-                    break;
                 case ZTS_EVENT_ADDR_REMOVED_IP4:
-                    break;
                 case ZTS_EVENT_ADDR_REMOVED_IP6:
+                    delete ad;
                     break;
                 case ZTS_EVENT_STORE_IDENTITY_PUBLIC:
                     break;
@@ -1194,6 +1258,11 @@ void NodeService::generateSyntheticEvents()
         }
         netState.tap->_networkStatus = mostRecentStatus;
     }
+    if (! _events || ! _events->wants(ZTS_EVENT_PEER_DIRECT)) {
+        // Not worth listing peers for, once wanted again all are new
+        peerCache.clear();
+        return;
+    }
     ZT_PeerList* pl = _node->peers();
     if (pl) {
         for (unsigned long i = 0; i < pl->peerCount; ++i) {
@@ -1298,7 +1367,18 @@ int NodeService::multicastSubCount(uint64_t net_id) const
 
 int NodeService::pathCount(uint64_t peer_id) const
 {
-    return ZTS_ERR_NO_RESULT;   // TODO
+    int count = ZTS_ERR_NO_RESULT;
+    ZT_PeerList* pl = _node->peers();
+    if (pl) {
+        for (unsigned long i = 0; i < pl->peerCount; i++) {
+            if (pl->peers[i].address == peer_id) {
+                count = pl->peers[i].pathCount;
+                break;
+            }
+        }
+    }
+    _node->freeQueryResult((void*)pl);
+    return count;
 }
 
 int NodeService::getAddrAtIdx(uint64_t net_id, unsigned int idx, char* dst, unsigned int len)
@@ -1390,7 +1470,192 @@ int NodeService::getMulticastSubAtIdx(uint64_t net_id, unsigned int idx, uint64_
 
 int NodeService::getPathAtIdx(uint64_t peer_id, unsigned int idx, char* path, unsigned int len)
 {
-    return ZTS_ERR_NO_RESULT;   // TODO
+    if (! path || ! len) {
+        return ZTS_ERR_ARG;
+    }
+    int err = ZTS_ERR_NO_RESULT;
+    ZT_PeerList* pl = _node->peers();
+    for (unsigned long i = 0; pl && i < pl->peerCount; i++) {
+        if (pl->peers[i].address != peer_id) {
+            continue;
+        }
+        err = ZTS_ERR_ARG;
+        if (idx < pl->peers[i].pathCount) {
+            struct sockaddr* sa = (struct sockaddr*)&(pl->peers[i].paths[idx].address);
+            if (sa->sa_family == AF_INET) {
+                struct sockaddr_in* in4 = (struct sockaddr_in*)sa;
+                err = inet_ntop(AF_INET, &(in4->sin_addr), path, len) ? ZTS_ERR_OK : ZTS_ERR_ARG;
+            }
+            if (sa->sa_family == AF_INET6) {
+                struct sockaddr_in6* in6 = (struct sockaddr_in6*)sa;
+                err = inet_ntop(AF_INET6, &(in6->sin6_addr), path, len) ? ZTS_ERR_OK : ZTS_ERR_ARG;
+            }
+        }
+        break;
+    }
+    _node->freeQueryResult((void*)pl);
+    return err;
+}
+
+/**
+ * Copy a native address into a snapshot record
+ */
+static void snapshot_addr(zts_snapshot_addr_t* dst, const struct sockaddr_storage* ss)
+{
+    memset(dst, 0, sizeof(zts_snapshot_addr_t));
+    if (ss->ss_family == AF_INET) {
+        const struct sockaddr_in* in4 = (const struct sockaddr_in*)ss;
+        memcpy(dst->addr, &(in4->sin_addr), 4);
+        dst->port = ntohs(in4->sin_port);
+        dst->family = ZTS_AF_INET;
+    }
+    if (ss->ss_family == AF_INET6) {
+        const struct sockaddr_in6* in6 = (const struct sockaddr_in6*)ss;
+        memcpy(dst->addr, &(in6->sin6_addr), 16);
+        dst->port = ntohs(in6->sin6_port);
+        dst->family = ZTS_AF_INET6;
+    }
+}
+
+static void snapshot_hash(uint64_t& h, const void* data, unsigned int len)
+{
+    for (unsigned int i = 0; i < len; i++) {
+        h = (h ^ ((const uint8_t*)data)[i]) * 0x100000001b3ULL;   // FNV-1a
+    }
+}
+
+/**
+ * Hash what a snapshot shows of the peer list, leaving out latencies and
+ * timestamps which change all the time
+ */
+static uint64_t snapshot_peer_hash(const ZT_PeerList* pl)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned long i = 0; pl && i < pl->peerCount; i++) {
+        const ZT_Peer& p = pl->peers[i];
+        int fields[5] = { p.versionMajor, p.versionMinor, p.versionRev, (int)p.role, (int)p.pathCount };
+        snapshot_hash(h, &(p.address), sizeof(p.address));
+        snapshot_hash(h, fields, sizeof(fields));
+        for (unsigned int j = 0; j < p.pathCount; j++) {
+            zts_snapshot_addr_t a;
+            snapshot_addr(&a, &(p.paths[j].address));
+            uint8_t flags[2] = { (uint8_t)p.paths[j].expired, (uint8_t)p.paths[j].preferred };
+            snapshot_hash(h, &a, sizeof(a));
+            snapshot_hash(h, flags, sizeof(flags));
+        }
+    }
+    return h;
+}
+
+// Arrays in a snapshot buffer start on 8-byte boundaries
+#define SNAPSHOT_ALIGN(n) (((n) + 7) & ~7U)
+
+int NodeService::snapshot(void* buf, unsigned int* len, uint64_t* generation)
+{
+    if (! len || ! generation) {
+        return ZTS_ERR_ARG;
+    }
+    Mutex::Lock _l(_nets_m);
+    ZT_PeerList* pl = _node->peers();
+    uint64_t h = snapshot_peer_hash(pl);
+    if (h != _snapshotPeerHash) {
+        _snapshotPeerHash = h;
+        _snapshotGeneration++;
+    }
+    if (*generation == _snapshotGeneration) {
+        _node->freeQueryResult((void*)pl);
+        return ZTS_ERR_NO_RESULT;
+    }
+    // Size everything up first so that nothing is written to a short buffer
+    unsigned int addr_count = 0, route_count = 0, mc_count = 0, peer_count = 0, path_count = 0;
+    for (auto n = _nets.begin(); n != _nets.end(); ++n) {
+        addr_count += n->second.config.assignedAddressCount;
+        route_count += n->second.config.routeCount;
+        mc_count += n->second.config.multicastSubscriptionCount;
+    }
+    for (unsigned long i = 0; pl && i < pl->peerCount; i++) {
+        peer_count++;
+        path_count += pl->peers[i].pathCount;
+    }
+    unsigned int nets_off = SNAPSHOT_ALIGN(sizeof(zts_snapshot_t));
+    unsigned int addrs_off = SNAPSHOT_ALIGN(nets_off + _nets.size() * sizeof(zts_snapshot_net_t));
+    unsigned int routes_off = SNAPSHOT_ALIGN(addrs_off + addr_count * sizeof(zts_snapshot_addr_t));
+    unsigned int mcs_off = SNAPSHOT_ALIGN(routes_off + route_count * sizeof(zts_snapshot_route_t));
+    unsigned int peers_off = SNAPSHOT_ALIGN(mcs_off + mc_count * sizeof(zts_multicast_group_t));
+    unsigned int paths_off = SNAPSHOT_ALIGN(peers_off + peer_count * sizeof(zts_snapshot_peer_t));
+    unsigned int needed = paths_off + path_count * sizeof(zts_snapshot_path_t);
+    if (! buf || *len < needed) {
+        *len = needed;
+        _node->freeQueryResult((void*)pl);
+        return ZTS_ERR_ARG;
+    }
+    memset(buf, 0, needed);
+    uint8_t* base = (uint8_t*)buf;
+    zts_snapshot_t* s = (zts_snapshot_t*)buf;
+    s->generation = _snapshotGeneration;
+    s->nets = (zts_snapshot_net_t*)(base + nets_off);
+    s->addrs = (zts_snapshot_addr_t*)(base + addrs_off);
+    s->routes = (zts_snapshot_route_t*)(base + routes_off);
+    s->mcs = (zts_multicast_group_t*)(base + mcs_off);
+    s->peers = (zts_snapshot_peer_t*)(base + peers_off);
+    s->paths = (zts_snapshot_path_t*)(base + paths_off);
+
+    for (auto n = _nets.begin(); n != _nets.end(); ++n) {
+        const ZT_VirtualNetworkConfig& c = n->second.config;
+        zts_snapshot_net_t* net = &(s->nets[s->net_count++]);
+        net->net_id = n->first;
+        net->mac = c.mac;
+        strncpy(net->name, c.name, ZTS_MAX_NETWORK_SHORT_NAME_LENGTH);
+        net->status = (zts_network_status_t)c.status;
+        net->type = (zts_net_info_type_t)c.type;
+        net->mtu = c.mtu;
+        net->netconf_rev = c.netconfRevision;
+        net->addr_first = s->addr_count;
+        net->addr_count = c.assignedAddressCount;
+        for (unsigned int i = 0; i < c.assignedAddressCount; i++) {
+            snapshot_addr(&(s->addrs[s->addr_count++]), &(c.assignedAddresses[i]));
+        }
+        net->route_first = s->route_count;
+        net->route_count = c.routeCount;
+        for (unsigned int i = 0; i < c.routeCount; i++) {
+            zts_snapshot_route_t* r = &(s->routes[s->route_count++]);
+            snapshot_addr(&(r->target), &(c.routes[i].target));
+            snapshot_addr(&(r->via), &(c.routes[i].via));
+            r->flags = c.routes[i].flags;
+            r->metric = c.routes[i].metric;
+        }
+        net->mc_first = s->mc_count;
+        net->mc_count = c.multicastSubscriptionCount;
+        for (unsigned int i = 0; i < c.multicastSubscriptionCount; i++) {
+            s->mcs[s->mc_count].mac = c.multicastSubscriptions[i].mac;
+            s->mcs[s->mc_count++].adi = c.multicastSubscriptions[i].adi;
+        }
+    }
+    for (unsigned long i = 0; pl && i < pl->peerCount; i++) {
+        const ZT_Peer& p = pl->peers[i];
+        zts_snapshot_peer_t* peer = &(s->peers[s->peer_count++]);
+        peer->peer_id = p.address;
+        peer->ver_major = p.versionMajor;
+        peer->ver_minor = p.versionMinor;
+        peer->ver_rev = p.versionRev;
+        peer->latency = p.latency;
+        peer->role = (zts_peer_role_t)p.role;
+        peer->path_first = s->path_count;
+        peer->path_count = p.pathCount;
+        for (unsigned int j = 0; j < p.pathCount; j++) {
+            zts_snapshot_path_t* path = &(s->paths[s->path_count++]);
+            path->last_tx = p.paths[j].lastSend;
+            path->last_rx = p.paths[j].lastReceive;
+            path->trusted_path_id = p.paths[j].trustedPathId;
+            snapshot_addr(&(path->address), &(p.paths[j].address));
+            path->expired = (uint8_t)p.paths[j].expired;
+            path->preferred = (uint8_t)p.paths[j].preferred;
+        }
+    }
+    _node->freeQueryResult((void*)pl);
+    *len = needed;
+    *generation = _snapshotGeneration;
+    return ZTS_ERR_OK;
 }
 
 int NodeService::getFirstAssignedAddr(uint64_t net_id, unsigned int family, struct zts_sockaddr_storage* addr)
@@ -1728,6 +1993,22 @@ int NodeService::nodeStateGetFunction(
             return n;
         }
     }
+    if (type == ZT_STATE_OBJECT_IDENTITY_SECRET) {
+        // First start: generate the identity here rather than in the core, so
+        // that it comes from the pool or all cores (see IdentityPool.cpp). The
+        // core only stores identities it generated itself.
+        std::string secret = identity_take();
+        Identity id;
+        if (secret.length() <= maxlen && id.fromString(secret.c_str())) {
+            char pub[ZT_IDENTITY_STRING_BUFFER_LENGTH] = { 0 };
+            id.toString(false, pub);
+            const uint64_t idtmp[2] = { id.address().toInt(), 0 };
+            nodeStatePutFunction(ZT_STATE_OBJECT_IDENTITY_SECRET, idtmp, secret.c_str(), secret.length());
+            nodeStatePutFunction(ZT_STATE_OBJECT_IDENTITY_PUBLIC, idtmp, pub, strlen(pub));
+            memcpy(data, secret.c_str(), secret.length());
+            return secret.length();
+        }
+    }
     return -1;
 }
 
@@ -1839,11 +2120,17 @@ void NodeService::nodeVirtualNetworkFrameFunction(
     unsigned int len)
 {
     ZTS_UNUSED_ARG(vlanId);
-    ZTS_UNUSED_ARG(net_id);
     NetworkState* n = reinterpret_cast<NetworkState*>(*nuptr);
     if ((! n) || (! n->tap)) {
         return;
     }
+    // The core let the peer reach us, so may the shared-memory transport
+    if (_localTransport) {
+        _localTransport->authorize(net_id, MAC(sourceMac).toAddress(net_id).toInt());
+    }
+    if (LocalTransport::isRevalidationFrame(etherType, data, len)) {
+        return;   // Its arrival was all that mattered
+    }
     n->tap->put(MAC(sourceMac), MAC(destMac), etherType, data, len);
 }
 
@@ -1941,6 +2228,25 @@ void NodeService::tapFrameHandler(
     const void* data,
     unsigned int len)
 {
+    bool revalidate = false;
+    if (_localTransport && _localTransport->send(net_id, from, to, etherType, vlanId, data, len, revalidate)) {
+        if (revalidate) {
+            uint8_t frame[ZTS_LOCAL_REVALIDATE_FRAME_LEN];
+            LocalTransport::revalidationFrame(frame);
+            _node->processVirtualNetworkFrame(
+                (void*)0,
+                OSUtils::now(),
+                net_id,
+                from.toInt(),
+                to.toInt(),
+                0x86dd,
+                0,
+                frame,
+                sizeof(frame),
+                &_nextBackgroundTaskDeadline);
+        }
+        return;
+    }
     _node->processVirtualNetworkFrame(
         (void*)0,
         OSUtils::now(),
@@ -1954,6 +2260,39 @@ void NodeService::tapFrameHandler(
         &_nextBackgroundTaskDeadline);
 }
 
+void NodeService::localFrameHandler(
+    uint64_t net_id,
+    const MAC& from,
+    const MAC& to,
+    unsigned int etherType,
+    unsigned int vlanId,
+    const void* data,
+    unsigned int len)
+{
+    ZTS_UNUSED_ARG(vlanId);
+    Mutex::Lock _l(_nets_m);
+    std::map<uint64_t, NetworkState>::iterator n(_nets.find(net_id));
+    if (n != _nets.end() && n->second.tap) {
+        n->second.tap->put(from, to, etherType, data, len);
+    }
+}
+
+void NodeService::localBatchHandler()
+{
+    Mutex::Lock _l(_nets_m);
+    for (std::map<uint64_t, NetworkState>::iterator n(_nets.begin()); n != _nets.end(); ++n) {
+        if (n->second.tap) {
+            n->second.tap->flushReceiveBatch();
+        }
+    }
+}
+
+void NodeService::tapMulticastChanged()
+{
+    _multicastChanged = true;
+    _phy.whack();
+}
+
 int NodeService::shouldBindInterface(const char* ifname, const InetAddress& ifaddr)
 {
 #if defined(__linux__) || defined(linux) || defined(__LINUX__) || defined(__linux)
@@ -2140,6 +2479,16 @@ int NodeService::allowPortMapping(unsigned int allowed)
     return ZTS_ERR_OK;
 }
 
+int NodeService::allowLocalTransport(unsigned int allowed)
+{
+    Mutex::Lock _lr(_run_m);
+    if (_run) {
+        return ZTS_ERR_SERVICE;
+    }
+    _allowLocalTransport = allowed;
+    return ZTS_ERR_OK;
+}
+
 int NodeService::allowSecondaryPort(unsigned int allowed)
 {
     Mutex::Lock _lr(_run_m);
@@ -2361,4 +2710,55 @@ int NodeService::getNetworkStatus(uint64_t net_id)
     return n->second.config.status;
 }
 
+int NodeService::setNetworkTxRate(uint64_t net_id, uint64_t bytesPerSec, unsigned int burst)
+{
+    Mutex::Lock _lr(_run_m);
+    if (! _run) {
+        return ZTS_ERR_SERVICE;
+    }
+    Mutex::Lock _ln(_nets_m);
+    std::map<uint64_t, NetworkState>::const_iterator n(_nets.find(net_id));
+    if (n == _nets.end() || ! n->second.tap) {
+        return ZTS_ERR_NO_RESULT;
+    }
+    n->second.tap->setTxRate(bytesPerSec, burst);
+    return ZTS_ERR_OK;
+}
+
+int NodeService::setNetworkTxClassWeight(uint64_t net_id, int cls, unsigned int weight)
+{
+    if (cls < 0 || cls >= ZTS_TX_CLASS_COUNT) {
+        return ZTS_ERR_ARG;
+    }
+    Mutex::Lock _lr(_run_m);
+    if (! _run) {
+        return ZTS_ERR_SERVICE;
+    }
+    Mutex::Lock _ln(_nets_m);
+    std::map<uint64_t, NetworkState>::const_iterator n(_nets.find(net_id));
+    if (n == _nets.end() || ! n->second.tap) {
+        return ZTS_ERR_NO_RESULT;
+    }
+    n->second.tap->setTxClassWeight(cls, weight);
+    return ZTS_ERR_OK;
+}
+
+int NodeService::getNetworkTxClassStats(uint64_t net_id, int cls, zts_tx_class_stats_t* stats)
+{
+    if (cls < 0 || cls >= ZTS_TX_CLASS_COUNT || ! stats) {
+        return ZTS_ERR_ARG;
+    }
+    Mutex::Lock _lr(_run_m);
+    if (! _run) {
+        return ZTS_ERR_SERVICE;
+    }
+    Mutex::Lock _ln(_nets_m);
+    std::map<uint64_t, NetworkState>::const_iterator n(_nets.find(net_id));
+    if (n == _nets.end() || ! n->second.tap) {
+        return ZTS_ERR_NO_RESULT;
+    }
+    n->second.tap->getTxClassStats(cls, stats);
+    return ZTS_ERR_OK;
+}
+
 }   // namespace ZeroTier
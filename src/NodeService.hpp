@@ -23,6 +23,7 @@
 #define ZTS_UNUSED_ARG(x) (void)x
 
 #include "Binder.hpp"
+#include "LocalTransport.hpp"
 #include "Mutex.hpp"
 #include "Node.hpp"
 #include "Phy.hpp"
@@ -214,6 +215,9 @@ class NodeService {
     // Deadline for the next background task service function
     volatile int64_t _nextBackgroundTaskDeadline;
 
+    // Set when a tap's network stack joined or left a multicast group
+    volatile bool _multicastChanged;
+
     // Configured networks
     struct NetworkState {
         NetworkState() : tap((VirtualTap*)0)
@@ -232,6 +236,10 @@ class NodeService {
     };
     std::map<uint64_t, NetworkState> _nets;
 
+    // Snapshot generation and the peer list hash it last saw, guarded by _nets_m
+    uint64_t _snapshotGeneration = 1;
+    uint64_t _snapshotPeerHash = 0;
+
     /** Lock to control access to network configuration data */
     Mutex _nets_m;
     /** Lock to control access to storage data */
@@ -247,6 +255,10 @@ class NodeService {
 
     std::string _fatalErrorMessage;
 
+    // Shared-memory transport to nodes on this host if enabled
+    bool _allowLocalTransport;
+    LocalTransport* _localTransport;
+
     // uPnP/NAT-PMP port mapper if enabled
     bool _allowPortMapping;
 #ifdef ZT_USE_MINIUPNPC
@@ -360,6 +372,9 @@ class NodeService {
 
     int getPathAtIdx(uint64_t peer_id, unsigned int idx, char* path, unsigned int len);
 
+    /** Copy all networks and peers into a zts_snapshot_t buffer. Service must not be locked. */
+    int snapshot(void* buf, unsigned int* len, uint64_t* generation);
+
     /** Orbit a moon */
     int orbit(uint64_t moonWorldId, uint64_t moonSeed);
 
@@ -409,6 +424,25 @@ class NodeService {
         const void* data,
         unsigned int len);
 
+    /** Deliver a frame received over the shared-memory transport */
+    void localFrameHandler(
+        uint64_t net_id,
+        const MAC& from,
+        const MAC& to,
+        unsigned int etherType,
+        unsigned int vlanId,
+        const void* data,
+        unsigned int len);
+
+    /** Hand frames held by the taps to the stack after a batch from the shared-memory transport */
+    void localBatchHandler();
+
+    /**
+     * Sync multicast group memberships of all taps without waiting for
+     * ZT_TAP_CHECK_MULTICAST_INTERVAL (wakes the service thread)
+     */
+    void tapMulticastChanged();
+
     int shouldBindInterface(const char* ifname, const InetAddress& ifaddr);
 
     unsigned int _getRandomPort(unsigned int minPort, unsigned int maxPort);
@@ -436,6 +470,9 @@ class NodeService {
     /** Allow or disallow port-mapping */
     int allowPortMapping(unsigned int allowed);
 
+    /** Allow or disallow the shared-memory transport to nodes on this host */
+    int allowLocalTransport(unsigned int allowed);
+
     /** Allow or disallow backup port */
     int allowSecondaryPort(unsigned int allowed);
 
@@ -492,6 +529,15 @@ class NodeService {
     /** Return the status of the network join */
     int getNetworkStatus(uint64_t net_id);
 
+    /** Limit the rate at which frames are sent to the network */
+    int setNetworkTxRate(uint64_t net_id, uint64_t bytesPerSec, unsigned int burst);
+
+    /** Set the share of the rate limit a transmit class gets */
+    int setNetworkTxClassWeight(uint64_t net_id, int cls, unsigned int weight);
+
+    /** Get the statistics of a transmit class */
+    int getNetworkTxClassStats(uint64_t net_id, int cls, zts_tx_class_stats_t* stats);
+
     /** Get the first address assigned by the network */
     int getFirstAssignedAddr(uint64_t net_id, unsigned int family, struct zts_sockaddr_storage* addr);
 
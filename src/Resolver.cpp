@@ -0,0 +1,798 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * Asynchronous DNS resolver with a cache
+ *
+ * lwIP's resolver keeps DNS_TABLE_SIZE names, allows one outstanding query at
+ * a time (LWIP_DNS_SECURE_NO_MULTIPLE_OUTSTANDING) and doesn't report TTLs,
+ * and lwip_gethostbyname() returns its result in static storage. This is a stub
+ * resolver of its own on lwIP's raw UDP API instead: every query has its own
+ * PCB, random source port and random transaction ID, concurrent lookups of the
+ * same name share one query, and answers, including that a name or address
+ * doesn't exist (RFC 2308), are cached for as long as their TTL allows.
+ *
+ * Everything except the user's callbacks runs in the stack's thread or under
+ * the core lock. Callbacks are called from a thread of the resolver so that
+ * they may use the socket API.
+ */
+
+#include "Resolver.hpp"
+
+#include "Mutex.hpp"
+#include "OSUtils.hpp"
+#include "ResolverParse.h"
+#include "Utils.hpp"
+#include "concurrentqueue.h"
+#include "lwip/def.h"
+#include "lwip/dns.h"
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+#include "lwip/sys.h"
+#include "lwip/timeouts.h"
+#include "lwip/udp.h"
+
+#include <ctype.h>
+#include <map>
+#include <string.h>
+#include <string>
+
+#define ZTS_RESOLVER_THREAD_NAME "ZTResolverThread"
+
+#define ZTS_DNS_PORT           53
+#define ZTS_DNS_MAX_MESSAGE    512   // Over UDP, without EDNS
+#define ZTS_DNS_MAX_NAME       253
+#define ZTS_DNS_MAX_LABEL      63
+#define ZTS_DNS_MAX_CNAMES     8
+#define ZTS_DNS_TIMER_INTERVAL 250   // ms
+
+#define ZTS_DNS_TYPE_A     1
+#define ZTS_DNS_TYPE_CNAME 5
+#define ZTS_DNS_TYPE_SOA   6
+#define ZTS_DNS_TYPE_AAAA  28
+#define ZTS_DNS_CLASS_IN   1
+
+#define ZTS_DNS_RCODE_NOERROR  0
+#define ZTS_DNS_RCODE_NXDOMAIN 3
+
+// A lookup asks for AAAA records in the first slot and for A records in the
+// second, so that IPv6 addresses are returned first
+#define ZTS_DNS_SLOT_AAAA 0
+#define ZTS_DNS_SLOT_A    1
+
+namespace ZeroTier {
+
+typedef std::pair<std::string, uint16_t> NameType;
+
+struct Lookup {
+    zts_getaddrinfo_cb callback;
+    void* arg;
+    int pending;   // Slots without a result yet
+    int err[2];
+    std::vector<ip_addr_t> addrs[2];
+};
+
+struct Query {
+    std::string name;
+    uint16_t type;
+    uint16_t id;
+    struct udp_pcb* pcb;
+    std::vector<ip_addr_t> servers;
+    unsigned int attempt;
+    int64_t sent;
+    std::vector<std::pair<Lookup*, int> > waiters;   // Lookups and their slots
+};
+
+struct Answer {
+    int err;   // `ZTS_ERR_OK` or `ZTS_ERR_NO_RESULT`
+    std::vector<ip_addr_t> addrs;
+    uint32_t ttl;   // s
+    int64_t expires;
+};
+
+struct Record {
+    std::string owner;
+    uint16_t type;
+    uint32_t ttl;
+    unsigned int rdata;   // Offset in the message
+    uint16_t rdlength;
+};
+
+struct Completion {
+    zts_getaddrinfo_cb callback;
+    void* arg;
+    int err;
+    std::vector<zts_sockaddr_storage> addrs;
+};
+
+enum ParseResult {
+    PARSE_IGNORE = ZTS_DNS_PARSE_IGNORE,
+    PARSE_RETRY = ZTS_DNS_PARSE_RETRY,
+    PARSE_DONE = ZTS_DNS_PARSE_DONE
+};
+
+// Under the core lock
+static std::map<NameType, Query*> queries;
+static std::map<NameType, Answer> cache;
+static bool timer_active = false;
+static bool thread_started = false;
+
+// Servers delivered by network configurations
+struct NetworkServers {
+    std::string domain;
+    std::vector<ip_addr_t> servers;
+};
+static std::map<uint64_t, NetworkServers> network_servers;
+static Mutex network_servers_m;
+
+static moodycamel::ConcurrentQueue<Completion*> completions;
+static sys_sem_t completions_sem;
+
+static void resolver_recv(void* arg, struct udp_pcb* pcb, struct pbuf* p, const ip_addr_t* addr, u16_t port);
+static void resolver_timer(void* arg);
+
+//----------------------------------------------------------------------------//
+// Completions                                                                //
+//----------------------------------------------------------------------------//
+
+static void resolver_thread(void* arg)
+{
+    LWIP_UNUSED_ARG(arg);
+    while (true) {
+        sys_sem_wait(&completions_sem);
+        Completion* c = NULL;
+        while (completions.try_dequeue(c)) {
+            c->callback(c->arg, c->err, c->addrs.empty() ? NULL : &c->addrs[0], (unsigned int)c->addrs.size());
+            delete c;
+        }
+    }
+}
+
+static bool resolver_start_thread()
+{
+    if (thread_started) {
+        return true;
+    }
+    if (sys_sem_new(&completions_sem, 0) != ERR_OK) {
+        return false;
+    }
+    sys_thread_new(ZTS_RESOLVER_THREAD_NAME, resolver_thread, NULL, DEFAULT_THREAD_STACKSIZE, DEFAULT_THREAD_PRIO);
+    thread_started = true;
+    return true;
+}
+
+static void resolver_to_sockaddr(const ip_addr_t& addr, zts_sockaddr_storage& ss)
+{
+    memset(&ss, 0, sizeof(ss));
+    if (IP_IS_V4_VAL(addr)) {
+        struct zts_sockaddr_in* in4 = (struct zts_sockaddr_in*)&ss;
+        in4->sin_len = sizeof(struct zts_sockaddr_in);
+        in4->sin_family = ZTS_AF_INET;
+        in4->sin_addr.s_addr = ip_2_ip4(&addr)->addr;
+    }
+    else {
+        struct zts_sockaddr_in6* in6 = (struct zts_sockaddr_in6*)&ss;
+        in6->sin6_len = sizeof(struct zts_sockaddr_in6);
+        in6->sin6_family = ZTS_AF_INET6;
+        memcpy(&in6->sin6_addr, ip_2_ip6(&addr)->addr, 16);
+    }
+}
+
+/**
+ * Record the result of one slot of a lookup, and hand the lookup over to the
+ * resolver's thread once all slots have theirs
+ */
+static void resolver_lookup_done(Lookup* l, int slot, int err, const std::vector<ip_addr_t>& addrs)
+{
+    l->err[slot] = err;
+    l->addrs[slot] = addrs;
+    if (--l->pending > 0) {
+        return;
+    }
+    Completion* c = new Completion();
+    c->callback = l->callback;
+    c->arg = l->arg;
+    for (int i = 0; i < 2; i++) {
+        for (size_t j = 0; j < l->addrs[i].size(); j++) {
+            zts_sockaddr_storage ss;
+            resolver_to_sockaddr(l->addrs[i][j], ss);
+            c->addrs.push_back(ss);
+        }
+    }
+    if (! c->addrs.empty()) {
+        c->err = ZTS_ERR_OK;
+    }
+    else if (l->err[0] == ZTS_ERR_NO_RESULT && l->err[1] == ZTS_ERR_NO_RESULT) {
+        c->err = ZTS_ERR_NO_RESULT;
+    }
+    else {
+        c->err = ZTS_ERR_GENERAL;
+    }
+    delete l;
+    completions.enqueue(c);
+    sys_sem_signal(&completions_sem);
+}
+
+//----------------------------------------------------------------------------//
+// Messages                                                                   //
+//----------------------------------------------------------------------------//
+
+static uint16_t resolver_read16(const uint8_t* p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t resolver_read32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+/**
+ * Lower-case `name`, strip a trailing dot and check that it is a valid name
+ */
+static bool resolver_normalize(const char* name, std::string& out)
+{
+    size_t len = strlen(name);
+    if (len > 0 && name[len - 1] == '.') {
+        len--;
+    }
+    if (len == 0 || len > ZTS_DNS_MAX_NAME) {
+        return false;
+    }
+    out.assign(name, len);
+    size_t label = 0;
+    for (size_t i = 0; i < out.size(); i++) {
+        out[i] = (char)tolower((unsigned char)out[i]);
+        if (out[i] == '.') {
+            if (label == 0) {
+                return false;
+            }
+            label = 0;
+        }
+        else if (++label > ZTS_DNS_MAX_LABEL) {
+            return false;
+        }
+    }
+    return label > 0;
+}
+
+static unsigned int resolver_encode(uint8_t* buf, uint16_t id, const std::string& name, uint16_t type)
+{
+    memset(buf, 0, 12);
+    buf[0] = (uint8_t)(id >> 8);
+    buf[1] = (uint8_t)id;
+    buf[2] = 0x01;   // RD
+    buf[5] = 1;      // QDCOUNT
+    unsigned int off = 12;
+    size_t start = 0;
+    while (start < name.size()) {
+        size_t dot = name.find('.', start);
+        if (dot == std::string::npos) {
+            dot = name.size();
+        }
+        buf[off++] = (uint8_t)(dot - start);
+        memcpy(buf + off, name.data() + start, dot - start);
+        off += (unsigned int)(dot - start);
+        start = dot + 1;
+    }
+    buf[off++] = 0;
+    buf[off++] = (uint8_t)(type >> 8);
+    buf[off++] = (uint8_t)type;
+    buf[off++] = 0;
+    buf[off++] = ZTS_DNS_CLASS_IN;
+    return off;
+}
+
+/**
+ * Read the possibly compressed name at `off` in lower case, and move `off` past
+ * it
+ */
+static bool resolver_read_name(const uint8_t* msg, unsigned int len, unsigned int& off, std::string& out)
+{
+    out.clear();
+    unsigned int pos = off;
+    bool jumped = false;
+    while (pos < len) {
+        uint8_t l = msg[pos];
+        if ((l & 0xc0) == 0xc0) {
+            if (pos + 1 >= len) {
+                return false;
+            }
+            // Pointers must point backwards, which also rules out loops
+            unsigned int target = ((l & 0x3f) << 8) | msg[pos + 1];
+            if (target >= pos) {
+                return false;
+            }
+            if (! jumped) {
+                off = pos + 2;
+                jumped = true;
+            }
+            pos = target;
+            continue;
+        }
+        if (l & 0xc0) {
+            return false;
+        }
+        if (l == 0) {
+            if (! jumped) {
+                off = pos + 1;
+            }
+            return true;
+        }
+        if (pos + 1 + l > len || out.size() + 1 + l > ZTS_DNS_MAX_NAME + 1) {
+            return false;
+        }
+        if (! out.empty()) {
+            out += '.';
+        }
+        for (unsigned int i = 0; i < l; i++) {
+            out += (char)tolower(msg[pos + 1 + i]);
+        }
+        pos += 1 + l;
+    }
+    return false;
+}
+
+static bool resolver_read_record(const uint8_t* msg, unsigned int len, unsigned int& off, Record& r)
+{
+    if (! resolver_read_name(msg, len, off, r.owner) || off + 10 > len) {
+        return false;
+    }
+    r.type = resolver_read16(msg + off);
+    r.ttl = resolver_read32(msg + off + 4);
+    if (r.ttl > 0x7fffffff) {
+        r.ttl = 0;   // RFC 2181, 8
+    }
+    r.rdlength = resolver_read16(msg + off + 8);
+    r.rdata = off + 10;
+    off = r.rdata + r.rdlength;
+    if (resolver_read16(msg + r.rdata - 8) != ZTS_DNS_CLASS_IN) {
+        r.type = 0;   // Ignored
+    }
+    return off <= len;
+}
+
+/**
+ * Parse a response to query `q`
+ *
+ * @return Whether the response is to be ignored, the next server asked, or
+ *     `err`, `addrs` and `ttl` (s) hold the result
+ */
+static ParseResult resolver_parse(
+    const Query* q,
+    const uint8_t* msg,
+    unsigned int len,
+    int& err,
+    std::vector<ip_addr_t>& addrs,
+    uint32_t& ttl)
+{
+    if (len < 12 || resolver_read16(msg) != q->id || ! (msg[2] & 0x80) || (msg[2] & 0x78)) {
+        return PARSE_IGNORE;   // Not a response to a standard query with our ID
+    }
+    unsigned int off = 12;
+    std::string name;
+    if (resolver_read16(msg + 4) != 1 || ! resolver_read_name(msg, len, off, name) || off + 4 > len || name != q->name
+        || resolver_read16(msg + off) != q->type || resolver_read16(msg + off + 2) != ZTS_DNS_CLASS_IN) {
+        return PARSE_IGNORE;   // Not a response to our question
+    }
+    off += 4;
+    int rcode = msg[3] & 0x0f;
+    if (rcode != ZTS_DNS_RCODE_NOERROR && rcode != ZTS_DNS_RCODE_NXDOMAIN) {
+        return PARSE_RETRY;
+    }
+    std::vector<Record> answers, authority;
+    unsigned int ancount = resolver_read16(msg + 6);
+    unsigned int nscount = resolver_read16(msg + 8);
+    for (unsigned int i = 0; i < ancount + nscount; i++) {
+        Record r;
+        if (! resolver_read_record(msg, len, off, r)) {
+            if (! (msg[2] & 0x02)) {
+                return PARSE_RETRY;   // Malformed
+            }
+            break;   // Truncated, use what is complete
+        }
+        (i < ancount ? answers : authority).push_back(r);
+    }
+    // Follow the CNAME chain from the name asked for
+    std::string owner = q->name;
+    ttl = ZTS_DNS_MAX_TTL;
+    for (unsigned int hops = 0; rcode == ZTS_DNS_RCODE_NOERROR && hops < ZTS_DNS_MAX_CNAMES; hops++) {
+        size_t i = 0;
+        while (i < answers.size() && (answers[i].type != ZTS_DNS_TYPE_CNAME || answers[i].owner != owner)) {
+            i++;
+        }
+        if (i == answers.size()) {
+            break;
+        }
+        unsigned int rdata = answers[i].rdata;
+        std::string target;
+        if (! resolver_read_name(msg, len, rdata, target)) {
+            break;
+        }
+        owner = target;
+        ttl = LWIP_MIN(ttl, answers[i].ttl);
+    }
+    for (size_t i = 0; rcode == ZTS_DNS_RCODE_NOERROR && i < answers.size(); i++) {
+        const Record& r = answers[i];
+        if (r.type != q->type || r.owner != owner) {
+            continue;
+        }
+        ip_addr_t addr;
+        memset(&addr, 0, sizeof(addr));
+        if (r.type == ZTS_DNS_TYPE_A && r.rdlength == 4) {
+            IP_SET_TYPE_VAL(addr, IPADDR_TYPE_V4);
+            memcpy(&ip_2_ip4(&addr)->addr, msg + r.rdata, 4);
+        }
+        else if (r.type == ZTS_DNS_TYPE_AAAA && r.rdlength == 16) {
+            IP_SET_TYPE_VAL(addr, IPADDR_TYPE_V6);
+            memcpy(ip_2_ip6(&addr)->addr, msg + r.rdata, 16);
+        }
+        else {
+            continue;
+        }
+        addrs.push_back(addr);
+        ttl = LWIP_MIN(ttl, r.ttl);
+    }
+    if (! addrs.empty()) {
+        err = ZTS_ERR_OK;
+        return PARSE_DONE;
+    }
+    if ((msg[2] & 0x02) && rcode == ZTS_DNS_RCODE_NOERROR) {
+        return PARSE_RETRY;   // Truncated, and this resolver doesn't do TCP
+    }
+    // The name or address doesn't exist, for as long as the SOA says (RFC 2308, 5)
+    err = ZTS_ERR_NO_RESULT;
+    ttl = ZTS_DNS_NEGATIVE_TTL;
+    for (size_t i = 0; i < authority.size(); i++) {
+        if (authority[i].type == ZTS_DNS_TYPE_SOA && authority[i].rdlength >= 22) {
+            uint32_t minimum = resolver_read32(msg + authority[i].rdata + authority[i].rdlength - 4);
+            ttl = LWIP_MIN(LWIP_MIN(authority[i].ttl, minimum), ZTS_DNS_MAX_NEGATIVE_TTL);
+            break;
+        }
+    }
+    return PARSE_DONE;
+}
+
+extern "C" int zts_dns_parse(
+    uint16_t id,
+    const char* name,
+    uint16_t type,
+    const uint8_t* msg,
+    unsigned int len,
+    int* err,
+    struct zts_sockaddr_storage* addrs,
+    unsigned int* count,
+    uint32_t* ttl)
+{
+    Query q = Query();
+    q.name = name;
+    q.type = type;
+    q.id = id;
+    std::vector<ip_addr_t> parsed;
+    ParseResult result = resolver_parse(&q, msg, len, *err, parsed, *ttl);
+    unsigned int n = 0;
+    for (; n < parsed.size() && n < *count; n++) {
+        resolver_to_sockaddr(parsed[n], addrs[n]);
+    }
+    *count = n;
+    return result;
+}
+
+//----------------------------------------------------------------------------//
+// Queries                                                                    //
+//----------------------------------------------------------------------------//
+
+static void resolver_to_ip_addr(const InetAddress& a, ip_addr_t& addr)
+{
+    memset(&addr, 0, sizeof(addr));
+    if (a.isV4()) {
+        IP_SET_TYPE_VAL(addr, IPADDR_TYPE_V4);
+        memcpy(&ip_2_ip4(&addr)->addr, a.rawIpData(), 4);
+    }
+    else {
+        IP_SET_TYPE_VAL(addr, IPADDR_TYPE_V6);
+        memcpy(ip_2_ip6(&addr)->addr, a.rawIpData(), 16);
+    }
+}
+
+/**
+ * Choose the servers to ask for `name`: those of networks whose domain it is
+ * in, otherwise those set with zts_dns_set_server(), otherwise those of any
+ * network
+ */
+static void resolver_select_servers(const std::string& name, std::vector<ip_addr_t>& servers)
+{
+    Mutex::Lock _l(network_servers_m);
+    std::map<uint64_t, NetworkServers>::const_iterator n;
+    for (n = network_servers.begin(); n != network_servers.end(); ++n) {
+        const std::string& d = n->second.domain;
+        if (! d.empty()
+            && (name == d
+                || (name.size() > d.size() && name[name.size() - d.size() - 1] == '.'
+                    && ! name.compare(name.size() - d.size(), d.size(), d)))) {
+            servers.insert(servers.end(), n->second.servers.begin(), n->second.servers.end());
+        }
+    }
+    if (! servers.empty()) {
+        return;
+    }
+    for (int i = 0; i < DNS_MAX_SERVERS; i++) {
+        const ip_addr_t* s = dns_getserver(i);
+        if (! ip_addr_isany(s)) {
+            servers.push_back(*s);
+        }
+    }
+    if (! servers.empty()) {
+        return;
+    }
+    for (n = network_servers.begin(); n != network_servers.end(); ++n) {
+        servers.insert(servers.end(), n->second.servers.begin(), n->second.servers.end());
+    }
+}
+
+static void resolver_send(Query* q)
+{
+    uint8_t buf[ZTS_DNS_MAX_MESSAGE];
+    unsigned int len = resolver_encode(buf, q->id, q->name, q->type);
+    q->sent = OSUtils::now();
+    struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)len, PBUF_RAM);
+    if (! p) {
+        return;   // Retried by the timer
+    }
+    memcpy(p->payload, buf, len);
+    // Servers take turns, in case one is unreachable
+    udp_sendto(q->pcb, p, &q->servers[q->attempt % q->servers.size()], ZTS_DNS_PORT);
+    pbuf_free(p);
+}
+
+static void resolver_cache(const NameType& key, int err, const std::vector<ip_addr_t>& addrs, uint32_t ttl)
+{
+    if (cache.find(key) == cache.end() && cache.size() >= ZTS_DNS_CACHE_SIZE) {
+        // Make room by dropping the entry that expires first
+        std::map<NameType, Answer>::iterator soonest = cache.begin();
+        for (std::map<NameType, Answer>::iterator a = cache.begin(); a != cache.end(); ++a) {
+            if (a->second.expires < soonest->second.expires) {
+                soonest = a;
+            }
+        }
+        cache.erase(soonest);
+    }
+    Answer& a = cache[key];
+    a.err = err;
+    a.addrs = addrs;
+    a.ttl = ttl;
+    a.expires = OSUtils::now() + (int64_t)ttl * 1000;
+}
+
+static void resolver_finish(Query* q, int err, const std::vector<ip_addr_t>& addrs, uint32_t ttl)
+{
+    NameType key(q->name, q->type);
+    if (err != ZTS_ERR_GENERAL && ttl > 0) {
+        resolver_cache(key, err, addrs, LWIP_MIN(ttl, ZTS_DNS_MAX_TTL));
+    }
+    queries.erase(key);
+    udp_remove(q->pcb);
+    for (size_t i = 0; i < q->waiters.size(); i++) {
+        resolver_lookup_done(q->waiters[i].first, q->waiters[i].second, err, addrs);
+    }
+    delete q;
+}
+
+static void resolver_retry(Query* q)
+{
+    if (++q->attempt >= ZTS_DNS_MAX_ATTEMPTS) {
+        resolver_finish(q, ZTS_ERR_GENERAL, std::vector<ip_addr_t>(), 0);
+    }
+    else {
+        resolver_send(q);
+    }
+}
+
+static void resolver_recv(void* arg, struct udp_pcb* pcb, struct pbuf* p, const ip_addr_t* addr, u16_t port)
+{
+    LWIP_UNUSED_ARG(pcb);
+    Query* q = (Query*)arg;
+    uint8_t msg[ZTS_DNS_MAX_MESSAGE];
+    unsigned int len = pbuf_copy_partial(p, msg, sizeof(msg), 0);
+    pbuf_free(p);
+    if (port != ZTS_DNS_PORT) {
+        return;
+    }
+    bool from_server = false;
+    for (size_t i = 0; ! from_server && i < q->servers.size(); i++) {
+        from_server = ip_addr_cmp(addr, &q->servers[i]);
+    }
+    if (! from_server) {
+        return;
+    }
+    int err = ZTS_ERR_GENERAL;
+    std::vector<ip_addr_t> addrs;
+    uint32_t ttl = 0;
+    switch (resolver_parse(q, msg, len, err, addrs, ttl)) {
+        case PARSE_IGNORE:
+            break;
+        case PARSE_RETRY:
+            resolver_retry(q);
+            break;
+        case PARSE_DONE:
+            resolver_finish(q, err, addrs, ttl);
+            break;
+    }
+}
+
+static void resolver_timer(void* arg)
+{
+    LWIP_UNUSED_ARG(arg);
+    const int64_t now = OSUtils::now();
+    std::vector<Query*> due;
+    for (std::map<NameType, Query*>::iterator q = queries.begin(); q != queries.end(); ++q) {
+        if (now - q->second->sent >= ZTS_DNS_RETRY_INTERVAL) {
+            due.push_back(q->second);
+        }
+    }
+    for (size_t i = 0; i < due.size(); i++) {
+        resolver_retry(due[i]);
+    }
+    timer_active = ! queries.empty();
+    if (timer_active) {
+        sys_timeout(ZTS_DNS_TIMER_INTERVAL, resolver_timer, NULL);
+    }
+}
+
+/**
+ * Return an unpredictable 16-bit number. LWIP_RAND() is rand(), which every
+ * process seeds alike.
+ */
+static uint16_t resolver_random16()
+{
+    uint16_t r;
+    Utils::getSecureRandom(&r, sizeof(r));
+    return r;
+}
+
+/**
+ * Send a query, or join the one in flight. Without a lookup, only refreshes
+ * the cache.
+ */
+static int resolver_query(const NameType& key, Lookup* l, int slot)
+{
+    std::map<NameType, Query*>::iterator existing = queries.find(key);
+    if (existing != queries.end()) {
+        if (l) {
+            existing->second->waiters.push_back(std::make_pair(l, slot));
+        }
+        return ZTS_ERR_OK;
+    }
+    if (queries.size() >= ZTS_DNS_MAX_QUERIES) {
+        return ZTS_ERR_GENERAL;
+    }
+    Query* q = new Query();
+    q->name = key.first;
+    q->type = key.second;
+    q->id = resolver_random16();
+    q->attempt = 0;
+    resolver_select_servers(q->name, q->servers);
+    q->pcb = q->servers.empty() ? NULL : udp_new_ip_type(IPADDR_TYPE_ANY);
+    if (! q->pcb) {
+        delete q;
+        return ZTS_ERR_GENERAL;
+    }
+    // A random source port makes forged responses as hard to get accepted as
+    // the random ID does
+    err_t err = ERR_USE;
+    for (int i = 0; i < 4 && err != ERR_OK; i++) {
+        err = udp_bind(q->pcb, IP_ANY_TYPE, (u16_t)(1024 + resolver_random16() % (65536 - 1024)));
+    }
+    if (err != ERR_OK && udp_bind(q->pcb, IP_ANY_TYPE, 0) != ERR_OK) {
+        udp_remove(q->pcb);
+        delete q;
+        return ZTS_ERR_GENERAL;
+    }
+    udp_recv(q->pcb, resolver_recv, q);
+    if (l) {
+        q->waiters.push_back(std::make_pair(l, slot));
+    }
+    queries[key] = q;
+    resolver_send(q);
+    if (! timer_active) {
+        timer_active = true;
+        sys_timeout(ZTS_DNS_TIMER_INTERVAL, resolver_timer, NULL);
+    }
+    return ZTS_ERR_OK;
+}
+
+static void resolver_resolve(const std::string& name, uint16_t type, Lookup* l, int slot)
+{
+    NameType key(name, type);
+    std::map<NameType, Answer>::iterator a = cache.find(key);
+    const int64_t now = OSUtils::now();
+    if (a != cache.end() && a->second.expires > now) {
+        // Refresh names in use before they expire
+        if ((a->second.expires - now) * 10 < (int64_t)a->second.ttl * 1000 && a->second.ttl >= ZTS_DNS_PREFETCH_MIN_TTL) {
+            resolver_query(key, NULL, 0);
+        }
+        resolver_lookup_done(l, slot, a->second.err, a->second.addrs);
+        return;
+    }
+    if (resolver_query(key, l, slot) != ZTS_ERR_OK) {
+        resolver_lookup_done(l, slot, ZTS_ERR_GENERAL, std::vector<ip_addr_t>());
+    }
+}
+
+int resolver_lookup(const char* name, int family, zts_getaddrinfo_cb callback, void* arg)
+{
+    std::string n;
+    if (! name || ! callback || (family != ZTS_AF_INET && family != ZTS_AF_INET6 && family != ZTS_AF_UNSPEC)
+        || ! resolver_normalize(name, n)) {
+        return ZTS_ERR_ARG;
+    }
+    if (! resolver_start_thread()) {
+        return ZTS_ERR_GENERAL;
+    }
+    Lookup* l = new Lookup();
+    l->callback = callback;
+    l->arg = arg;
+    l->err[ZTS_DNS_SLOT_AAAA] = l->err[ZTS_DNS_SLOT_A] = ZTS_ERR_NO_RESULT;
+    // Addresses need no query
+    ip_addr_t addr;
+    if (ipaddr_aton(name, &addr)) {
+        std::vector<ip_addr_t> addrs;
+        if (family == ZTS_AF_UNSPEC || (family == ZTS_AF_INET) == (IP_IS_V4_VAL(addr) != 0)) {
+            addrs.push_back(addr);
+        }
+        l->pending = 1;
+        resolver_lookup_done(l, ZTS_DNS_SLOT_A, addrs.empty() ? ZTS_ERR_NO_RESULT : ZTS_ERR_OK, addrs);
+        return ZTS_ERR_OK;
+    }
+    // The lookup may be complete and gone after its last slot is resolved
+    l->pending = family == ZTS_AF_UNSPEC ? 2 : 1;
+    if (family != ZTS_AF_INET) {
+        resolver_resolve(n, ZTS_DNS_TYPE_AAAA, l, ZTS_DNS_SLOT_AAAA);
+    }
+    if (family != ZTS_AF_INET6) {
+        resolver_resolve(n, ZTS_DNS_TYPE_A, l, ZTS_DNS_SLOT_A);
+    }
+    return ZTS_ERR_OK;
+}
+
+void resolver_set_network_servers(uint64_t net_id, const char* domain, const std::vector<InetAddress>& servers)
+{
+    NetworkServers ns;
+    if (! domain || ! resolver_normalize(domain, ns.domain)) {
+        ns.domain.clear();
+    }
+    for (size_t i = 0; i < servers.size(); i++) {
+        if (servers[i].isV4() || servers[i].isV6()) {
+            ip_addr_t addr;
+            resolver_to_ip_addr(servers[i], addr);
+            ns.servers.push_back(addr);
+        }
+    }
+    Mutex::Lock _l(network_servers_m);
+    if (ns.servers.empty()) {
+        network_servers.erase(net_id);
+    }
+    else {
+        network_servers[net_id] = ns;
+    }
+}
+
+void resolver_remove_network(uint64_t net_id)
+{
+    Mutex::Lock _l(network_servers_m);
+    network_servers.erase(net_id);
+}
+
+}   // namespace ZeroTier
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * Asynchronous DNS resolver with a cache
+ */
+
+#ifndef ZTS_RESOLVER_HPP
+#define ZTS_RESOLVER_HPP
+
+#include "InetAddress.hpp"
+#include "ZeroTierSockets.h"
+
+#include <stdint.h>
+#include <vector>
+
+// Entries (one per name and address family) kept in the cache
+#define ZTS_DNS_CACHE_SIZE 1024
+// Bounds of the time (s) answers are cached for, taken from their TTL
+#define ZTS_DNS_MAX_TTL 86400
+// Time (s) a name that doesn't exist is cached for when the server doesn't
+// say (RFC 2308), and the upper bound when it does
+#define ZTS_DNS_NEGATIVE_TTL     60
+#define ZTS_DNS_MAX_NEGATIVE_TTL 3600
+// Answers are refreshed in the background when used within the last tenth of
+// their TTL, unless the TTL is shorter than this (s)
+#define ZTS_DNS_PREFETCH_MIN_TTL 10
+// Time (ms) to wait for an answer before asking again (the next server, if
+// any), and the number of times to ask
+#define ZTS_DNS_RETRY_INTERVAL 1000
+#define ZTS_DNS_MAX_ATTEMPTS   4
+// Concurrent queries, further lookups complete at once with ZTS_ERR_GENERAL
+#define ZTS_DNS_MAX_QUERIES 1024
+
+namespace ZeroTier {
+
+/**
+ * Resolve a name to its IPv4 and/or IPv6 addresses (`family` is `ZTS_AF_INET`,
+ * `ZTS_AF_INET6` or `ZTS_AF_UNSPEC`). The callback is called from the
+ * resolver's thread, never before this function returns. A lookup that would
+ * exceed ZTS_DNS_MAX_QUERIES completes with `ZTS_ERR_GENERAL`.
+ *
+ * @return `ZTS_ERR_OK` if the callback will be called, `ZTS_ERR_ARG` if invalid
+ *         argument, `ZTS_ERR_GENERAL` if the resolver's thread can't be started
+ */
+int resolver_lookup(const char* name, int family, zts_getaddrinfo_cb callback, void* arg);
+
+/**
+ * Set the DNS servers a network's configuration delivered, and the domain they
+ * serve. Names in that domain are sent to those servers, other names to the
+ * servers set with zts_dns_set_server(), or to those of any network if there
+ * are none.
+ */
+void resolver_set_network_servers(uint64_t net_id, const char* domain, const std::vector<InetAddress>& servers);
+
+/**
+ * Forget the DNS servers of a network that went down
+ */
+void resolver_remove_network(uint64_t net_id);
+
+}   // namespace ZeroTier
+
+#endif
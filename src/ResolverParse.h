@@ -0,0 +1,63 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * DNS response parsing of the resolver (see Resolver.cpp), exposed as C so that
+ * the selftest can exercise it without a DNS server
+ */
+
+#ifndef ZTS_RESOLVER_PARSE_H
+#define ZTS_RESOLVER_PARSE_H
+
+#include "ZeroTierSockets.h"
+
+#include <stdint.h>
+
+// Not a response to the query, keep waiting
+#define ZTS_DNS_PARSE_IGNORE 0
+// The server failed or the response is unusable, ask the next server
+#define ZTS_DNS_PARSE_RETRY 1
+// The response holds the result
+#define ZTS_DNS_PARSE_DONE 2
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Parse a response `msg` to the query with ID `id` for `name` (lower case,
+ * without a trailing dot) and record `type`. For `ZTS_DNS_PARSE_DONE`, `err`
+ * is `ZTS_ERR_OK` or `ZTS_ERR_NO_RESULT`, up to `*count` addresses are stored
+ * in `addrs` and their number in `*count`, and `ttl` is the time (s) the
+ * result may be cached for.
+ *
+ * @return `ZTS_DNS_PARSE_IGNORE`, `ZTS_DNS_PARSE_RETRY` or `ZTS_DNS_PARSE_DONE`
+ */
+int zts_dns_parse(
+    uint16_t id,
+    const char* name,
+    uint16_t type,
+    const uint8_t* msg,
+    unsigned int len,
+    int* err,
+    struct zts_sockaddr_storage* addrs,
+    unsigned int* count,
+    uint32_t* ttl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -19,10 +19,25 @@
 
 #include "lwip/sockets.h"
 
+#include "ChecksumOffload.h"
 #include "Events.hpp"
+#include "Mutex.hpp"
+#include "Resolver.hpp"
+#include "TcpAutotune.hpp"
+#include "TcpCongestion.hpp"
+#include "TcpRecovery.hpp"
+#include "TcpSynCookies.hpp"
+#include "TcpTimeWait.hpp"
+#include "VirtualTap.hpp"
 #include "ZeroTierSockets.h"
 #include "lwip/dns.h"
+#include "lwip/ip.h"
+#include "lwip/nd6.h"
 #include "lwip/netdb.h"
+#include "lwip/priv/sockets_priv.h"
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/tcpip.h"
+#include "lwip_hooks.h"
 
 #if defined(__ANDROID__)
 #include <sys/endian.h>
@@ -32,6 +47,53 @@ int zts_errno;
 
 namespace ZeroTier {
 
+//----------------------------------------------------------------------------//
+// Socket limit                                                               //
+//----------------------------------------------------------------------------//
+
+// lwIP's socket table is a static array of MEMP_NUM_NETCONN entries indexed by
+// descriptor, this enforces the (lower) limit set at initialization
+
+unsigned int max_sockets = ZTS_MAX_SOCKETS;
+static unsigned int open_sockets = 0;
+static Mutex sockets_m;
+
+static int socket_reserve()
+{
+    Mutex::Lock _l(sockets_m);
+    if (open_sockets >= max_sockets) {
+        zts_errno = ZTS_EMFILE;
+        return 0;
+    }
+    open_sockets++;
+    return 1;
+}
+
+static void socket_release()
+{
+    Mutex::Lock _l(sockets_m);
+    if (open_sockets > 0) {
+        open_sockets--;
+    }
+}
+
+static int socket_limit_reached()
+{
+    Mutex::Lock _l(sockets_m);
+    if (open_sockets >= max_sockets) {
+        zts_errno = ZTS_EMFILE;
+        return 1;
+    }
+    return 0;
+}
+
+// Called once the stack has stopped, its sockets are gone with it
+void socket_count_reset()
+{
+    Mutex::Lock _l(sockets_m);
+    open_sockets = 0;
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -41,7 +103,14 @@ int zts_bsd_socket(const int socket_family, const int socket_type, const int pro
     if (! transport_ok()) {
         return ZTS_ERR_SERVICE;
     }
-    return lwip_socket(socket_family, socket_type, protocol);
+    if (! socket_reserve()) {
+        return ZTS_ERR_SOCKET;
+    }
+    int fd = lwip_socket(socket_family, socket_type, protocol);
+    if (fd < 0) {
+        socket_release();
+    }
+    return fd;
 }
 
 int zts_bsd_connect(int fd, const struct zts_sockaddr* addr, zts_socklen_t addrlen)
@@ -86,7 +155,18 @@ int zts_bsd_accept(int fd, struct zts_sockaddr* addr, zts_socklen_t* addrlen)
     if (! transport_ok()) {
         return ZTS_ERR_SERVICE;
     }
-    return lwip_accept(fd, (sockaddr*)addr, (socklen_t*)addrlen);
+    // Leaves the connection queued. A slot is only taken once accept returns,
+    // so that threads blocked here don't count against the limit.
+    if (socket_limit_reached()) {
+        return ZTS_ERR_SOCKET;
+    }
+    int acc_fd = lwip_accept(fd, (sockaddr*)addr, (socklen_t*)addrlen);
+    if (acc_fd >= 0 && ! socket_reserve()) {
+        // Other sockets were opened while waiting
+        lwip_close(acc_fd);
+        return ZTS_ERR_SOCKET;
+    }
+    return acc_fd;
 }
 
 int zts_bsd_setsockopt(int fd, int level, int optname, const void* optval, zts_socklen_t optlen)
@@ -138,7 +218,11 @@ int zts_bsd_close(int fd)
     if (! transport_ok()) {
         return ZTS_ERR_SERVICE;
     }
-    return lwip_close(fd);
+    int err = lwip_close(fd);
+    if (err == 0) {
+        socket_release();
+    }
+    return err;
 }
 
 int zts_bsd_select(
@@ -302,6 +386,8 @@ struct zts_hostent* zts_bsd_gethostbyname(const char* name)
     if (! name) {
         return NULL;
     }
+    // Cached answers are only aged while the stack's timers run
+    zts_lwip_wake_driver();
     return (struct zts_hostent*)lwip_gethostbyname(name);
 }
 
@@ -331,6 +417,20 @@ const zts_ip_addr* zts_dns_get_server(uint8_t index)
     return (const zts_ip_addr*)dns_getserver(index);
 }
 
+int zts_getaddrinfo_async(const char* name, int family, zts_getaddrinfo_cb callback, void* arg)
+{
+    if (! transport_ok()) {
+        return ZTS_ERR_SERVICE;
+    }
+    if (! name || ! callback) {
+        return ZTS_ERR_ARG;
+    }
+    LOCK_TCPIP_CORE();
+    int err = resolver_lookup(name, family, callback, arg);
+    UNLOCK_TCPIP_CORE();
+    return err;
+}
+
 char* zts_ipaddr_ntoa(const zts_ip_addr* addr)
 {
     return ipaddr_ntoa((ip_addr_t*)addr);
@@ -880,6 +980,20 @@ int zts_get_ttl(int fd)
     return ttl;
 }
 
+int zts_set_tx_class(int fd, int tx_class)
+{
+    if (! transport_ok()) {
+        return ZTS_ERR_SERVICE;
+    }
+    // EF, AF41, default, CS1 (see TxShaper::classify)
+    static const int dscp[ZTS_TX_CLASS_COUNT] = { 46, 34, 0, 8 };
+    if (tx_class < 0 || tx_class >= ZTS_TX_CLASS_COUNT) {
+        return ZTS_ERR_ARG;
+    }
+    int tos = dscp[tx_class] << 2;
+    return zts_bsd_setsockopt(fd, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+}
+
 int zts_set_blocking(int fd, int enabled)
 {
     if (! transport_ok()) {
@@ -935,6 +1049,64 @@ int zts_get_keepalive(int fd)
     return optval != 0;
 }
 
+int zts_get_tcp_info(int fd, zts_tcp_info_t* info)
+{
+    if (! transport_ok()) {
+        return ZTS_ERR_SERVICE;
+    }
+    if (! info) {
+        return ZTS_ERR_ARG;
+    }
+    zts_socklen_t optlen = sizeof(zts_tcp_info_t);
+    return zts_bsd_getsockopt(fd, ZTS_IPPROTO_TCP, ZTS_TCP_INFO, (void*)info, &optlen);
+}
+
+int zts_set_congestion_control(int fd, int algorithm)
+{
+    if (! transport_ok()) {
+        return ZTS_ERR_SERVICE;
+    }
+    if (algorithm < ZTS_TCP_CC_NEWRENO || algorithm > ZTS_TCP_CC_BBR) {
+        return ZTS_ERR_ARG;
+    }
+    return zts_bsd_setsockopt(fd, ZTS_IPPROTO_TCP, ZTS_TCP_CONGESTION, &algorithm, sizeof(algorithm));
+}
+
+int zts_get_congestion_control(int fd)
+{
+    if (! transport_ok()) {
+        return ZTS_ERR_SERVICE;
+    }
+    int err, optval = 0;
+    zts_socklen_t optlen = sizeof(optval);
+    if ((err = zts_bsd_getsockopt(fd, ZTS_IPPROTO_TCP, ZTS_TCP_CONGESTION, (void*)&optval, &optlen)) < 0) {
+        return err;
+    }
+    return optval;
+}
+
+int zts_set_tcp_mem_limit(unsigned int max_bytes)
+{
+    if (! transport_ok()) {
+        return ZTS_ERR_SERVICE;
+    }
+    LOCK_TCPIP_CORE();
+    tcp_autotune_set_mem_limit(max_bytes);
+    UNLOCK_TCPIP_CORE();
+    return ZTS_ERR_OK;
+}
+
+int zts_get_tcp_mem_usage()
+{
+    if (! transport_ok()) {
+        return ZTS_ERR_SERVICE;
+    }
+    LOCK_TCPIP_CORE();
+    uint32_t used = tcp_autotune_get_mem_usage();
+    UNLOCK_TCPIP_CORE();
+    return (int)LWIP_MIN(used, (uint32_t)INT32_MAX);
+}
+
 int zts_util_ntop(struct zts_sockaddr* addr, zts_socklen_t addrlen, char* dst_str, int len, unsigned short* port)
 {
     if (! addr || addrlen < sizeof(struct zts_sockaddr_in) || addrlen > sizeof(struct zts_sockaddr_storage) || ! dst_str
@@ -956,6 +1128,207 @@ int zts_util_ntop(struct zts_sockaddr* addr, zts_socklen_t addrlen, char* dst_st
     return ZTS_ERR_ARG;
 }
 
+//----------------------------------------------------------------------------//
+// lwIP hooks                                                                 //
+//----------------------------------------------------------------------------//
+
+static void tcp_fill_info(struct tcp_pcb* pcb, zts_tcp_info_t* info)
+{
+    memset(info, 0, sizeof(zts_tcp_info_t));
+    info->state = pcb->state;
+    if (pcb->state == LISTEN) {
+        // Listening PCBs are a truncated struct tcp_pcb_listen
+        return;
+    }
+    info->mss = pcb->mss;
+    // sa and sv are scaled by 8 and 4 respectively, in TCP_SLOW_INTERVAL ticks
+    info->srtt_ms = (pcb->sa > 0 ? (uint32_t)(pcb->sa >> 3) : 0) * TCP_SLOW_INTERVAL;
+    info->rttvar_ms = (pcb->sv > 0 ? (uint32_t)(pcb->sv >> 2) : 0) * TCP_SLOW_INTERVAL;
+    info->rto_ms = (pcb->rto > 0 ? (uint32_t)pcb->rto : 0) * TCP_SLOW_INTERVAL;
+    info->cwnd = pcb->cwnd;
+    info->ssthresh = pcb->ssthresh;
+    info->snd_wnd = pcb->snd_wnd;
+    info->snd_wnd_max = pcb->snd_wnd_max;
+    info->rcv_wnd = pcb->rcv_wnd;
+    info->rcv_ann_wnd = pcb->rcv_ann_wnd;
+#if LWIP_WND_SCALE
+    info->snd_wscale = pcb->snd_scale;
+    info->rcv_wscale = pcb->rcv_scale;
+#endif
+    info->snd_buf = pcb->snd_buf;
+    info->snd_queuelen = pcb->snd_queuelen;
+    info->bytes_in_flight = pcb->snd_nxt - pcb->lastack;
+    for (struct tcp_seg* seg = pcb->unsent; seg != NULL; seg = seg->next) {
+        info->bytes_unsent += seg->len;
+    }
+    info->retransmits = pcb->nrtx;
+    info->dupacks = pcb->dupacks;
+#if TCP_QUEUE_OOSEQ
+    for (struct tcp_seg* seg = pcb->ooseq; seg != NULL; seg = seg->next) {
+        info->ooseq_segs++;
+        info->ooseq_bytes += seg->len;
+    }
+#endif
+    info->in_fast_recovery = (pcb->flags & TF_INFR) != 0;
+    tcp_autotune_get(pcb, &info->rcv_wnd_limit, &info->snd_buf_limit);
+}
+
+err_t zts_lwip_hook_tcp_inpacket(
+    struct tcp_pcb* pcb,
+    struct tcp_hdr* hdr,
+    u16_t optlen,
+    u16_t opt1len,
+    u8_t* opt2,
+    struct pbuf* p)
+{
+    struct tcp_in_opts opts;
+    tcp_parse_opts(hdr, optlen, opt1len, opt2, &opts);
+    if (tcp_tw_recycle(pcb, hdr, optlen, &opts, p) || tcp_syncookie_input(pcb, hdr, optlen, &opts, p)) {
+        return ERR_ABRT;
+    }
+    if (! tcp_paws_check(pcb, hdr, &opts)) {
+        return ERR_VAL;
+    }
+    tcp_sack_input(pcb, hdr, &opts);
+    tcp_cc_input(pcb, hdr);
+    tcp_autotune_input(pcb, hdr, &opts);
+    return ERR_OK;
+}
+
+/**
+ * Have lwIP generate the checksum of a TCP segment if it doesn't fit into one
+ * frame. The segment is fragmented then, and zts_lwip_eth_tx() only fills in
+ * the checksum of whole segments. This happens to segments queued before the
+ * MTU was lowered. The setting lasts until the next segment, checksums lwIP
+ * generated meanwhile are kept by zts_lwip_eth_tx().
+ */
+static void tcp_checksum_output(const struct tcp_pcb* pcb, const struct pbuf* p, const struct tcp_hdr* hdr)
+{
+    struct netif* n = ip_route(&pcb->local_ip, &pcb->remote_ip);
+    if (! n) {
+        return;
+    }
+    unsigned int len = p->tot_len - (unsigned int)((const u8_t*)hdr - (const u8_t*)p->payload);
+    bool whole = zts_tcp_fits_mtu(len, 0, n->mtu);
+#if LWIP_IPV6
+    if (IP_IS_V6(&pcb->remote_ip)) {
+        whole = ! netif_mtu6(n) || zts_tcp_fits_mtu(len, 1, nd6_get_destination_mtu(ip_2_ip6(&pcb->remote_ip), n));
+    }
+#endif
+    if (whole) {
+        n->chksum_flags = (u16_t)(n->chksum_flags & ~NETIF_CHECKSUM_GEN_TCP);
+    }
+    else {
+        n->chksum_flags = (u16_t)(n->chksum_flags | NETIF_CHECKSUM_GEN_TCP);
+    }
+}
+
+u32_t* zts_lwip_hook_tcp_out_add_tcpopts(struct pbuf* p, struct tcp_hdr* hdr, const struct tcp_pcb* pcb, u32_t* opts)
+{
+    if (pcb) {
+        tcp_checksum_output(pcb, p, hdr);
+    }
+    tcp_autotune_output(pcb, hdr);
+    // Whatever is left between lwIP's own options and the payload was reserved
+    // by zts_lwip_hook_tcp_out_tcpopt_length()
+    if ((u8_t*)hdr + TCPH_HDRLEN_BYTES(hdr) - (u8_t*)opts >= ZTS_TCP_OPT_LEN_NOCSUM) {
+        *opts++ = PP_HTONL(
+            ((u32_t)ZTS_TCP_OPT_EXP << 24) | ((u32_t)ZTS_TCP_OPT_LEN_NOCSUM << 16) | ZTS_TCP_OPT_EXID_NOCSUM);
+    }
+    return opts;
+}
+
+u8_t zts_lwip_hook_tcp_out_tcpopt_length(const struct tcp_pcb* pcb, u8_t internal_len)
+{
+    // Connection requests are enqueued before the PCB leaves CLOSED
+    if (pcb && pcb->state != LISTEN && pcb->state < ESTABLISHED) {
+        return internal_len + ZTS_TCP_OPT_LEN_NOCSUM;
+    }
+    return internal_len;
+}
+
+/**
+ * Return the TCP PCB of a socket, or an errno value if there is none
+ */
+static int sock_get_tcp_pcb(struct lwip_sock* sock, struct tcp_pcb** pcb)
+{
+    if (! sock->conn || NETCONNTYPE_GROUP(netconn_type(sock->conn)) != NETCONN_TCP) {
+        return ENOPROTOOPT;
+    }
+    if (! sock->conn->pcb.tcp) {
+        return ENOTCONN;
+    }
+    *pcb = sock->conn->pcb.tcp;
+    return 0;
+}
+
+int zts_lwip_hook_getsockopt(
+    int s,
+    struct lwip_sock* sock,
+    int level,
+    int optname,
+    void* optval,
+    socklen_t* optlen,
+    int* err)
+{
+    LWIP_UNUSED_ARG(s);
+    if (level != IPPROTO_TCP) {
+        return 0;
+    }
+    struct tcp_pcb* pcb = NULL;
+    switch (optname) {
+        case ZTS_TCP_INFO:
+            if (*optlen < (socklen_t)sizeof(zts_tcp_info_t)) {
+                *err = EINVAL;
+                return 1;
+            }
+            if ((*err = sock_get_tcp_pcb(sock, &pcb)) != 0) {
+                return 1;
+            }
+            tcp_fill_info(pcb, (zts_tcp_info_t*)optval);
+            *optlen = sizeof(zts_tcp_info_t);
+            return 1;
+        case ZTS_TCP_CONGESTION:
+            if (*optlen < (socklen_t)sizeof(int)) {
+                *err = EINVAL;
+                return 1;
+            }
+            if ((*err = sock_get_tcp_pcb(sock, &pcb)) != 0) {
+                return 1;
+            }
+            *(int*)optval = tcp_cc_get(pcb);
+            *optlen = sizeof(int);
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+int zts_lwip_hook_setsockopt(
+    int s,
+    struct lwip_sock* sock,
+    int level,
+    int optname,
+    const void* optval,
+    socklen_t optlen,
+    int* err)
+{
+    LWIP_UNUSED_ARG(s);
+    if (level != IPPROTO_TCP || optname != ZTS_TCP_CONGESTION) {
+        return 0;
+    }
+    if (optlen < (socklen_t)sizeof(int)) {
+        *err = EINVAL;
+        return 1;
+    }
+    struct tcp_pcb* pcb = NULL;
+    if ((*err = sock_get_tcp_pcb(sock, &pcb)) != 0) {
+        return 1;
+    }
+    *err = tcp_cc_set(pcb, *(const int*)optval) == ZTS_ERR_OK ? 0 : EINVAL;
+    return 1;
+}
+
 #ifdef __cplusplus
 }
 #endif
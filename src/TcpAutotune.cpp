@@ -0,0 +1,274 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * TCP receive window and send buffer autotuning
+ *
+ * TCP_WND and TCP_SND_BUF in lwipopts.h only act as upper bounds. Every
+ * connection starts with a small receive window and send buffer, which grow
+ * once per round trip to twice what the connection actually moved during the
+ * previous round trip (an approximation of its bandwidth-delay product). The
+ * sum over all connections is bounded by a global limit, and connections shrink
+ * back towards the minimum while that limit is exceeded.
+ *
+ * lwIP has no notion of per-connection limits, so they are enforced from hooks:
+ * the send buffer by adjusting `snd_buf` before each inbound segment is
+ * processed, the receive window by clamping the window field of outgoing
+ * segments. The window is never clamped below what was previously advertised,
+ * so the right edge of the window never moves backwards. A connection gets its
+ * initial limits from the segment that completes the handshake, before lwIP
+ * processes it, so the application never sees lwIP's full send buffer.
+ */
+
+#include "TcpAutotune.hpp"
+
+#include "TcpRecovery.hpp"
+#include "lwip/def.h"
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/prot/tcp.h"
+#include "lwip/sys.h"
+#include "lwip/tcp.h"
+
+#define AT_EXT_ID_NONE 0xff
+
+#define AT_RCV_MIN  (4 * TCP_MSS)
+#define AT_RCV_INIT (16 * TCP_MSS)
+#define AT_RCV_MAX  TCP_WND
+// The socket layer only reports a socket as writable while more than
+// TCP_SNDLOWAT bytes are free, so the send buffer can never be smaller
+#define AT_SND_MIN (TCP_SNDLOWAT + 2 * TCP_MSS)
+#define AT_SND_MAX TCP_SND_BUF
+
+#define AT_MEM_LIMIT_DEFAULT (64 * 1024 * 1024)
+#define AT_RTT_DEFAULT       100   // ms, used until the first RTT sample
+#define AT_RTT_MIN           1
+
+namespace ZeroTier {
+
+static u8_t at_ext_id = AT_EXT_ID_NONE;
+static u32_t at_mem_limit = AT_MEM_LIMIT_DEFAULT;
+static u32_t at_mem_used = 0;
+
+struct tcp_autotune_state {
+    u32_t rcv_limit;
+    u32_t snd_limit;
+    // Right edge of the last window we advertised
+    u32_t rcv_edge;
+    u8_t rcv_edge_valid;
+    // Smoothed RTT (ms), 0 until the first sample
+    u32_t rtt;
+    // Sender side RTT sample: time until snd_seq is acknowledged
+    u32_t snd_seq;
+    u32_t snd_ts;
+    u8_t snd_sampling;
+    // Receiver side RTT sample: time until a full window has been received
+    u32_t rcv_seq;
+    u32_t rcv_ts;
+    u8_t rcv_sampling;
+    // Bytes received during the current round, valid once established
+    u32_t round_seq;
+    u32_t round_ts;
+    u8_t round_valid;
+};
+
+/**
+ * Resize a limit towards target, charging or releasing the difference against
+ * the global limit. Growth is truncated once the global limit is reached.
+ */
+static void at_resize(u32_t* limit, u32_t target)
+{
+    if (target > *limit) {
+        u32_t delta = target - *limit;
+        u32_t avail = at_mem_limit > at_mem_used ? at_mem_limit - at_mem_used : 0;
+        delta = LWIP_MIN(delta, avail);
+        *limit += delta;
+        at_mem_used += delta;
+    }
+    else {
+        at_mem_used -= *limit - target;
+        *limit = target;
+    }
+}
+
+static void at_destroy(u8_t id, void* data)
+{
+    LWIP_UNUSED_ARG(id);
+    struct tcp_autotune_state* st = (struct tcp_autotune_state*)data;
+    if (st) {
+        at_mem_used -= st->rcv_limit + st->snd_limit;
+        delete st;
+    }
+}
+
+static const struct tcp_ext_arg_callbacks at_callbacks = { at_destroy, NULL };
+
+static void at_rtt_sample(struct tcp_autotune_state* st, u32_t sample)
+{
+    sample = LWIP_MAX(sample, AT_RTT_MIN);
+    if (st->rtt == 0 || sample < st->rtt) {
+        st->rtt = sample;
+    }
+    else {
+        st->rtt = (7 * st->rtt + sample) / 8;
+    }
+}
+
+void tcp_autotune_input(struct tcp_pcb* pcb, struct tcp_hdr* hdr, const struct tcp_in_opts* opts)
+{
+    if (pcb->state < SYN_SENT || pcb->state == TIME_WAIT) {
+        return;
+    }
+    if (at_ext_id == AT_EXT_ID_NONE) {
+        at_ext_id = tcp_ext_arg_alloc_id();
+    }
+    u32_t now = sys_now();
+    struct tcp_autotune_state* st = (struct tcp_autotune_state*)tcp_ext_arg_get(pcb, at_ext_id);
+    if (! st) {
+        st = new tcp_autotune_state();
+        st->rcv_limit = AT_RCV_INIT;
+        st->snd_limit = AT_SND_MIN;
+        at_mem_used += st->rcv_limit + st->snd_limit;
+        tcp_ext_arg_set_callbacks(pcb, at_ext_id, &at_callbacks);
+        tcp_ext_arg_set(pcb, at_ext_id, st);
+    }
+    if (pcb->state < ESTABLISHED) {
+        // This segment may complete the handshake, after which the application
+        // can write right away. Only our SYN is queued, and it doesn't take up
+        // send buffer space.
+        u32_t queued = pcb->snd_lbb - pcb->lastack - 1;
+        pcb->snd_buf = (tcpwnd_size_t)(st->snd_limit > queued ? st->snd_limit - queued : 0);
+        return;
+    }
+    if (! st->round_valid) {
+        st->round_seq = pcb->rcv_nxt;
+        st->round_ts = now;
+        st->round_valid = 1;
+    }
+
+    // RTT samples: lwIP's timestamp values are sys_now(), so an echoed one
+    // yields an exact sample. Otherwise estimate from whichever direction is
+    // carrying data.
+    if (opts->has_ts && opts->tsecr != 0) {
+        if ((TCPH_FLAGS(hdr) & TCP_ACK) && TCP_SEQ_GT(hdr->ackno, pcb->lastack)) {
+            at_rtt_sample(st, now - opts->tsecr);
+        }
+    }
+    else if (TCPH_FLAGS(hdr) & TCP_ACK) {
+        if (st->snd_sampling && TCP_SEQ_GEQ(hdr->ackno, st->snd_seq)) {
+            at_rtt_sample(st, now - st->snd_ts);
+            st->snd_sampling = 0;
+        }
+        if (! st->snd_sampling && pcb->snd_nxt != pcb->lastack) {
+            st->snd_seq = pcb->snd_nxt;
+            st->snd_ts = now;
+            st->snd_sampling = 1;
+        }
+    }
+    if (st->rcv_sampling && TCP_SEQ_GEQ(pcb->rcv_nxt, st->rcv_seq)) {
+        // Only an upper bound unless the sender is window limited
+        at_rtt_sample(st, now - st->rcv_ts);
+        st->rcv_sampling = 0;
+    }
+    if (! st->rcv_sampling && st->rcv_edge_valid && TCP_SEQ_GT(st->rcv_edge, pcb->rcv_nxt)) {
+        st->rcv_seq = st->rcv_edge;
+        st->rcv_ts = now;
+        st->rcv_sampling = 1;
+    }
+
+    if (at_mem_used > at_mem_limit) {
+        // Memory pressure: give back a quarter per segment until below the limit
+        at_resize(&st->rcv_limit, LWIP_MAX(st->rcv_limit - st->rcv_limit / 4, (u32_t)AT_RCV_MIN));
+        at_resize(&st->snd_limit, LWIP_MAX(st->snd_limit - st->snd_limit / 4, (u32_t)AT_SND_MIN));
+    }
+    else {
+        u32_t rtt = st->rtt ? st->rtt : AT_RTT_DEFAULT;
+        if (now - st->round_ts >= rtt) {
+            u32_t received = pcb->rcv_nxt - st->round_seq;
+            if (2 * received > st->rcv_limit) {
+                at_resize(&st->rcv_limit, LWIP_MIN(2 * received, (u32_t)AT_RCV_MAX));
+            }
+            st->round_seq = pcb->rcv_nxt;
+            st->round_ts = now;
+        }
+        // cwnd is what the sender may have in flight per round trip
+        u32_t snd_target = LWIP_MIN(2 * (u32_t)pcb->cwnd, (u32_t)AT_SND_MAX);
+        if (snd_target > st->snd_limit) {
+            at_resize(&st->snd_limit, snd_target);
+        }
+    }
+
+    // Bytes written by the application but not yet acknowledged
+    u32_t queued = pcb->snd_lbb - pcb->lastack;
+    pcb->snd_buf = (tcpwnd_size_t)(st->snd_limit > queued ? st->snd_limit - queued : 0);
+}
+
+void tcp_autotune_output(const struct tcp_pcb* pcb, struct tcp_hdr* hdr)
+{
+    if (! pcb || at_ext_id == AT_EXT_ID_NONE) {
+        return;
+    }
+    if ((TCPH_FLAGS(hdr) & (TCP_SYN | TCP_ACK)) != TCP_ACK) {
+        return;
+    }
+    struct tcp_autotune_state* st = (struct tcp_autotune_state*)tcp_ext_arg_get(pcb, at_ext_id);
+    if (! st) {
+        return;
+    }
+#if LWIP_WND_SCALE
+    u8_t scale = pcb->rcv_scale;
+#else
+    u8_t scale = 0;
+#endif
+    u32_t ackno = lwip_ntohl(hdr->ackno);
+    u32_t wnd = (u32_t)lwip_ntohs(hdr->wnd) << scale;
+    u32_t floor = 0;
+    if (st->rcv_edge_valid && TCP_SEQ_GT(st->rcv_edge, ackno)) {
+        floor = st->rcv_edge - ackno;
+    }
+    u32_t clamped = LWIP_MIN(wnd, LWIP_MAX(st->rcv_limit, floor));
+    // Round up so that scaling can't move the right edge backwards
+    u32_t scaled = LWIP_MIN((clamped + (1U << scale) - 1) >> scale, (u32_t)lwip_ntohs(hdr->wnd));
+    hdr->wnd = lwip_htons((u16_t)scaled);
+    u32_t edge = ackno + (scaled << scale);
+    if (! st->rcv_edge_valid || TCP_SEQ_GT(edge, st->rcv_edge)) {
+        st->rcv_edge = edge;
+        st->rcv_edge_valid = 1;
+    }
+}
+
+void tcp_autotune_get(const struct tcp_pcb* pcb, uint32_t* rcv_wnd, uint32_t* snd_buf)
+{
+    *rcv_wnd = *snd_buf = 0;
+    if (at_ext_id == AT_EXT_ID_NONE || pcb->state == LISTEN) {
+        return;
+    }
+    struct tcp_autotune_state* st = (struct tcp_autotune_state*)tcp_ext_arg_get(pcb, at_ext_id);
+    if (st) {
+        *rcv_wnd = st->rcv_limit;
+        *snd_buf = st->snd_limit;
+    }
+}
+
+void tcp_autotune_set_mem_limit(uint32_t bytes)
+{
+    at_mem_limit = bytes;
+}
+
+uint32_t tcp_autotune_get_mem_usage()
+{
+    return at_mem_used;
+}
+
+}   // namespace ZeroTier
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * TCP receive window and send buffer autotuning
+ */
+
+#ifndef ZTS_TCP_AUTOTUNE_HPP
+#define ZTS_TCP_AUTOTUNE_HPP
+
+#include <stdint.h>
+
+struct tcp_pcb;
+struct tcp_hdr;
+
+namespace ZeroTier {
+
+struct tcp_in_opts;
+
+/**
+ * Measure a PCB's RTT and delivery rate and resize its receive window and send
+ * buffer accordingly. Applies the initial limits while the PCB is still in
+ * SYN_SENT or SYN_RCVD. Called from the LWIP_HOOK_TCP_INPACKET_PCB hook.
+ */
+void tcp_autotune_input(struct tcp_pcb* pcb, struct tcp_hdr* hdr, const struct tcp_in_opts* opts);
+
+/**
+ * Clamp the window advertised by an outgoing segment to the autotuned receive
+ * window. Called from the LWIP_HOOK_TCP_OUT_ADD_TCPOPTS hook.
+ */
+void tcp_autotune_output(const struct tcp_pcb* pcb, struct tcp_hdr* hdr);
+
+/**
+ * Return the autotuned receive window and send buffer of a PCB, or `0` for
+ * both if the PCB is not (yet) autotuned. Must be called with the TCP/IP core
+ * lock held.
+ */
+void tcp_autotune_get(const struct tcp_pcb* pcb, uint32_t* rcv_wnd, uint32_t* snd_buf);
+
+/**
+ * Set the maximum total number of bytes that may be committed to receive
+ * windows and send buffers across all connections. Must be called with the
+ * TCP/IP core lock held.
+ */
+void tcp_autotune_set_mem_limit(uint32_t bytes);
+
+/**
+ * Return the total number of bytes currently committed to receive windows and
+ * send buffers. Must be called with the TCP/IP core lock held.
+ */
+uint32_t tcp_autotune_get_mem_usage();
+
+}   // namespace ZeroTier
+
+#endif
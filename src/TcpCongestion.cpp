@@ -0,0 +1,344 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * Pluggable TCP congestion control for lwIP
+ *
+ * lwIP only implements NewReno and offers no congestion control interface, so
+ * alternative algorithms are layered on top of it via LWIP_HOOK_TCP_INPACKET_PCB
+ * (see tcp_cc_input()). The hook runs for every inbound segment before lwIP
+ * processes it. At that point lwIP has already reacted to any loss signalled
+ * by earlier segments (fast retransmit or RTO), which we pick up and correct,
+ * and the ACK carried by the current segment tells us how much data was
+ * delivered. In congestion avoidance the selected algorithm then owns `cwnd`
+ * outright: `bytes_acked` is cleared so that lwIP's own linear increase never
+ * fires. Slow start and window inflation during fast recovery are left to lwIP.
+ *
+ * Per-connection state hangs off a tcp_pcb extension argument. Until the first
+ * ACK arrives (and always on listening PCBs) the extension argument only holds
+ * the selected algorithm as a small integer tag, so that it survives lwIP
+ * copying extension arguments from a PCB to its listening PCB.
+ */
+
+#include "TcpCongestion.hpp"
+
+#include "ZeroTierSockets.h"
+#include "lwip/def.h"
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/prot/tcp.h"
+#include "lwip/sys.h"
+#include "lwip/tcp.h"
+
+#include <math.h>
+#include <stdint.h>
+
+// CUBIC (RFC 8312)
+#define CC_CUBIC_C    0.4
+#define CC_CUBIC_BETA 0.7
+
+// BBR-style model
+#define CC_BBR_BW_ROUNDS      10      // Rounds covered by the max bandwidth filter
+#define CC_BBR_MIN_RTT_WINDOW 10000   // ms covered by the min RTT filter
+#define CC_BBR_FULL_BW_ROUNDS 3       // Rounds without growth before leaving startup
+#define CC_BBR_FULL_BW_GROWTH 1.25    // Growth considered significant during startup
+#define CC_BBR_GAIN_CYCLE_LEN 8
+
+#define CC_EXT_ID_NONE 0xff
+
+// Extension argument values below this are algorithm tags, not state pointers
+#define CC_IS_TAG(data) ((uintptr_t)(data) <= ZTS_TCP_CC_BBR)
+
+namespace ZeroTier {
+
+static const double bbr_gain_cycle[CC_BBR_GAIN_CYCLE_LEN] = { 1.25, 0.75, 1, 1, 1, 1, 1, 1 };
+
+static u8_t cc_ext_id = CC_EXT_ID_NONE;
+
+struct tcp_cc_state {
+    int algorithm;
+    // Bookkeeping shared by all algorithms
+    tcpwnd_size_t cwnd;   // cwnd as seen at the end of the previous segment
+    u8_t nrtx;
+    u8_t in_recovery;
+    u32_t delivered;
+    u32_t round_seq;   // Round ends when this sequence number is acknowledged
+    u32_t round_ts;
+    u32_t round_delivered;
+    u32_t round_count;
+    u32_t min_rtt;   // ms
+    u32_t min_rtt_ts;
+    // CUBIC
+    u32_t epoch_start;
+    double w_max;
+    double w_last_max;
+    double k;
+    double origin;
+    double w_est;
+    // BBR
+    u32_t bw[CC_BBR_BW_ROUNDS];   // Delivery rate samples (bytes/s)
+    u32_t full_bw;
+    u8_t full_bw_count;
+    u8_t filled_pipe;
+    u8_t cycle_idx;
+};
+
+static void cc_destroy(u8_t id, void* data)
+{
+    LWIP_UNUSED_ARG(id);
+    if (! CC_IS_TAG(data)) {
+        delete (struct tcp_cc_state*)data;
+    }
+}
+
+static err_t cc_passive_open(u8_t id, struct tcp_pcb_listen* lpcb, struct tcp_pcb* cpcb);
+
+static const struct tcp_ext_arg_callbacks cc_callbacks = { cc_destroy, cc_passive_open };
+
+static err_t cc_passive_open(u8_t id, struct tcp_pcb_listen* lpcb, struct tcp_pcb* cpcb)
+{
+    void* data = tcp_ext_arg_get((struct tcp_pcb*)lpcb, id);
+    if (data != NULL && CC_IS_TAG(data)) {
+        tcp_ext_arg_set_callbacks(cpcb, id, &cc_callbacks);
+        tcp_ext_arg_set(cpcb, id, data);
+    }
+    return ERR_OK;
+}
+
+int tcp_cc_set(struct tcp_pcb* pcb, int algorithm)
+{
+    if (algorithm < ZTS_TCP_CC_NEWRENO || algorithm > ZTS_TCP_CC_BBR) {
+        return ZTS_ERR_ARG;
+    }
+    if (cc_ext_id == CC_EXT_ID_NONE) {
+        cc_ext_id = tcp_ext_arg_alloc_id();
+    }
+    cc_destroy(cc_ext_id, tcp_ext_arg_get(pcb, cc_ext_id));
+    tcp_ext_arg_set_callbacks(pcb, cc_ext_id, &cc_callbacks);
+    tcp_ext_arg_set(pcb, cc_ext_id, (void*)(uintptr_t)algorithm);
+    return ZTS_ERR_OK;
+}
+
+int tcp_cc_get(struct tcp_pcb* pcb)
+{
+    if (cc_ext_id == CC_EXT_ID_NONE) {
+        return ZTS_TCP_CC_NEWRENO;
+    }
+    void* data = tcp_ext_arg_get(pcb, cc_ext_id);
+    if (CC_IS_TAG(data)) {
+        return (int)(uintptr_t)data;
+    }
+    return ((struct tcp_cc_state*)data)->algorithm;
+}
+
+//----------------------------------------------------------------------------//
+// CUBIC                                                                      //
+//----------------------------------------------------------------------------//
+
+static void cubic_on_loss(struct tcp_pcb* pcb, struct tcp_cc_state* cc, int timeout)
+{
+    double cwnd = cc->cwnd;
+    // Fast convergence
+    if (cwnd < cc->w_last_max) {
+        cc->w_last_max = cwnd;
+        cc->w_max = cwnd * (1 + CC_CUBIC_BETA) / 2;
+    }
+    else {
+        cc->w_max = cc->w_last_max = cwnd;
+    }
+    cc->epoch_start = 0;
+    // Replace lwIP's multiplicative decrease of 0.5 with CUBIC's 0.7
+    tcpwnd_size_t ssthresh = (tcpwnd_size_t)LWIP_MAX(cwnd * CC_CUBIC_BETA, 2.0 * pcb->mss);
+    pcb->ssthresh = ssthresh;
+    if (! timeout) {
+        pcb->cwnd = ssthresh + 3 * pcb->mss;
+    }
+}
+
+static void cubic_on_ack(struct tcp_pcb* pcb, struct tcp_cc_state* cc, u32_t acked, u32_t now)
+{
+    if (pcb->cwnd < pcb->ssthresh) {
+        return;
+    }
+    double mss = pcb->mss;
+    double cwnd = pcb->cwnd;
+    if (cc->epoch_start == 0) {
+        cc->epoch_start = now;
+        if (cwnd < cc->w_max) {
+            cc->k = cbrt((cc->w_max - cwnd) / mss / CC_CUBIC_C);
+            cc->origin = cc->w_max;
+        }
+        else {
+            cc->k = 0;
+            cc->origin = cwnd;
+        }
+        cc->w_est = cwnd;
+    }
+    double t = (double)(now - cc->epoch_start + cc->min_rtt) / 1000.0 - cc->k;
+    double target = cc->origin + CC_CUBIC_C * t * t * t * mss;
+    // Never grow slower than standard TCP would in the same situation
+    cc->w_est += 3 * CC_CUBIC_BETA / (2 - CC_CUBIC_BETA) * acked * mss / cwnd;
+    if (target < cc->w_est) {
+        target = cc->w_est;
+    }
+    double inc;
+    if (target > cwnd) {
+        inc = LWIP_MIN((target - cwnd) * acked / cwnd, acked / 2.0);
+    }
+    else {
+        inc = acked / 100.0;
+    }
+    pcb->cwnd = (tcpwnd_size_t)LWIP_MIN(cwnd + inc, (double)TCPWND_MAX);
+    pcb->bytes_acked = 0;
+}
+
+//----------------------------------------------------------------------------//
+// BBR-style                                                                  //
+//----------------------------------------------------------------------------//
+
+static u32_t bbr_max_bw(struct tcp_cc_state* cc)
+{
+    u32_t bw = 0;
+    for (int i = 0; i < CC_BBR_BW_ROUNDS; i++) {
+        bw = LWIP_MAX(bw, cc->bw[i]);
+    }
+    return bw;
+}
+
+static void bbr_on_round(struct tcp_cc_state* cc, u32_t bw)
+{
+    cc->bw[cc->round_count % CC_BBR_BW_ROUNDS] = bw;
+    u32_t max_bw = bbr_max_bw(cc);
+    if (! cc->filled_pipe) {
+        if (max_bw >= cc->full_bw * CC_BBR_FULL_BW_GROWTH) {
+            cc->full_bw = max_bw;
+            cc->full_bw_count = 0;
+        }
+        else if (++cc->full_bw_count >= CC_BBR_FULL_BW_ROUNDS) {
+            cc->filled_pipe = 1;
+        }
+    }
+    cc->cycle_idx = (cc->cycle_idx + 1) % CC_BBR_GAIN_CYCLE_LEN;
+}
+
+static void bbr_on_ack(struct tcp_pcb* pcb, struct tcp_cc_state* cc)
+{
+    if (! cc->filled_pipe || cc->min_rtt == 0) {
+        // Startup: exponential growth via lwIP's slow start
+        pcb->ssthresh = TCPWND_MAX;
+        return;
+    }
+    // No pacing is available, so cwnd alone carries the model: one BDP scaled
+    // by the probing gain, plus a few segments to absorb delayed ACKs.
+    double bdp = (double)bbr_max_bw(cc) * cc->min_rtt / 1000.0;
+    double target = bdp * bbr_gain_cycle[cc->cycle_idx] + 3.0 * pcb->mss;
+    target = LWIP_MAX(target, 4.0 * pcb->mss);
+    pcb->cwnd = (tcpwnd_size_t)LWIP_MIN(target, (double)TCPWND_MAX);
+    pcb->ssthresh = pcb->cwnd;
+    pcb->bytes_acked = 0;
+}
+
+//----------------------------------------------------------------------------//
+// Hook                                                                       //
+//----------------------------------------------------------------------------//
+
+static void cc_on_segment(struct tcp_pcb* pcb, struct tcp_cc_state* cc, u32_t ackno)
+{
+    u32_t now = sys_now();
+
+    // Losses detected by lwIP while processing the previous segment
+    if (pcb->flags & TF_INFR) {
+        if (! cc->in_recovery) {
+            cc->in_recovery = 1;
+            if (cc->algorithm == ZTS_TCP_CC_CUBIC) {
+                cubic_on_loss(pcb, cc, 0);
+            }
+        }
+        cc->nrtx = pcb->nrtx;
+        return;
+    }
+    cc->in_recovery = 0;
+    if (pcb->nrtx > cc->nrtx) {
+        if (cc->algorithm == ZTS_TCP_CC_CUBIC) {
+            cubic_on_loss(pcb, cc, 1);
+        }
+    }
+    cc->nrtx = pcb->nrtx;
+
+    if (TCP_SEQ_LEQ(ackno, pcb->lastack) || TCP_SEQ_GT(ackno, pcb->snd_nxt)) {
+        cc->cwnd = pcb->cwnd;
+        return;
+    }
+    u32_t acked = ackno - pcb->lastack;
+    cc->delivered += acked;
+
+    // Delivery rounds: one round trip elapses between sending snd_nxt and
+    // receiving an ACK that covers it. Yields RTT and delivery rate samples.
+    if (cc->round_ts == 0) {
+        cc->round_seq = pcb->snd_nxt;
+        cc->round_ts = now;
+        cc->round_delivered = cc->delivered;
+    }
+    else if (TCP_SEQ_GT(ackno, cc->round_seq)) {
+        u32_t elapsed = LWIP_MAX(now - cc->round_ts, 1);
+        if (cc->min_rtt == 0 || elapsed <= cc->min_rtt || now - cc->min_rtt_ts > CC_BBR_MIN_RTT_WINDOW) {
+            cc->min_rtt = elapsed;
+            cc->min_rtt_ts = now;
+        }
+        if (cc->algorithm == ZTS_TCP_CC_BBR) {
+            u64_t bw = (u64_t)(cc->delivered - cc->round_delivered) * 1000 / elapsed;
+            bbr_on_round(cc, (u32_t)LWIP_MIN(bw, 0xffffffffULL));
+        }
+        cc->round_count++;
+        cc->round_seq = pcb->snd_nxt;
+        cc->round_ts = now;
+        cc->round_delivered = cc->delivered;
+    }
+
+    if (cc->algorithm == ZTS_TCP_CC_CUBIC) {
+        cubic_on_ack(pcb, cc, acked, now);
+    }
+    else if (cc->algorithm == ZTS_TCP_CC_BBR) {
+        bbr_on_ack(pcb, cc);
+    }
+    cc->cwnd = pcb->cwnd;
+}
+
+void tcp_cc_input(struct tcp_pcb* pcb, struct tcp_hdr* hdr)
+{
+    if (cc_ext_id == CC_EXT_ID_NONE || pcb->state < ESTABLISHED || pcb->state == TIME_WAIT) {
+        return;
+    }
+    if (! (TCPH_FLAGS(hdr) & TCP_ACK)) {
+        return;
+    }
+    void* data = tcp_ext_arg_get(pcb, cc_ext_id);
+    if (data == NULL) {
+        return;
+    }
+    struct tcp_cc_state* cc;
+    if (CC_IS_TAG(data)) {
+        cc = new tcp_cc_state();
+        cc->algorithm = (int)(uintptr_t)data;
+        cc->cwnd = pcb->cwnd;
+        cc->nrtx = pcb->nrtx;
+        tcp_ext_arg_set(pcb, cc_ext_id, cc);
+    }
+    else {
+        cc = (struct tcp_cc_state*)data;
+    }
+    cc_on_segment(pcb, cc, hdr->ackno);
+}
+
+}   // namespace ZeroTier
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * Pluggable TCP congestion control for lwIP
+ */
+
+#ifndef ZTS_TCP_CONGESTION_HPP
+#define ZTS_TCP_CONGESTION_HPP
+
+struct tcp_pcb;
+struct tcp_hdr;
+
+namespace ZeroTier {
+
+/**
+ * Select the congestion control algorithm (`ZTS_TCP_CC_*`) used by a PCB.
+ * Listening PCBs pass their selection on to accepted connections. Must be
+ * called with the TCP/IP core lock held.
+ *
+ * @return `ZTS_ERR_OK` if successful, `ZTS_ERR_ARG` if unknown algorithm
+ */
+int tcp_cc_set(struct tcp_pcb* pcb, int algorithm);
+
+/**
+ * Return the congestion control algorithm (`ZTS_TCP_CC_*`) used by a PCB.
+ * Must be called with the TCP/IP core lock held.
+ */
+int tcp_cc_get(struct tcp_pcb* pcb);
+
+/**
+ * Run the congestion control algorithm selected for a PCB (if any) for an
+ * inbound segment, before lwIP processes it. Called from the
+ * LWIP_HOOK_TCP_INPACKET_PCB hook.
+ */
+void tcp_cc_input(struct tcp_pcb* pcb, struct tcp_hdr* hdr);
+
+}   // namespace ZeroTier
+
+#endif
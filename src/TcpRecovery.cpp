@@ -0,0 +1,315 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * SACK-based TCP loss recovery and timestamp (PAWS) checks for lwIP
+ *
+ * lwIP advertises SACK and generates SACK blocks for the remote host, but
+ * ignores the blocks it receives: fast retransmit resends the first
+ * unacknowledged segment only and recovery ends with the first new ACK, so
+ * every further hole in the same window costs either three more duplicate
+ * ACKs or a retransmission timeout.
+ *
+ * Here the SACK blocks of every inbound segment are merged into a per-PCB
+ * scoreboard. Once lwIP has entered fast recovery, each further ACK up to the
+ * recovery point (`snd_nxt` when recovery started) moves the next segment that
+ * lies below the highest SACKed sequence number and is not itself SACKed back
+ * onto the unsent queue, much like lwIP's own tcp_rexmit() does for the first
+ * one, i.e. one retransmission per returning ACK (RFC 6675, without the pipe
+ * estimate).
+ */
+
+#include "TcpRecovery.hpp"
+
+#include "lwip/def.h"
+#include "lwip/pbuf.h"
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/prot/tcp.h"
+#include "lwip/tcp.h"
+
+#include <string.h>
+
+#define SACK_EXT_ID_NONE    0xff
+#define SACK_SCOREBOARD_MAX 8
+
+#define TCP_OPT_EOL  0
+#define TCP_OPT_NOP  1
+#define TCP_OPT_MSS  2
+#define TCP_OPT_SACK 5
+#define TCP_OPT_TS   8
+
+namespace ZeroTier {
+
+static u8_t sack_ext_id = SACK_EXT_ID_NONE;
+
+struct tcp_sack_state {
+    // SACKed ranges above lastack, sorted and non-overlapping
+    u32_t left[SACK_SCOREBOARD_MAX];
+    u32_t right[SACK_SCOREBOARD_MAX];
+    u8_t num;
+    u8_t recovering;
+    u32_t recovery_point;
+    u32_t rexmit_high;   // Holes below this were already retransmitted
+};
+
+static void sack_destroy(u8_t id, void* data)
+{
+    LWIP_UNUSED_ARG(id);
+    delete (struct tcp_sack_state*)data;
+}
+
+static const struct tcp_ext_arg_callbacks sack_callbacks = { sack_destroy, NULL };
+
+static inline u8_t opt_byte(const u8_t* opt1, u16_t opt1len, const u8_t* opt2, u16_t i)
+{
+    return i < opt1len ? opt1[i] : opt2[i - opt1len];
+}
+
+static u32_t opt_u32(const u8_t* opt1, u16_t opt1len, const u8_t* opt2, u16_t i)
+{
+    return ((u32_t)opt_byte(opt1, opt1len, opt2, i) << 24) | ((u32_t)opt_byte(opt1, opt1len, opt2, i + 1) << 16)
+           | ((u32_t)opt_byte(opt1, opt1len, opt2, i + 2) << 8) | (u32_t)opt_byte(opt1, opt1len, opt2, i + 3);
+}
+
+void tcp_parse_opts(struct tcp_hdr* hdr, uint16_t optlen, uint16_t opt1len, const uint8_t* opt2, struct tcp_in_opts* opts)
+{
+    opts->mss = 0;
+    opts->has_ts = 0;
+    opts->num_sacks = 0;
+    const u8_t* opt1 = (const u8_t*)hdr + TCP_HLEN;
+    if (opt2 == NULL) {
+        opt1len = optlen;
+    }
+    u16_t i = 0;
+    while (i < optlen) {
+        u8_t kind = opt_byte(opt1, opt1len, opt2, i);
+        if (kind == TCP_OPT_EOL) {
+            return;
+        }
+        if (kind == TCP_OPT_NOP) {
+            i++;
+            continue;
+        }
+        if (i + 1 >= optlen) {
+            return;
+        }
+        u8_t len = opt_byte(opt1, opt1len, opt2, i + 1);
+        if (len < 2 || i + len > optlen) {
+            return;   // Malformed, lwIP will deal with it
+        }
+        if (kind == TCP_OPT_MSS && len == 4) {
+            opts->mss = (u16_t)((opt_byte(opt1, opt1len, opt2, i + 2) << 8) | opt_byte(opt1, opt1len, opt2, i + 3));
+        }
+        else if (kind == TCP_OPT_TS && len == 10) {
+            opts->has_ts = 1;
+            opts->tsval = opt_u32(opt1, opt1len, opt2, i + 2);
+            opts->tsecr = opt_u32(opt1, opt1len, opt2, i + 6);
+        }
+        else if (kind == TCP_OPT_SACK && (len - 2) % 8 == 0) {
+            for (u16_t j = i + 2; j < i + len && opts->num_sacks < ZTS_TCP_SACK_BLOCKS_MAX; j += 8) {
+                opts->sack_left[opts->num_sacks] = opt_u32(opt1, opt1len, opt2, j);
+                opts->sack_right[opts->num_sacks] = opt_u32(opt1, opt1len, opt2, j + 4);
+                opts->num_sacks++;
+            }
+        }
+        i += len;
+    }
+}
+
+int tcp_paws_check(struct tcp_pcb* pcb, struct tcp_hdr* hdr, const struct tcp_in_opts* opts)
+{
+#if LWIP_TCP_TIMESTAMPS
+    // Check the state first, LISTEN PCBs are a truncated struct tcp_pcb_listen
+    if (pcb->state < ESTABLISHED || ! opts->has_ts || ! (pcb->flags & TF_TIMESTAMP) || pcb->ts_recent == 0) {
+        return 1;
+    }
+    if (TCPH_FLAGS(hdr) & TCP_RST) {
+        return 1;
+    }
+    if ((s32_t)(opts->tsval - pcb->ts_recent) < 0) {
+        // Old duplicate: drop, but acknowledge (from the fast timer) so that
+        // the remote host resyncs
+        tcp_set_flags(pcb, TF_ACK_DELAY);
+        return 0;
+    }
+#else
+    LWIP_UNUSED_ARG(pcb);
+    LWIP_UNUSED_ARG(hdr);
+    LWIP_UNUSED_ARG(opts);
+#endif
+    return 1;
+}
+
+/**
+ * Merge a SACKed range into the scoreboard
+ */
+static void sack_insert(struct tcp_sack_state* st, u32_t left, u32_t right)
+{
+    u8_t i = 0;
+    while (i < st->num && TCP_SEQ_LT(st->right[i], left)) {
+        i++;
+    }
+    // Absorb every range that overlaps or touches [left, right)
+    u8_t j = i;
+    while (j < st->num && TCP_SEQ_LEQ(st->left[j], right)) {
+        if (TCP_SEQ_LT(st->left[j], left)) {
+            left = st->left[j];
+        }
+        if (TCP_SEQ_GT(st->right[j], right)) {
+            right = st->right[j];
+        }
+        j++;
+    }
+    u8_t absorbed = j - i;
+    if (absorbed == 0) {
+        if (st->num == SACK_SCOREBOARD_MAX) {
+            if (i == st->num) {
+                return;   // Keep the ranges closest to lastack
+            }
+            st->num--;
+        }
+        memmove(&st->left[i + 1], &st->left[i], (st->num - i) * sizeof(u32_t));
+        memmove(&st->right[i + 1], &st->right[i], (st->num - i) * sizeof(u32_t));
+        st->num++;
+    }
+    else if (absorbed > 1) {
+        memmove(&st->left[i + 1], &st->left[j], (st->num - j) * sizeof(u32_t));
+        memmove(&st->right[i + 1], &st->right[j], (st->num - j) * sizeof(u32_t));
+        st->num -= absorbed - 1;
+    }
+    st->left[i] = left;
+    st->right[i] = right;
+}
+
+/**
+ * Forget everything at or below the cumulative ACK
+ */
+static void sack_prune(struct tcp_sack_state* st, u32_t ackno)
+{
+    u8_t i = 0;
+    while (i < st->num && TCP_SEQ_LEQ(st->right[i], ackno)) {
+        i++;
+    }
+    if (i > 0) {
+        memmove(&st->left[0], &st->left[i], (st->num - i) * sizeof(u32_t));
+        memmove(&st->right[0], &st->right[i], (st->num - i) * sizeof(u32_t));
+        st->num -= i;
+    }
+    if (st->num > 0 && TCP_SEQ_LT(st->left[0], ackno)) {
+        st->left[0] = ackno;
+    }
+}
+
+static int sack_is_sacked(struct tcp_sack_state* st, u32_t seqno, u32_t end)
+{
+    for (u8_t i = 0; i < st->num; i++) {
+        if (TCP_SEQ_LEQ(st->left[i], seqno) && TCP_SEQ_GEQ(st->right[i], end)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Move the next hole below the highest SACKed sequence number from the unacked
+ * to the unsent queue, to be sent by the tcp_output() that follows input
+ * processing
+ */
+static void sack_rexmit_next_hole(struct tcp_pcb* pcb, struct tcp_sack_state* st)
+{
+    u32_t high_sacked = st->right[st->num - 1];
+    struct tcp_seg** prev = &pcb->unacked;
+    for (struct tcp_seg* seg = pcb->unacked; seg != NULL; prev = &seg->next, seg = seg->next) {
+        u32_t seqno = lwip_ntohl(seg->tcphdr->seqno);
+        u32_t end = seqno + TCP_TCPLEN(seg);
+        if (TCP_SEQ_GEQ(seqno, high_sacked)) {
+            return;
+        }
+        if (TCP_SEQ_LT(seqno, st->rexmit_high) || sack_is_sacked(st, seqno, end)) {
+            continue;
+        }
+        if (seg->p->ref != 1) {
+            return;   // Still referenced by the netif driver
+        }
+        // tcp_write() appends to the last unsent segment, so a short
+        // retransmission must never become the tail of the unsent queue
+        if (pcb->unsent == NULL && seg->len < pcb->mss) {
+            return;
+        }
+        *prev = seg->next;
+        struct tcp_seg** cur = &pcb->unsent;
+        while (*cur && TCP_SEQ_LT(lwip_ntohl((*cur)->tcphdr->seqno), seqno)) {
+            cur = &((*cur)->next);
+        }
+        seg->next = *cur;
+        *cur = seg;
+#if TCP_OVERSIZE
+        if (seg->next == NULL) {
+            pcb->unsent_oversize = 0;
+        }
+#endif
+        pcb->rttest = 0;
+        st->rexmit_high = end;
+        return;
+    }
+}
+
+void tcp_sack_input(struct tcp_pcb* pcb, struct tcp_hdr* hdr, const struct tcp_in_opts* opts)
+{
+    if (pcb->state < ESTABLISHED || pcb->state == TIME_WAIT || ! (TCPH_FLAGS(hdr) & TCP_ACK)) {
+        return;
+    }
+    if (sack_ext_id == SACK_EXT_ID_NONE) {
+        sack_ext_id = tcp_ext_arg_alloc_id();
+    }
+    struct tcp_sack_state* st = (struct tcp_sack_state*)tcp_ext_arg_get(pcb, sack_ext_id);
+    if (! st) {
+        if (opts->num_sacks == 0) {
+            return;   // Most connections never see a loss
+        }
+        st = new tcp_sack_state();
+        tcp_ext_arg_set_callbacks(pcb, sack_ext_id, &sack_callbacks);
+        tcp_ext_arg_set(pcb, sack_ext_id, st);
+    }
+    u32_t ackno = hdr->ackno;
+    if (TCP_SEQ_LT(ackno, pcb->lastack) || TCP_SEQ_GT(ackno, pcb->snd_nxt)) {
+        return;
+    }
+    for (u8_t i = 0; i < opts->num_sacks; i++) {
+        u32_t left = opts->sack_left[i];
+        u32_t right = opts->sack_right[i];
+        // Ignore D-SACKs and anything outside of what is in flight
+        if (TCP_SEQ_GEQ(left, right) || TCP_SEQ_LEQ(right, ackno) || TCP_SEQ_GT(right, pcb->snd_nxt)) {
+            continue;
+        }
+        sack_insert(st, TCP_SEQ_LT(left, ackno) ? ackno : left, right);
+    }
+    sack_prune(st, ackno);
+
+    if (st->recovering && TCP_SEQ_GEQ(ackno, st->recovery_point)) {
+        st->recovering = 0;
+    }
+    if (! st->recovering && (pcb->flags & TF_INFR)) {
+        // lwIP has just retransmitted the segment at lastack
+        st->recovering = 1;
+        st->recovery_point = pcb->snd_nxt;
+        st->rexmit_high = pcb->lastack + 1;
+    }
+    if (st->recovering && st->num > 0) {
+        sack_rexmit_next_hole(pcb, st);
+    }
+}
+
+}   // namespace ZeroTier
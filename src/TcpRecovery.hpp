@@ -0,0 +1,66 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * SACK-based TCP loss recovery and timestamp (PAWS) checks for lwIP
+ */
+
+#ifndef ZTS_TCP_RECOVERY_HPP
+#define ZTS_TCP_RECOVERY_HPP
+
+#include <stdint.h>
+
+struct tcp_pcb;
+struct tcp_hdr;
+
+#define ZTS_TCP_SACK_BLOCKS_MAX 4
+
+namespace ZeroTier {
+
+/**
+ * TCP options of an inbound segment that are of interest to libzt
+ */
+struct tcp_in_opts {
+    uint16_t mss;   // 0 if absent
+    uint8_t has_ts;
+    uint32_t tsval;
+    uint32_t tsecr;
+    uint8_t num_sacks;
+    uint32_t sack_left[ZTS_TCP_SACK_BLOCKS_MAX];
+    uint32_t sack_right[ZTS_TCP_SACK_BLOCKS_MAX];
+};
+
+/**
+ * Parse the options of an inbound segment as presented to the
+ * LWIP_HOOK_TCP_INPACKET_PCB hook (the options may be split across two pbufs).
+ */
+void tcp_parse_opts(struct tcp_hdr* hdr, uint16_t optlen, uint16_t opt1len, const uint8_t* opt2, struct tcp_in_opts* opts);
+
+/**
+ * Reject segments with an outdated timestamp (PAWS, RFC 7323).
+ *
+ * @return `0` if the segment must be dropped, otherwise `1`
+ */
+int tcp_paws_check(struct tcp_pcb* pcb, struct tcp_hdr* hdr, const struct tcp_in_opts* opts);
+
+/**
+ * Update the SACK scoreboard of a PCB and retransmit the next hole while in
+ * loss recovery. Called from the LWIP_HOOK_TCP_INPACKET_PCB hook.
+ */
+void tcp_sack_input(struct tcp_pcb* pcb, struct tcp_hdr* hdr, const struct tcp_in_opts* opts);
+
+}   // namespace ZeroTier
+
+#endif
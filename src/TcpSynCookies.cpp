@@ -0,0 +1,341 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * TCP SYN cookies for lwIP listeners
+ *
+ * lwIP allocates a full PCB for every SYN it accepts and silently drops SYNs
+ * once a listener's backlog (which counts half-open connections) is full. A
+ * burst of connects larger than the backlog therefore stalls on SYN
+ * retransmissions, and a burst across many listeners can exhaust the PCB pool.
+ *
+ * Once the backlog is full, the SYN is answered with a SYN-ACK whose initial
+ * sequence number encodes the connection (a keyed hash of the 4-tuple and the
+ * client's ISN, a coarse timestamp and the MSS), and no state is kept. When the
+ * final ACK of the handshake returns a valid cookie, a PCB is created in
+ * SYN_RCVD exactly as lwIP's tcp_listen_input() would have, and the ACK is
+ * delivered to it. Like all SYN cookies without timestamp encoding, such a
+ * connection only keeps the MSS, not window scaling, SACK or timestamps.
+ */
+
+#include "TcpSynCookies.hpp"
+
+#include "TcpRecovery.hpp"
+#include "TcpTimeWait.hpp"
+#include "Utils.hpp"
+#include "lwip/def.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/ip.h"
+#include "lwip/pbuf.h"
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/prot/tcp.h"
+#include "lwip/sys.h"
+#include "lwip/tcp.h"
+
+#include <string.h>
+
+#define COOKIE_PERIOD    64000   // ms
+#define COOKIE_MSS_BITS  3
+#define COOKIE_T_BITS    2
+#define COOKIE_T_SHIFT   COOKIE_MSS_BITS
+#define COOKIE_HASH_MASK (~(u32_t)((1 << (COOKIE_MSS_BITS + COOKIE_T_BITS)) - 1))
+
+namespace ZeroTier {
+
+static const u16_t cookie_mss[1 << COOKIE_MSS_BITS] = { 536, 1200, 1360, 1440, 1460, 2000, 2400, TCP_MSS };
+
+static uint64_t cookie_key[2];
+static u8_t cookie_key_valid = 0;
+
+static u32_t syncookies_sent = 0;
+static u32_t syncookies_accepted = 0;
+static u32_t listen_overflows = 0;
+
+#define ROTL64(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND                                                                                                       \
+    do {                                                                                                               \
+        v0 += v1;                                                                                                      \
+        v1 = ROTL64(v1, 13);                                                                                           \
+        v1 ^= v0;                                                                                                      \
+        v0 = ROTL64(v0, 32);                                                                                           \
+        v2 += v3;                                                                                                      \
+        v3 = ROTL64(v3, 16);                                                                                           \
+        v3 ^= v2;                                                                                                      \
+        v0 += v3;                                                                                                      \
+        v3 = ROTL64(v3, 21);                                                                                           \
+        v3 ^= v0;                                                                                                      \
+        v2 += v1;                                                                                                      \
+        v1 = ROTL64(v1, 17);                                                                                           \
+        v1 ^= v2;                                                                                                      \
+        v2 = ROTL64(v2, 32);                                                                                           \
+    } while (0)
+
+/**
+ * SipHash-2-4 of a message consisting of whole 64-bit words
+ */
+static uint64_t siphash(const uint64_t* m, unsigned int words)
+{
+    uint64_t v0 = cookie_key[0] ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = cookie_key[1] ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = cookie_key[0] ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = cookie_key[1] ^ 0x7465646279746573ULL;
+    for (unsigned int i = 0; i <= words; i++) {
+        uint64_t b = i < words ? m[i] : (uint64_t)(words * 8) << 56;
+        v3 ^= b;
+        SIPROUND;
+        SIPROUND;
+        v0 ^= b;
+    }
+    v2 ^= 0xff;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+static void addr_words(const ip_addr_t* addr, u32_t* dst)
+{
+    memset(dst, 0, 4 * sizeof(u32_t));
+#if LWIP_IPV6
+    if (IP_IS_V6(addr)) {
+        memcpy(dst, ip_2_ip6(addr)->addr, 4 * sizeof(u32_t));
+        return;
+    }
+#endif
+#if LWIP_IPV4
+    dst[0] = ip_2_ip4(addr)->addr;
+#endif
+}
+
+/**
+ * Hash of the current segment's connection, client ISN and time period. Only
+ * the bits covered by COOKIE_HASH_MASK end up in the cookie.
+ */
+static u32_t cookie_hash(const struct tcp_hdr* hdr, u32_t client_isn, u32_t t)
+{
+    if (! cookie_key_valid) {
+        Utils::getSecureRandom(cookie_key, sizeof(cookie_key));
+        cookie_key_valid = 1;
+    }
+    u32_t w[12];
+    addr_words(ip_current_dest_addr(), &w[0]);
+    addr_words(ip_current_src_addr(), &w[4]);
+    w[8] = ((u32_t)hdr->dest << 16) | hdr->src;
+    w[9] = client_isn;
+    w[10] = t;
+    w[11] = 0;
+    uint64_t m[6];
+    memcpy(m, w, sizeof(m));
+    return (u32_t)siphash(m, 6);
+}
+
+static u32_t cookie_make(const struct tcp_hdr* hdr, u32_t client_isn, u16_t mss)
+{
+    u8_t idx = 0;
+    for (u8_t i = 0; i < (1 << COOKIE_MSS_BITS); i++) {
+        if (cookie_mss[i] <= mss) {
+            idx = i;
+        }
+    }
+    u32_t t = sys_now() / COOKIE_PERIOD;
+    return (cookie_hash(hdr, client_isn, t) & COOKIE_HASH_MASK)
+           | ((t & ((1 << COOKIE_T_BITS) - 1)) << COOKIE_T_SHIFT) | idx;
+}
+
+/**
+ * @return The MSS encoded in a cookie issued within the last two periods, or
+ *         `0` if the cookie is invalid
+ */
+static u16_t cookie_check(const struct tcp_hdr* hdr, u32_t client_isn, u32_t cookie)
+{
+    u32_t now = sys_now() / COOKIE_PERIOD;
+    for (u32_t t = now - 1; t != now + 1; t++) {
+        if (((cookie >> COOKIE_T_SHIFT) & ((1 << COOKIE_T_BITS) - 1)) != (t & ((1 << COOKIE_T_BITS) - 1))) {
+            continue;
+        }
+        if ((cookie_hash(hdr, client_isn, t) & COOKIE_HASH_MASK) == (cookie & COOKIE_HASH_MASK)) {
+            return cookie_mss[cookie & ((1 << COOKIE_MSS_BITS) - 1)];
+        }
+    }
+    return 0;
+}
+
+static void cookie_send_synack(const struct tcp_hdr* hdr, u32_t cookie, u32_t ackno)
+{
+    const ip_addr_t* local_ip = ip_current_dest_addr();
+    const ip_addr_t* remote_ip = ip_current_src_addr();
+    struct pbuf* q = pbuf_alloc(PBUF_IP, TCP_HLEN + LWIP_TCP_OPT_LEN_MSS, PBUF_RAM);
+    if (! q) {
+        return;
+    }
+    struct tcp_hdr* th = (struct tcp_hdr*)q->payload;
+    th->src = lwip_htons(hdr->dest);
+    th->dest = lwip_htons(hdr->src);
+    th->seqno = lwip_htonl(cookie);
+    th->ackno = lwip_htonl(ackno);
+    TCPH_HDRLEN_FLAGS_SET(th, (TCP_HLEN + LWIP_TCP_OPT_LEN_MSS) / 4, TCP_SYN | TCP_ACK);
+    th->wnd = lwip_htons(TCPWND_MIN16(TCP_WND));
+    th->chksum = 0;
+    th->urgp = 0;
+#if TCP_CALCULATE_EFF_SEND_MSS
+    u16_t mss = tcp_eff_send_mss(TCP_MSS, local_ip, remote_ip);
+#else
+    u16_t mss = TCP_MSS;
+#endif
+    *(u32_t*)(th + 1) = TCP_BUILD_MSS_OPTION(mss);
+    // As tcp_output_control(): libzt netifs usually leave the checksum to
+    // zts_lwip_eth_tx(), which fills in a zero field
+    struct netif* netif = ip_route(local_ip, remote_ip);
+    if (! netif) {
+        pbuf_free(q);
+        return;
+    }
+#if CHECKSUM_GEN_TCP
+    IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_TCP)
+    {
+        th->chksum = ip_chksum_pseudo(q, IP_PROTO_TCP, q->tot_len, local_ip, remote_ip);
+    }
+#endif
+    TCP_STATS_INC(tcp.xmit);
+    ip_output_if(q, local_ip, remote_ip, TCP_TTL, 0, IP_PROTO_TCP, netif);
+    pbuf_free(q);
+    syncookies_sent++;
+}
+
+/**
+ * Set up a connection in SYN_RCVD for a returned cookie, mirroring
+ * tcp_listen_input()
+ */
+static struct tcp_pcb* cookie_open(struct tcp_pcb_listen* lpcb, const struct tcp_hdr* hdr, u32_t iss, u16_t mss)
+{
+    struct tcp_pcb* npcb = tcp_alloc(lpcb->prio);
+    if (! npcb) {
+        return NULL;
+    }
+#if TCP_LISTEN_BACKLOG
+    lpcb->accepts_pending++;
+    tcp_set_flags(npcb, TF_BACKLOGPEND);
+#endif
+    u32_t seqno = hdr->seqno;
+    ip_addr_copy(npcb->local_ip, *ip_current_dest_addr());
+    ip_addr_copy(npcb->remote_ip, *ip_current_src_addr());
+    npcb->local_port = lpcb->local_port;
+    npcb->remote_port = hdr->src;
+    npcb->state = SYN_RCVD;
+    npcb->rcv_nxt = seqno;
+    npcb->rcv_ann_right_edge = npcb->rcv_nxt;
+    // The SYN-ACK is gone already, it is neither queued nor retransmitted
+    npcb->snd_wl2 = iss;
+    npcb->lastack = iss;
+    npcb->snd_nxt = iss + 1;
+    npcb->snd_lbb = iss + 1;
+    npcb->snd_wl1 = seqno - 1;
+    npcb->callback_arg = lpcb->callback_arg;
+#if LWIP_CALLBACK_API || TCP_LISTEN_BACKLOG
+    npcb->listener = lpcb;
+#endif
+    npcb->so_options = lpcb->so_options & SOF_INHERITED;
+    npcb->netif_idx = lpcb->netif_idx;
+    TCP_REG_ACTIVE(npcb);
+    npcb->snd_wnd = hdr->wnd;
+    npcb->snd_wnd_max = npcb->snd_wnd;
+#if TCP_CALCULATE_EFF_SEND_MSS
+    npcb->mss = tcp_eff_send_mss(mss, &npcb->local_ip, &npcb->remote_ip);
+#else
+    npcb->mss = mss;
+#endif
+    MIB2_STATS_INC(mib2.tcppassiveopens);
+#if LWIP_TCP_PCB_NUM_EXT_ARGS
+    if (tcp_ext_arg_invoke_callbacks_passive_open(lpcb, npcb) != ERR_OK) {
+        tcp_abandon(npcb, 0);
+        return NULL;
+    }
+#endif
+    return npcb;
+}
+
+int tcp_syncookie_input(
+    struct tcp_pcb* pcb,
+    struct tcp_hdr* hdr,
+    uint16_t optlen,
+    const struct tcp_in_opts* opts,
+    struct pbuf* p)
+{
+#if TCP_LISTEN_BACKLOG
+    if (pcb->state != LISTEN) {
+        return 0;
+    }
+    struct tcp_pcb_listen* lpcb = (struct tcp_pcb_listen*)pcb;
+    u8_t flags = TCPH_FLAGS(hdr);
+    if ((flags & (TCP_SYN | TCP_ACK | TCP_RST)) == TCP_SYN) {
+        if (lpcb->accepts_pending < lpcb->backlog) {
+            return 0;
+        }
+        listen_overflows++;
+        u32_t client_isn = hdr->seqno;
+        // RFC 9293: assume 536 if the remote host didn't announce its MSS
+        cookie_send_synack(hdr, cookie_make(hdr, client_isn, opts->mss ? opts->mss : 536), client_isn + 1);
+        return 1;
+    }
+    if ((flags & (TCP_SYN | TCP_ACK | TCP_RST)) != TCP_ACK || ! syncookies_sent) {
+        return 0;   // lwIP resets stray ACKs
+    }
+    u32_t iss = hdr->ackno - 1;
+    u16_t mss = cookie_check(hdr, hdr->seqno - 1, iss);
+    if (! mss) {
+        return 0;
+    }
+    struct netif* inp = ip_current_input_netif();
+    // Like the SYN, the ACK is dropped while the backlog is full, in which
+    // case the remote host will retransmit it
+    struct tcp_pcb* npcb;
+    if (lpcb->accepts_pending >= lpcb->backlog || ! (npcb = cookie_open(lpcb, hdr, iss, mss))) {
+        return 1;
+    }
+    // Deliver the ACK (and any data it carries) to the new PCB. Nothing else
+    // would complete the handshake if the remote host waits for us to speak
+    // first, so the connection is reset if that isn't possible.
+    if (! tcp_input_redeliver(hdr, optlen, p, inp)) {
+        tcp_abandon(npcb, 1);
+        return 1;
+    }
+    syncookies_accepted++;
+    return 1;
+#else
+    LWIP_UNUSED_ARG(pcb);
+    LWIP_UNUSED_ARG(hdr);
+    LWIP_UNUSED_ARG(optlen);
+    LWIP_UNUSED_ARG(opts);
+    LWIP_UNUSED_ARG(p);
+    return 0;
+#endif
+}
+
+void tcp_syncookie_get_stats(uint32_t* queued, uint32_t* overflows, uint32_t* sent, uint32_t* accepted)
+{
+    *queued = 0;
+#if TCP_LISTEN_BACKLOG
+    for (struct tcp_pcb_listen* lpcb = tcp_listen_pcbs.listen_pcbs; lpcb != NULL; lpcb = lpcb->next) {
+        *queued += lpcb->accepts_pending;
+    }
+#endif
+    *overflows = listen_overflows;
+    *sent = syncookies_sent;
+    *accepted = syncookies_accepted;
+}
+
+}   // namespace ZeroTier
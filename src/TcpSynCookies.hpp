@@ -0,0 +1,57 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * TCP SYN cookies for lwIP listeners
+ */
+
+#ifndef ZTS_TCP_SYN_COOKIES_HPP
+#define ZTS_TCP_SYN_COOKIES_HPP
+
+#include <stdint.h>
+
+struct tcp_pcb;
+struct tcp_hdr;
+struct pbuf;
+
+namespace ZeroTier {
+
+struct tcp_in_opts;
+
+/**
+ * Answer a SYN to a listener whose backlog is full with a SYN cookie, and
+ * create the connection once a valid cookie is returned. Called from the
+ * LWIP_HOOK_TCP_INPACKET_PCB hook.
+ *
+ * @return `1` if the segment was handled and must not be processed any
+ *         further, otherwise `0`
+ */
+int tcp_syncookie_input(
+    struct tcp_pcb* pcb,
+    struct tcp_hdr* hdr,
+    uint16_t optlen,
+    const struct tcp_in_opts* opts,
+    struct pbuf* p);
+
+/**
+ * Return the number of connections waiting in listen queues, the number of
+ * SYNs that found their listen queue full, and the number of SYN cookies sent
+ * and accepted. Must be called with the TCP/IP core lock held.
+ */
+void tcp_syncookie_get_stats(uint32_t* queued, uint32_t* overflows, uint32_t* sent, uint32_t* accepted);
+
+}   // namespace ZeroTier
+
+#endif
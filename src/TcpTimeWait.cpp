@@ -0,0 +1,153 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * TIME_WAIT recycling for lwIP
+ *
+ * lwIP answers a SYN that matches a connection in TIME_WAIT with an ACK (or a
+ * RST if the SYN is within the old receive window) and ignores the remote
+ * host's reply, so a client that reuses its port before TIME_WAIT has expired
+ * cannot connect at all until it does. With short-lived connections closed by
+ * the server this happens as soon as the client cycles through its ephemeral
+ * port range.
+ *
+ * Here such a SYN closes the TIME_WAIT PCB and is then delivered again, now
+ * reaching the listener. This is only done when the SYN can't be mistaken for
+ * an old duplicate of the previous connection: either its timestamp is newer
+ * than the last one seen on that connection (RFC 6191), or, without
+ * timestamps, its sequence number lies beyond the old receive window
+ * (RFC 1122, 4.2.2.13).
+ */
+
+#include "TcpTimeWait.hpp"
+
+#include "TcpRecovery.hpp"
+#include "lwip/def.h"
+#include "lwip/ip.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/prot/tcp.h"
+#include "lwip/tcp.h"
+#include "lwip/tcpip.h"
+
+namespace ZeroTier {
+
+static u32_t tw_recycled = 0;
+
+int tcp_tw_recycle(
+    struct tcp_pcb* pcb,
+    struct tcp_hdr* hdr,
+    uint16_t optlen,
+    const struct tcp_in_opts* opts,
+    struct pbuf* p)
+{
+    if (pcb->state != TIME_WAIT || (TCPH_FLAGS(hdr) & (TCP_SYN | TCP_ACK | TCP_RST)) != TCP_SYN) {
+        return 0;
+    }
+    // Beyond the old receive window, unless timestamps can tell
+    int is_new = TCP_SEQ_GT(hdr->seqno, pcb->rcv_nxt + pcb->rcv_wnd);
+#if LWIP_TCP_TIMESTAMPS
+    if ((pcb->flags & TF_TIMESTAMP) && opts->has_ts) {
+        is_new = (s32_t)(opts->tsval - pcb->ts_recent) > 0;
+    }
+#else
+    LWIP_UNUSED_ARG(opts);
+#endif
+    if (! is_new) {
+        return 0;
+    }
+    tw_recycled++;
+    struct netif* inp = ip_current_input_netif();
+    // A TIME_WAIT PCB is freed without sending anything
+    tcp_abort(pcb);
+    // If the SYN can't be delivered again, the remote host's retransmission
+    // will reach the listener instead
+    tcp_input_redeliver(hdr, optlen, p, inp);
+    return 1;
+}
+
+/**
+ * A packet waiting to be delivered again
+ */
+struct tcp_redelivery {
+    struct pbuf* p;
+    u16_t ip_hdrlen;
+    u16_t tcp_hdrlen;
+    u8_t if_idx;
+};
+
+static void tcp_input_redeliver_cb(void* arg)
+{
+    struct tcp_redelivery* r = (struct tcp_redelivery*)arg;
+    struct pbuf* p = r->p;
+    struct netif* inp = netif_get_by_index(r->if_idx);
+    if (! inp || pbuf_add_header_force(p, r->ip_hdrlen + r->tcp_hdrlen) != 0) {
+        pbuf_free(p);
+        delete r;
+        return;
+    }
+    // Undo tcp_input()'s conversion to host byte order, the checksum covers
+    // these fields
+    struct tcp_hdr* hdr = (struct tcp_hdr*)((u8_t*)p->payload + r->ip_hdrlen);
+    hdr->src = lwip_htons(hdr->src);
+    hdr->dest = lwip_htons(hdr->dest);
+    hdr->seqno = lwip_htonl(hdr->seqno);
+    hdr->ackno = lwip_htonl(hdr->ackno);
+    hdr->wnd = lwip_htons(hdr->wnd);
+    delete r;
+    ip_input(p, inp);
+}
+
+int tcp_input_redeliver(struct tcp_hdr* hdr, uint16_t optlen, struct pbuf* p, struct netif* inp)
+{
+    u16_t tcp_hdrlen = TCP_HLEN + optlen;
+    u16_t ip_hdrlen = ip_current_header_tot_len();
+#if LWIP_IPV6
+    const u8_t* iphdr =
+        ip_current_is_v6() ? (const u8_t*)ip6_current_header() : (const u8_t*)ip4_current_header();
+#else
+    const u8_t* iphdr = (const u8_t*)ip4_current_header();
+#endif
+    // Only if the headers (which have already been stripped) are still in
+    // front of the payload, i.e. not split across pbufs
+    if (! inp || (u8_t*)p->payload != (u8_t*)hdr + tcp_hdrlen || iphdr + ip_hdrlen != (u8_t*)hdr) {
+        return 0;
+    }
+    struct tcp_redelivery* r = new tcp_redelivery;
+    r->p = p;
+    r->ip_hdrlen = ip_hdrlen;
+    r->tcp_hdrlen = tcp_hdrlen;
+    r->if_idx = netif_get_index(inp);
+    // Ours until the callback runs, tcp_input() frees its own reference
+    pbuf_ref(p);
+    if (tcpip_try_callback(tcp_input_redeliver_cb, r) != ERR_OK) {
+        pbuf_free(p);
+        delete r;
+        return 0;
+    }
+    return 1;
+}
+
+void tcp_tw_get_stats(uint32_t* count, uint32_t* recycled)
+{
+    *count = 0;
+    for (struct tcp_pcb* pcb = tcp_tw_pcbs; pcb != NULL; pcb = pcb->next) {
+        (*count)++;
+    }
+    *recycled = tw_recycled;
+}
+
+}   // namespace ZeroTier
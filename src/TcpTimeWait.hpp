@@ -0,0 +1,68 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * TIME_WAIT recycling for lwIP
+ */
+
+#ifndef ZTS_TCP_TIME_WAIT_HPP
+#define ZTS_TCP_TIME_WAIT_HPP
+
+#include <stdint.h>
+
+struct tcp_pcb;
+struct tcp_hdr;
+struct pbuf;
+struct netif;
+
+namespace ZeroTier {
+
+struct tcp_in_opts;
+
+/**
+ * Hand a SYN that opens a new incarnation of a connection in TIME_WAIT over to
+ * the listener. Called from the LWIP_HOOK_TCP_INPACKET_PCB hook.
+ *
+ * @return `1` if the TIME_WAIT PCB was recycled and the segment must not be
+ *         processed any further, otherwise `0`
+ */
+int tcp_tw_recycle(
+    struct tcp_pcb* pcb,
+    struct tcp_hdr* hdr,
+    uint16_t optlen,
+    const struct tcp_in_opts* opts,
+    struct pbuf* p);
+
+/**
+ * Run a segment rejected by the LWIP_HOOK_TCP_INPACKET_PCB hook through
+ * ip_input() once more, e.g. after the PCB it matched was removed. The packet
+ * is taken over (referenced) in the hook and put back together and delivered
+ * from a tcpip callback, i.e. after the current tcp_input() has returned.
+ *
+ * @return `1` if the segment will be delivered again, `0` if the headers are
+ *     split across pbufs or the callback could not be queued
+ */
+int tcp_input_redeliver(struct tcp_hdr* hdr, uint16_t optlen, struct pbuf* p, struct netif* inp);
+
+/**
+ * Return the number of connections currently in TIME_WAIT and the number of
+ * TIME_WAIT connections recycled so far. Must be called with the TCP/IP core
+ * lock held.
+ */
+void tcp_tw_get_stats(uint32_t* count, uint32_t* recycled);
+
+}   // namespace ZeroTier
+
+#endif
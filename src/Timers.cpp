@@ -0,0 +1,431 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * lwIP timers that stop while the stack is idle
+ *
+ * lwIP runs its cyclic timers (ARP, IP reassembly, ND, IGMP, MLD, DNS) every
+ * 100 ms to 1 s for as long as the stack is up, so the tcpip thread never
+ * sleeps longer than that. This replaces lwIP's timeouts.c
+ * (LWIP_TIMERS_CUSTOM) with the same timeout list, except that the cyclic
+ * timers are taken off it ("hibernation") once no frame has passed through a
+ * netif for ZTS_HIBERNATE_IDLE_TIME and nothing is left for them to age: no
+ * TCP PCB that needs the TCP timer, no ARP entry, no IPv6 neighbour other than
+ * stale ones, no router, prefix, tentative address or address with a finite
+ * lifetime, no IGMP or MLD report waiting to be sent. The tcpip thread then
+ * sleeps until the next one-shot timeout, or until a message arrives if there
+ * is none.
+ *
+ * The next frame in or out, or zts_lwip_wake_driver(), puts the cyclic timers
+ * back. Since there was nothing for them to age in the meantime, nothing is
+ * caught up, except lwIP's DNS cache, which is invisible from here and aged by
+ * the time spent hibernating instead.
+ */
+
+#include "Timers.hpp"
+
+#include "OSUtils.hpp"
+#include "VirtualTap.hpp"
+#include "lwip/dns.h"
+#include "lwip/etharp.h"
+#include "lwip/igmp.h"
+#include "lwip/memp.h"
+#include "lwip/mld6.h"
+#include "lwip/nd6.h"
+#include "lwip/netif.h"
+#include "lwip/priv/nd6_priv.h"
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/sys.h"
+#include "lwip/tcpip.h"
+#include "lwip/timeouts.h"
+
+#include <algorithm>
+#include <atomic>
+
+#define TIME_LESS_THAN(t, compare_to) ((u32_t)((t) - (compare_to)) > 0x7fffffff)
+
+// lwIP's default, see dns.c
+#ifndef DNS_MAX_TTL
+#define DNS_MAX_TTL 604800
+#endif
+
+namespace ZeroTier {
+
+// Timeouts sorted by due time. Only accessed with the core lock held.
+static struct sys_timeo* next_timeout = NULL;
+static u32_t current_timeout_due_time;
+
+// When the tcpip thread will wake up next, as of its last sys_timeouts_sleeptime()
+static bool sleeping = false;
+static bool sleep_forever;
+static u32_t sleep_until;
+
+static std::atomic<bool> hibernating(false);
+static std::atomic<u32_t> last_activity(0);   // sys_now() of the last frame in or out
+static int64_t hibernated_at;
+
+#if LWIP_TCP
+static int tcpip_tcp_timer_active = 0;
+#endif
+
+// Index of the first cyclic timer managed here, the TCP timer at index 0 is
+// started on demand
+static const int first_cyclic_timer = LWIP_TCP ? 1 : 0;
+
+static void timers_poke(void* arg)
+{
+    LWIP_UNUSED_ARG(arg);
+}
+
+static void timers_add(u32_t abs_time, sys_timeout_handler handler, void* arg)
+{
+    struct sys_timeo* timeout = (struct sys_timeo*)memp_malloc(MEMP_SYS_TIMEOUT);
+    if (timeout == NULL) {
+        LWIP_ASSERT("sys_timeout: timeout != NULL, pool MEMP_SYS_TIMEOUT is empty", timeout != NULL);
+        return;
+    }
+    timeout->next = NULL;
+    timeout->h = handler;
+    timeout->arg = arg;
+    timeout->time = abs_time;
+    if (next_timeout == NULL || TIME_LESS_THAN(abs_time, next_timeout->time)) {
+        timeout->next = next_timeout;
+        next_timeout = timeout;
+        // Threads other than the tcpip thread add timeouts too (e.g. the
+        // resolver's), and it may be sleeping past this one or indefinitely
+        if (sleeping && (sleep_forever || TIME_LESS_THAN(abs_time, sleep_until))) {
+            sleep_forever = false;
+            sleep_until = abs_time;
+            tcpip_try_callback(timers_poke, NULL);
+        }
+        return;
+    }
+    for (struct sys_timeo* t = next_timeout; t != NULL; t = t->next) {
+        if (t->next == NULL || TIME_LESS_THAN(abs_time, t->next->time)) {
+            timeout->next = t->next;
+            t->next = timeout;
+            break;
+        }
+    }
+}
+
+static void timers_cyclic(void* arg)
+{
+    const struct lwip_cyclic_timer* cyclic = (const struct lwip_cyclic_timer*)arg;
+    cyclic->handler();
+    u32_t now = sys_now();
+    u32_t next_timeout_time = (u32_t)(current_timeout_due_time + cyclic->interval_ms);
+    if (TIME_LESS_THAN(next_timeout_time, now)) {
+        // Fell behind, don't try to catch up
+        timers_add((u32_t)(now + cyclic->interval_ms), timers_cyclic, arg);
+    }
+    else {
+        timers_add(next_timeout_time, timers_cyclic, arg);
+    }
+}
+
+/**
+ * Whether nothing is left for the cyclic timers to do. `seen` is the time of
+ * the last frame in or out.
+ */
+static bool timers_idle(u32_t now, u32_t seen)
+{
+    if ((u32_t)(now - seen) < ZTS_HIBERNATE_IDLE_TIME) {
+        return false;
+    }
+#if LWIP_TCP
+    if (tcpip_tcp_timer_active) {
+        return false;
+    }
+#endif
+#if LWIP_ARP
+    for (size_t i = 0; i < ARP_TABLE_SIZE; i++) {
+        ip4_addr_t* ip;
+        struct netif* n;
+        struct eth_addr* mac;
+        if (etharp_get_entry(i, &ip, &n, &mac)) {
+            return false;
+        }
+    }
+#endif
+#if LWIP_IPV6
+    // Stale neighbours stay until their entry is needed for another one
+    for (int i = 0; i < LWIP_ND6_NUM_NEIGHBORS; i++) {
+        if (neighbor_cache[i].state != ND6_NO_ENTRY && neighbor_cache[i].state != ND6_STALE) {
+            return false;
+        }
+    }
+    for (int i = 0; i < LWIP_ND6_NUM_ROUTERS; i++) {
+        if (default_router_list[i].neighbor_entry != NULL) {
+            return false;
+        }
+    }
+    for (int i = 0; i < LWIP_ND6_NUM_PREFIXES; i++) {
+        if (prefix_list[i].netif != NULL) {
+            return false;
+        }
+    }
+#endif
+    struct netif* netif;
+    NETIF_FOREACH(netif)
+    {
+#if LWIP_IGMP
+        for (struct igmp_group* g = netif_igmp_data(netif); g != NULL; g = g->next) {
+            if (g->timer) {
+                return false;
+            }
+        }
+#endif
+#if LWIP_IPV6_MLD
+        for (struct mld_group* g = netif_mld6_data(netif); g != NULL; g = g->next) {
+            if (g->timer) {
+                return false;
+            }
+        }
+#endif
+#if LWIP_IPV6
+#if LWIP_IPV6_SEND_ROUTER_SOLICIT
+        if (netif->rs_count && netif_is_up(netif)) {
+            return false;
+        }
+#endif
+        for (int i = 0; i < LWIP_IPV6_NUM_ADDRESSES; i++) {
+            u8_t state = netif_ip6_addr_state(netif, i);
+            if (ip6_addr_isinvalid(state)) {
+                continue;
+            }
+            if (ip6_addr_istentative(state)) {
+                return false;
+            }
+#if LWIP_IPV6_ADDRESS_LIFETIMES
+            if (! netif_ip6_addr_isstatic(netif, i)
+                && (! ip6_addr_life_isinfinite(netif_ip6_addr_valid_life(netif, i))
+                    || ! ip6_addr_life_isinfinite(netif_ip6_addr_pref_life(netif, i)))) {
+                return false;
+            }
+#endif
+        }
+#endif
+    }
+    return true;
+}
+
+/**
+ * Put the cyclic timers back. Called with the core lock held.
+ */
+static void timers_wake()
+{
+    if (! hibernating) {
+        return;
+    }
+    hibernating = false;
+#if LWIP_DNS
+    int64_t ticks = (OSUtils::now() - hibernated_at) / DNS_TMR_INTERVAL;
+    for (int64_t i = 0; i < std::min(ticks, (int64_t)DNS_MAX_TTL); i++) {
+        dns_tmr();
+    }
+#endif
+    u32_t now = sys_now();
+    for (int i = first_cyclic_timer; i < lwip_num_cyclic_timers; i++) {
+        timers_add(
+            (u32_t)(now + lwip_cyclic_timers[i].interval_ms),
+            timers_cyclic,
+            LWIP_CONST_CAST(void*, &lwip_cyclic_timers[i]));
+    }
+}
+
+/**
+ * Take the cyclic timers off the list. Called with the core lock held.
+ */
+static void timers_hibernate(u32_t seen)
+{
+    for (int i = first_cyclic_timer; i < lwip_num_cyclic_timers; i++) {
+        sys_untimeout(timers_cyclic, LWIP_CONST_CAST(void*, &lwip_cyclic_timers[i]));
+    }
+    hibernated_at = OSUtils::now();
+    hibernating = true;
+    // A frame that passed since `seen` was read may have missed `hibernating`
+    if (last_activity != seen) {
+        timers_wake();
+    }
+}
+
+void timers_input_activity()
+{
+    last_activity = sys_now();
+    if (hibernating) {
+        LOCK_TCPIP_CORE();
+        timers_wake();
+        UNLOCK_TCPIP_CORE();
+    }
+}
+
+void timers_output_activity()
+{
+    last_activity = sys_now();
+    if (hibernating) {
+        timers_wake();
+    }
+}
+
+void zts_lwip_hibernate_driver()
+{
+    if (! zts_lwip_is_up()) {
+        return;
+    }
+    last_activity = sys_now() - ZTS_HIBERNATE_IDLE_TIME;
+    LOCK_TCPIP_CORE();
+    u32_t seen = last_activity;
+    if (! hibernating && timers_idle(sys_now(), seen)) {
+        timers_hibernate(seen);
+    }
+    UNLOCK_TCPIP_CORE();
+}
+
+void zts_lwip_wake_driver()
+{
+    if (! zts_lwip_is_up()) {
+        return;
+    }
+    last_activity = sys_now();
+    LOCK_TCPIP_CORE();
+    timers_wake();
+    UNLOCK_TCPIP_CORE();
+}
+
+}   // namespace ZeroTier
+
+using namespace ZeroTier;
+
+//----------------------------------------------------------------------------//
+// lwIP timeouts API (LWIP_TIMERS_CUSTOM)                                     //
+//----------------------------------------------------------------------------//
+
+extern "C" void sys_timeouts_init(void)
+{
+    last_activity = sys_now();
+    for (int i = first_cyclic_timer; i < lwip_num_cyclic_timers; i++) {
+        sys_timeout(lwip_cyclic_timers[i].interval_ms, timers_cyclic, LWIP_CONST_CAST(void*, &lwip_cyclic_timers[i]));
+    }
+}
+
+#if LWIP_TCP
+static void tcpip_tcp_timer(void* arg)
+{
+    LWIP_UNUSED_ARG(arg);
+    tcp_tmr();
+    if (tcp_active_pcbs || tcp_tw_pcbs) {
+        sys_timeout(TCP_TMR_INTERVAL, tcpip_tcp_timer, NULL);
+    }
+    else {
+        tcpip_tcp_timer_active = 0;
+    }
+}
+
+extern "C" void tcp_timer_needed(void)
+{
+    LWIP_ASSERT_CORE_LOCKED();
+    if (! tcpip_tcp_timer_active && (tcp_active_pcbs || tcp_tw_pcbs)) {
+        tcpip_tcp_timer_active = 1;
+        sys_timeout(TCP_TMR_INTERVAL, tcpip_tcp_timer, NULL);
+    }
+}
+#endif
+
+#if LWIP_DEBUG_TIMERNAMES
+extern "C" void sys_timeout_debug(u32_t msecs, sys_timeout_handler handler, void* arg, const char* handler_name)
+#else
+extern "C" void sys_timeout(u32_t msecs, sys_timeout_handler handler, void* arg)
+#endif
+{
+#if LWIP_DEBUG_TIMERNAMES
+    LWIP_UNUSED_ARG(handler_name);
+#endif
+    LWIP_ASSERT_CORE_LOCKED();
+    LWIP_ASSERT("Timeout time too long, max is LWIP_UINT32_MAX/4 msecs", msecs <= (LWIP_UINT32_MAX / 4));
+    timers_add((u32_t)(sys_now() + msecs), handler, arg);
+}
+
+extern "C" void sys_untimeout(sys_timeout_handler handler, void* arg)
+{
+    LWIP_ASSERT_CORE_LOCKED();
+    for (struct sys_timeo *t = next_timeout, *prev_t = NULL; t != NULL; prev_t = t, t = t->next) {
+        if (t->h == handler && t->arg == arg) {
+            if (prev_t == NULL) {
+                next_timeout = t->next;
+            }
+            else {
+                prev_t->next = t->next;
+            }
+            memp_free(MEMP_SYS_TIMEOUT, t);
+            return;
+        }
+    }
+}
+
+extern "C" void sys_check_timeouts(void)
+{
+    LWIP_ASSERT_CORE_LOCKED();
+    u32_t now = sys_now();
+    while (true) {
+        PBUF_CHECK_FREE_OOSEQ();
+        struct sys_timeo* t = next_timeout;
+        if (t == NULL || TIME_LESS_THAN(now, t->time)) {
+            return;
+        }
+        next_timeout = t->next;
+        sys_timeout_handler handler = t->h;
+        void* arg = t->arg;
+        current_timeout_due_time = t->time;
+        memp_free(MEMP_SYS_TIMEOUT, t);
+        if (handler != NULL) {
+            handler(arg);
+        }
+        LWIP_TCPIP_THREAD_ALIVE();
+    }
+}
+
+extern "C" void sys_restart_timeouts(void)
+{
+    if (next_timeout == NULL) {
+        return;
+    }
+    u32_t now = sys_now();
+    u32_t base = next_timeout->time;
+    for (struct sys_timeo* t = next_timeout; t != NULL; t = t->next) {
+        t->time = (t->time - base) + now;
+    }
+}
+
+extern "C" u32_t sys_timeouts_sleeptime(void)
+{
+    LWIP_ASSERT_CORE_LOCKED();
+    u32_t now = sys_now();
+    u32_t seen = last_activity;
+    if (! hibernating && timers_idle(now, seen)) {
+        timers_hibernate(seen);
+    }
+    sleeping = true;
+    if (next_timeout == NULL) {
+        sleep_forever = true;
+        return SYS_TIMEOUTS_SLEEPTIME_INFINITE;
+    }
+    sleep_forever = false;
+    sleep_until = next_timeout->time;
+    if (TIME_LESS_THAN(next_timeout->time, now)) {
+        return 0;
+    }
+    return (u32_t)(next_timeout->time - now);
+}
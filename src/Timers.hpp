@@ -0,0 +1,44 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * lwIP timers that stop while the stack is idle
+ */
+
+#ifndef ZTS_TIMERS_HPP
+#define ZTS_TIMERS_HPP
+
+// Time (ms) without a frame in or out of any netif after which lwIP's cyclic
+// timers may stop. Longer than any state they age that isn't checked for
+// directly lives (pending ARP and DNS queries, IPv6 reassembly: 60 s).
+#define ZTS_HIBERNATE_IDLE_TIME 65000
+
+namespace ZeroTier {
+
+/**
+ * Record a frame about to be passed to lwIP, restarting the cyclic timers if
+ * they were stopped. Called without the core lock.
+ */
+void timers_input_activity();
+
+/**
+ * Record a frame sent by lwIP, restarting the cyclic timers if they were
+ * stopped. Called with the core lock held.
+ */
+void timers_output_activity();
+
+}   // namespace ZeroTier
+
+#endif
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * Rate limit and priority classes for frames sent by a virtual tap
+ *
+ * Without a rate limit frames leave in the order the stack sends them, and
+ * any queue builds up further on (in the host's UDP socket or the uplink)
+ * where the class of a frame is unknown. A limit just below the uplink's
+ * capacity moves that queue here, where control and interactive traffic can
+ * overtake bulk transfers.
+ */
+
+#include "TxShaper.hpp"
+
+#include <algorithm>
+#include <string.h>
+
+namespace ZeroTier {
+
+TxShaper::TxShaper() : _drr(0), _rate(0), _burst(0), _tokens(0), _lastRefill(0)
+{
+    for (int i = 0; i < ZTS_TX_CLASS_COUNT; i++) {
+        _classes[i].queueBytes = 0;
+        _classes[i].deficit = 0;
+        memset(&(_classes[i].stats), 0, sizeof(zts_tx_class_stats_t));
+    }
+    _classes[ZTS_TX_CLASS_CONTROL].weight = 0;
+    _classes[ZTS_TX_CLASS_INTERACTIVE].weight = 8;
+    _classes[ZTS_TX_CLASS_DEFAULT].weight = 4;
+    _classes[ZTS_TX_CLASS_BULK].weight = 1;
+}
+
+void TxShaper::setRate(uint64_t bytesPerSec, unsigned int burst, int64_t now)
+{
+    refill(now);
+    _burst = burst ? (int64_t)burst * 1000 : (int64_t)bytesPerSec * 10;
+    _tokens = _rate ? std::min(_tokens, _burst) : _burst;
+    _rate = bytesPerSec;
+}
+
+void TxShaper::setWeight(int cls, unsigned int weight)
+{
+    _classes[cls].weight = weight;
+    _classes[cls].deficit = 0;
+}
+
+void TxShaper::getStats(int cls, zts_tx_class_stats_t* stats) const
+{
+    *stats = _classes[cls].stats;
+    stats->queue_len = (unsigned int)_classes[cls].queue.size();
+    stats->queue_bytes = _classes[cls].queueBytes;
+}
+
+int TxShaper::classify(const uint8_t* frame, unsigned int len)
+{
+    if (len < 14) {
+        return ZTS_TX_CLASS_DEFAULT;
+    }
+    unsigned int etherType = frame[12] << 8 | frame[13];
+    const uint8_t* ip = frame + 14;
+    len -= 14;
+    int dscp;
+    if (etherType == 0x0806) {
+        return ZTS_TX_CLASS_CONTROL;
+    }
+    else if (etherType == 0x0800 && len >= 20) {
+        if (ip[9] == 2) {   // IGMP
+            return ZTS_TX_CLASS_CONTROL;
+        }
+        dscp = ip[1] >> 2;
+    }
+    else if (etherType == 0x86dd && len >= 40) {
+        // Neighbour discovery, and MLD (behind hop-by-hop options)
+        if (ip[6] == 58 && len > 40 && ((ip[40] >= 130 && ip[40] <= 137) || ip[40] == 143)) {
+            return ZTS_TX_CLASS_CONTROL;
+        }
+        if (ip[6] == 0) {
+            return ZTS_TX_CLASS_CONTROL;
+        }
+        dscp = ((ip[0] & 0x0f) << 4 | ip[1] >> 4) >> 2;
+    }
+    else {
+        return ZTS_TX_CLASS_DEFAULT;
+    }
+    // RFC 4594: network control and telephony, low-latency data and
+    // multimedia, low-priority data (and RFC 8622 lower effort)
+    if (dscp >= 40) {
+        return ZTS_TX_CLASS_CONTROL;
+    }
+    if (dscp >= 16) {
+        return ZTS_TX_CLASS_INTERACTIVE;
+    }
+    if (dscp >= 8 || dscp == 1) {
+        return ZTS_TX_CLASS_BULK;
+    }
+    return ZTS_TX_CLASS_DEFAULT;
+}
+
+bool TxShaper::admit(const uint8_t* frame, unsigned int len, int64_t now)
+{
+    Class& c = _classes[classify(frame, len)];
+    if (! _rate) {
+        c.stats.sent_frames++;
+        c.stats.sent_bytes += len;
+        return true;
+    }
+    refill(now);
+    if (empty() && _tokens > 0) {
+        _tokens -= (int64_t)len * 1000;
+        c.stats.sent_frames++;
+        c.stats.sent_bytes += len;
+        return true;
+    }
+    if (c.queueBytes + len > ZTS_TX_QUEUE_MAX_BYTES) {
+        c.stats.dropped_frames++;
+        return false;
+    }
+    c.queue.push_back(std::string((const char*)frame, len));
+    c.queueBytes += len;
+    c.stats.delayed_frames++;
+    return false;
+}
+
+bool TxShaper::dequeue(std::string& frame, int64_t now)
+{
+    if (empty()) {
+        return false;
+    }
+    if (_rate) {
+        refill(now);
+        if (_tokens <= 0) {
+            return false;
+        }
+    }
+    Class& c = _classes[nextClass()];
+    frame.swap(c.queue.front());
+    c.queue.pop_front();
+    c.queueBytes -= frame.size();
+    if (c.queue.empty()) {
+        c.deficit = 0;
+    }
+    else if (c.weight) {
+        c.deficit -= (int64_t)frame.size();
+    }
+    if (_rate) {
+        _tokens -= (int64_t)frame.size() * 1000;
+    }
+    c.stats.sent_frames++;
+    c.stats.sent_bytes += frame.size();
+    return true;
+}
+
+int64_t TxShaper::waitTime() const
+{
+    if (empty()) {
+        return -1;
+    }
+    if (! _rate || _tokens > 0) {
+        return 0;
+    }
+    return (-_tokens + (int64_t)_rate) / (int64_t)_rate;   // Until _tokens > 0
+}
+
+void TxShaper::clear()
+{
+    for (int i = 0; i < ZTS_TX_CLASS_COUNT; i++) {
+        _classes[i].queue.clear();
+        _classes[i].queueBytes = 0;
+        _classes[i].deficit = 0;
+    }
+}
+
+void TxShaper::refill(int64_t now)
+{
+    // Capped so that the product cannot overflow
+    int64_t elapsed = std::min(std::max(now - _lastRefill, (int64_t)0), (int64_t)60000);
+    _lastRefill = now;
+    _tokens = std::min(_burst, _tokens + (int64_t)_rate * elapsed);
+}
+
+int TxShaper::nextClass()
+{
+    for (int i = 0; i < ZTS_TX_CLASS_COUNT; i++) {
+        if (! _classes[i].weight && ! _classes[i].queue.empty()) {
+            return i;
+        }
+    }
+    // There is a weighted class with frames, each round adds to its deficit
+    while (true) {
+        Class& c = _classes[_drr];
+        if (c.weight && ! c.queue.empty() && c.deficit >= (int64_t)c.queue.front().size()) {
+            return _drr;
+        }
+        if (c.queue.empty()) {
+            c.deficit = 0;
+        }
+        _drr = (_drr + 1) % ZTS_TX_CLASS_COUNT;
+        _classes[_drr].deficit += (int64_t)_classes[_drr].weight * ZTS_TX_QUANTUM;
+    }
+}
+
+bool TxShaper::empty() const
+{
+    for (int i = 0; i < ZTS_TX_CLASS_COUNT; i++) {
+        if (! _classes[i].queue.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}   // namespace ZeroTier
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * Rate limit and priority classes for frames sent by a virtual tap
+ */
+
+#ifndef ZTS_TX_SHAPER_HPP
+#define ZTS_TX_SHAPER_HPP
+
+#include "ZeroTierSockets.h"
+
+#include <deque>
+#include <stdint.h>
+#include <string>
+
+// Most bytes waiting in one class, frames beyond it are dropped
+#define ZTS_TX_QUEUE_MAX_BYTES (256 * 1024)
+
+// Bytes a weighted class may send per round for each unit of its weight
+#define ZTS_TX_QUANTUM 1514
+
+namespace ZeroTier {
+
+/**
+ * Token bucket in front of one queue per class. Nothing is queued while the
+ * rate is not limited. Queued frames of classes with weight 0 go first, in
+ * class order, the other classes share what is left in proportion to their
+ * weights (deficit round robin). Not thread-safe, VirtualTap only uses it
+ * with the core lock held.
+ */
+class TxShaper {
+  public:
+    TxShaper();
+
+    /**
+     * Limit the rate at which frames are sent
+     *
+     * @param bytesPerSec Rate, 0 for no limit
+     * @param burst Most bytes sent at once after an idle period, 0 for 10 ms
+     * worth
+     */
+    void setRate(uint64_t bytesPerSec, unsigned int burst, int64_t now);
+
+    /**
+     * Return whether the rate is limited
+     */
+    bool limited() const
+    {
+        return _rate != 0;
+    }
+
+    /**
+     * Set the share of a class, 0 to send its frames before those of any
+     * weighted class
+     */
+    void setWeight(int cls, unsigned int weight);
+
+    void getStats(int cls, zts_tx_class_stats_t* stats) const;
+
+    /**
+     * Return the class of an Ethernet frame: `ZTS_TX_CLASS_CONTROL` for ARP,
+     * IGMP, neighbour discovery and MLD, otherwise by DSCP
+     */
+    static int classify(const uint8_t* frame, unsigned int len);
+
+    /**
+     * Offer a frame for sending
+     *
+     * @return true if it is to be sent now, false if it was queued or dropped
+     */
+    bool admit(const uint8_t* frame, unsigned int len, int64_t now);
+
+    /**
+     * Take the next queued frame, if the rate limit allows sending it now
+     *
+     * @return Whether `frame` was set
+     */
+    bool dequeue(std::string& frame, int64_t now);
+
+    /**
+     * Return the time (ms) until dequeue() will return a frame, or -1 if
+     * nothing is queued
+     */
+    int64_t waitTime() const;
+
+    /**
+     * Drop all queued frames
+     */
+    void clear();
+
+  private:
+    void refill(int64_t now);
+    int nextClass();
+    bool empty() const;
+
+    struct Class {
+        std::deque<std::string> queue;
+        unsigned int queueBytes;
+        unsigned int weight;
+        int64_t deficit;
+        zts_tx_class_stats_t stats;   // Without the queue lengths
+    };
+    Class _classes[ZTS_TX_CLASS_COUNT];
+    int _drr;   // Weighted class whose turn it is
+
+    uint64_t _rate;   // Bytes per second, 0 for no limit
+    // Bucket (in thousandths of a byte, a rate multiplied by ms). Frames are
+    // sent while it holds anything, which may take it below zero.
+    int64_t _burst;
+    int64_t _tokens;
+    int64_t _lastRefill;
+};
+
+}   // namespace ZeroTier
+
+#endif
@@ -17,6 +17,9 @@
  * Virtual Ethernet tap device and combined network stack driver
  */
 
+#include "Address.hpp"
+#include "Checksum.h"
+#include "ChecksumOffload.h"
 #include "InetAddress.hpp"
 #include "MAC.hpp"
 #include "MulticastGroup.hpp"
@@ -24,9 +27,16 @@
 #include "OSUtils.hpp"
 #include "lwip/etharp.h"
 #include "lwip/ethip6.h"
+#include "lwip/igmp.h"
+#include "lwip/ip.h"
+#include "lwip/mld6.h"
+#include "lwip/nd6.h"
 #include "lwip/netif.h"
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/prot/tcp.h"
 #include "lwip/sys.h"
 #include "lwip/tcpip.h"
+#include "lwip/timeouts.h"
 #include "netif/ethernet.h"
 
 #ifdef LWIP_STATS
@@ -34,6 +44,7 @@
 #endif
 
 #include "Events.hpp"
+#include "Timers.hpp"
 #include "VirtualTap.hpp"
 
 #if defined(__WINDOWS__)
@@ -48,6 +59,9 @@
 namespace ZeroTier {
 
 extern Events* zts_events;
+extern void socket_count_reset();
+
+static void zts_tap_drain_tx(void* arg);
 
 /**
  * Virtual tap device. ZeroTier will create one per joined network. It will
@@ -100,6 +114,12 @@ VirtualTap::~VirtualTap()
     netif4 = NULL;
     zts_lwip_remove_netif(netif6);
     netif6 = NULL;
+    LOCK_TCPIP_CORE();
+    sys_untimeout(zts_tap_drain_tx, this);
+    _txShaper.clear();
+    UNLOCK_TCPIP_CORE();
+    // Frees whatever is still held
+    flushReceiveBatch();
     Thread::join(_thread);
 #ifndef __WINDOWS__
     ::close(_shutdownSignalPipe[0]);
@@ -213,12 +233,13 @@ void VirtualTap::scanMulticastGroups(std::vector<MulticastGroup>& added, std::ve
 {
     std::vector<MulticastGroup> newGroups;
     Mutex::Lock _l(_multicastGroups_m);
-    // TODO: get multicast subscriptions
     std::vector<InetAddress> allIps(ips());
     for (std::vector<InetAddress>::iterator ip(allIps.begin()); ip != allIps.end(); ++ip)
         newGroups.push_back(MulticastGroup::deriveMulticastGroupForAddressResolution(*ip));
+    newGroups.insert(newGroups.end(), _stackGroups.begin(), _stackGroups.end());
 
     std::sort(newGroups.begin(), newGroups.end());
+    newGroups.erase(std::unique(newGroups.begin(), newGroups.end()), newGroups.end());
 
     for (std::vector<MulticastGroup>::iterator m(newGroups.begin()); m != newGroups.end(); ++m) {
         if (! std::binary_search(_multicastGroups.begin(), _multicastGroups.end(), *m))
@@ -231,9 +252,124 @@ void VirtualTap::scanMulticastGroups(std::vector<MulticastGroup>& added, std::ve
     _multicastGroups.swap(newGroups);
 }
 
+void VirtualTap::setMulticastHandler(void (*handler)(void*))
+{
+    _multicastHandler = handler;
+}
+
+void VirtualTap::multicastMembership(const MulticastGroup& mg, bool join)
+{
+    {
+        Mutex::Lock _l(_multicastGroups_m);
+        if (join ? ! _stackGroups.insert(mg).second : ! _stackGroups.erase(mg)) {
+            return;
+        }
+    }
+    if (_multicastHandler) {
+        _multicastHandler(_arg);
+    }
+}
+
 void VirtualTap::setMtu(unsigned int mtu)
 {
+    if (mtu == _mtu) {
+        return;
+    }
     _mtu = mtu;
+    zts_lwip_set_mtu(netif4, mtu);
+    zts_lwip_set_mtu(netif6, mtu);
+}
+
+void VirtualTap::learnNeighbor4(uint32_t ip, const MAC& mac)
+{
+    // ZeroTier only lets a member send with its own MAC address (unless it
+    // is a bridge), so this is as trustworthy as an ARP reply
+    if (mac != MAC(mac.toAddress(_net_id), _net_id)) {
+        return;
+    }
+    Mutex::Lock _l(_neighbors_m);
+    Neighbor& n = _neighbors4[ip];
+    n.mac = mac;
+    n.lastSeen = OSUtils::now();
+}
+
+bool VirtualTap::neighborMac4(uint32_t ip, MAC& mac)
+{
+    Mutex::Lock _l(_neighbors_m);
+    std::map<uint32_t, Neighbor>::iterator it(_neighbors4.find(ip));
+    if (it == _neighbors4.end() || OSUtils::now() - it->second.lastSeen > ZTS_NEIGHBOR_MAX_AGE) {
+        return false;
+    }
+    mac = it->second.mac;
+    return true;
+}
+
+bool VirtualTap::neighborMac6(const uint8_t* ip, MAC& mac) const
+{
+    uint64_t node_id = 0;
+    if (ip[0] == 0xfd && ip[9] == 0x99 && ip[10] == 0x93) {
+        // RFC4193: fd<net_id>:9993:<node_id>
+        for (int i = 0; i < 8; i++) {
+            if (ip[1 + i] != (uint8_t)(_net_id >> (56 - 8 * i))) {
+                return false;
+            }
+        }
+        for (int i = 11; i < 16; i++) {
+            node_id = (node_id << 8) | ip[i];
+        }
+    }
+    else if (ip[0] == 0xfc) {
+        // 6PLANE: fc<net_id folded to 32 bits><node_id>::/80
+        uint32_t net_id32 = (uint32_t)(_net_id ^ (_net_id >> 32));
+        for (int i = 0; i < 4; i++) {
+            if (ip[1 + i] != (uint8_t)(net_id32 >> (24 - 8 * i))) {
+                return false;
+            }
+        }
+        for (int i = 5; i < 10; i++) {
+            node_id = (node_id << 8) | ip[i];
+        }
+    }
+    else {
+        return false;
+    }
+    mac.fromAddress(Address(node_id), _net_id);
+    return true;
+}
+
+int64_t VirtualTap::expireNeighbors()
+{
+    int64_t now = OSUtils::now();
+    int64_t next = ZTS_NEIGHBOR_MAX_AGE;
+    Mutex::Lock _l(_neighbors_m);
+    for (std::map<uint32_t, Neighbor>::iterator it(_neighbors4.begin()); it != _neighbors4.end();) {
+        if (now - it->second.lastSeen > ZTS_NEIGHBOR_MAX_AGE) {
+            _neighbors4.erase(it++);
+        }
+        else {
+            next = std::min(next, ZTS_NEIGHBOR_MAX_AGE - (now - it->second.lastSeen) + 1);
+            ++it;
+        }
+    }
+    // Expire neighbours in batches
+    return std::max(next, (int64_t)(ZTS_NEIGHBOR_MAX_AGE / 10));
+}
+
+void VirtualTap::setChecksumOffloadPeer(const MAC& mac, bool offload)
+{
+    Mutex::Lock _l(_checksumOffloadPeers_m);
+    if (offload) {
+        _checksumOffloadPeers.insert(mac.toInt());
+    }
+    else {
+        _checksumOffloadPeers.erase(mac.toInt());
+    }
+}
+
+bool VirtualTap::isChecksumOffloadPeer(const MAC& mac)
+{
+    Mutex::Lock _l(_checksumOffloadPeers_m);
+    return _checksumOffloadPeers.count(mac.toInt()) != 0;
 }
 
 void VirtualTap::threadMain() throw()
@@ -252,6 +388,10 @@ void VirtualTap::threadMain() throw()
     // pthread_setname_np(vtap_full_name);
 #endif
     while (true) {
+        // Sleep until neighbours are due to expire
+        int64_t next = expireNeighbors();
+        tv.tv_sec = (long)(next / 1000);
+        tv.tv_usec = (long)((next % 1000) * 1000);
         FD_SET(_shutdownSignalPipe[0], &readfds);
         select(nfds, &readfds, &nullfds, &nullfds, &tv);
         // writes to shutdown pipe terminate thread
@@ -260,10 +400,6 @@ void VirtualTap::threadMain() throw()
         }
 #if defined(__WINDOWS__)
         Sleep(ZTS_TAP_THREAD_POLLING_INTERVAL);
-#else
-        struct timespec sleepValue = { 0, 0 };
-        sleepValue.tv_nsec = ZTS_TAP_THREAD_POLLING_INTERVAL * 500000;
-        nanosleep(&sleepValue, NULL);
 #endif
     }
 }
@@ -281,6 +417,9 @@ int netifCount = 0;
 // Lock to guard access to network stack state changes
 Mutex lwip_state_m;
 
+// Signalled when the driver thread is to exit
+static sys_sem_t driver_sem;
+
 // Callback for when the TCPIP thread has been successfully started
 static void zts_tcpip_init_done(void* arg)
 {
@@ -300,16 +439,15 @@ static void zts_main_lwip_driver_loop(void* arg)
 #if defined(__APPLE__)
     // pthread_setname_np(ZTS_LWIP_THREAD_NAME);
 #endif
-    sys_sem_t sem;
     LWIP_UNUSED_ARG(arg);
-    if (sys_sem_new(&sem, 0) != ERR_OK) {
+    if (sys_sem_new(&driver_sem, 0) != ERR_OK) {
         // DEBUG_ERROR("failed to create semaphore");
     }
-    tcpip_init(zts_tcpip_init_done, &sem);
-    sys_sem_wait(&sem);
-    // Main loop
+    tcpip_init(zts_tcpip_init_done, &driver_sem);
+    sys_sem_wait(&driver_sem);
+    // The tcpip thread does all the work, see zts_lwip_driver_shutdown()
     while (zts_events->getState(ZTS_STATE_STACK_RUNNING)) {
-        zts_util_delay(LWIP_DRIVER_LOOP_INTERVAL);
+        sys_sem_wait(&driver_sem);
     }
     _has_exited = true;
     
@@ -355,10 +493,12 @@ void zts_lwip_driver_shutdown()
     zts_events->clrState(ZTS_STATE_STACK_RUNNING);
     // Wait until the main lwIP thread has exited
     if (_has_started) {
+        sys_sem_signal(&driver_sem);
         while (! _has_exited) {
             zts_util_delay(LWIP_DRIVER_LOOP_INTERVAL);
         }
     }
+    socket_count_reset();
 }
 
 void zts_lwip_remove_netif(void* netif)
@@ -374,6 +514,155 @@ void zts_lwip_remove_netif(void* netif)
     UNLOCK_TCPIP_CORE();
 }
 
+void zts_lwip_set_mtu(void* netif, unsigned int mtu)
+{
+    if (! netif) {
+        return;
+    }
+    struct netif* n = (struct netif*)netif;
+    u16_t new_mtu = (u16_t)std::min(LWIP_MTU, (int)mtu);
+    LOCK_TCPIP_CORE();
+    u16_t old_mtu = n->mtu;
+    n->mtu = new_mtu;
+#if LWIP_IPV6 && LWIP_ND6_ALLOW_RA_UPDATES
+    n->mtu6 = new_mtu;
+#endif
+    if (new_mtu < old_mtu) {
+        // New connections pick up the MTU from the netif, established ones
+        // only need to stop sending segments that no longer fit. Segments
+        // already queued are fragmented, with a checksum from lwIP (see
+        // zts_lwip_hook_tcp_out_add_tcpopts()).
+        for (struct tcp_pcb* pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+            if (ip_route(&pcb->local_ip, &pcb->remote_ip) == n) {
+                pcb->mss = tcp_eff_send_mss_netif(pcb->mss, n, &pcb->remote_ip);
+            }
+        }
+#if LWIP_IPV6
+        // Path MTUs are cached per destination
+        nd6_clear_destination_cache();
+#endif
+    }
+    UNLOCK_TCPIP_CORE();
+}
+
+//----------------------------------------------------------------------------//
+// Checksum offload                                                           //
+//----------------------------------------------------------------------------//
+
+/*
+ * Frames on a ZeroTier network are authenticated end-to-end, so libzt netifs
+ * never verify IP, TCP or UDP checksums (see zts_netif_init4/6). Generation is
+ * skipped where the receiver can't tell the difference:
+ *
+ * - UDP over IPv4: lwIP sends a zero checksum, which means "no checksum".
+ * - TCP: lwIP leaves the checksum out and every TCP handshake carries an
+ *   option announcing this. Frames to members that announced the same in
+ *   their last handshake are sent as they are, all others get their checksum
+ *   filled in here, on the copy that is handed to ZeroTier anyway. Segments
+ *   too large for one frame (queued before the MTU was lowered) are
+ *   fragmented, so lwIP generates their checksum instead.
+ *
+ * UDP over IPv6 (mandatory checksum, and datagrams may be fragmented),
+ * ICMP and the IPv4 header checksum are still generated by lwIP.
+ */
+
+/**
+ * Locate the TCP header of an IPv4 or IPv6 frame payload
+ *
+ * @return Offset of the TCP header, or -1 if this isn't an unfragmented TCP
+ * segment. `tcp_len` is set to the length of the segment.
+ */
+static int zts_tcp_offset(const uint8_t* ip, int len, unsigned int etherType, int* tcp_len)
+{
+    if (etherType == 0x800 && len >= 20 && ip[9] == IP_PROTO_TCP && ! ((ip[6] << 8 | ip[7]) & 0x3fff)) {
+        int ihl = (ip[0] & 0x0f) * 4;
+        *tcp_len = std::min((ip[2] << 8 | ip[3]), len) - ihl;
+        return *tcp_len >= TCP_HLEN ? ihl : -1;
+    }
+    if (etherType == 0x86DD && len >= 40 && ip[6] == IP_PROTO_TCP) {
+        *tcp_len = std::min((ip[4] << 8 | ip[5]), len - 40);
+        return *tcp_len >= TCP_HLEN ? 40 : -1;
+    }
+    return -1;
+}
+
+extern "C" int zts_tcp_fits_mtu(unsigned int tcp_len, int ipv6, unsigned int mtu)
+{
+    // As ip4_output_if() and ip6_output_if(), which fragment
+    return ! mtu || tcp_len + (ipv6 ? 40 : 20) <= mtu;
+}
+
+extern "C" int zts_tcp_fill_offset(const uint8_t* ip, int len, int avail, unsigned int etherType, int* tcp_len)
+{
+    if (avail < 40) {
+        return -1;
+    }
+    int tcp_off = zts_tcp_offset(ip, len, etherType, tcp_len);
+    if (tcp_off < 0 || tcp_off + *tcp_len != len || tcp_off + TCP_HLEN > avail) {
+        return -1;
+    }
+    // lwIP leaves the field zero unless it generated the checksum (a generated
+    // zero checksum is filled in the same)
+    const uint8_t* tcp = ip + tcp_off;
+    return tcp[16] || tcp[17] ? -1 : tcp_off;
+}
+
+/**
+ * Return whether a TCP header carries the option announcing checksum offload
+ */
+static bool zts_tcp_has_nocsum_opt(const uint8_t* tcp, int tcp_len)
+{
+    int end = std::min((tcp[12] >> 4) * 4, tcp_len);
+    for (int i = TCP_HLEN; i < end;) {
+        if (tcp[i] == 0) {
+            break;
+        }
+        if (tcp[i] == 1) {
+            i++;
+            continue;
+        }
+        if (i + 1 >= end || tcp[i + 1] < 2) {
+            break;
+        }
+        if (tcp[i] == ZTS_TCP_OPT_EXP && tcp[i + 1] == ZTS_TCP_OPT_LEN_NOCSUM && i + 4 <= end
+            && (tcp[i + 2] << 8 | tcp[i + 3]) == ZTS_TCP_OPT_EXID_NOCSUM) {
+            return true;
+        }
+        i += tcp[i + 1];
+    }
+    return false;
+}
+
+/**
+ * Fill in the checksum of a TCP segment, given the one's complement sum of the
+ * segment with a zero checksum field (see zts_chksum())
+ */
+static void zts_tcp_fill_checksum(uint8_t* ip, uint8_t* tcp, int tcp_len, unsigned int etherType, uint16_t tcp_sum)
+{
+    uint8_t pseudo[40] = { 0 };
+    int pseudo_len;
+    if (etherType == 0x800) {
+        // Source and destination address, zero, protocol, 16-bit length
+        memcpy(pseudo, ip + 12, 8);
+        pseudo[9] = IP_PROTO_TCP;
+        pseudo[10] = (uint8_t)(tcp_len >> 8);
+        pseudo[11] = (uint8_t)tcp_len;
+        pseudo_len = 12;
+    }
+    else {
+        // Source and destination address, 32-bit length, zero, next header
+        memcpy(pseudo, ip + 8, 32);
+        pseudo[34] = (uint8_t)(tcp_len >> 8);
+        pseudo[35] = (uint8_t)tcp_len;
+        pseudo[39] = IP_PROTO_TCP;
+        pseudo_len = 40;
+    }
+    uint32_t sum = (uint32_t)zts_chksum(pseudo, pseudo_len) + tcp_sum;
+    sum = (sum & 0xffff) + (sum >> 16);
+    uint16_t chksum = (uint16_t)~sum;
+    memcpy(tcp + 16, &chksum, sizeof(chksum));
+}
+
 signed char zts_lwip_eth_tx(struct netif* n, struct pbuf* p)
 {
     if (! n) {
@@ -384,29 +673,404 @@ signed char zts_lwip_eth_tx(struct netif* n, struct pbuf* p)
     char* bufptr;
     int totalLength = 0;
 
+    timers_output_activity();
     VirtualTap* tap = (VirtualTap*)n->state;
-    bufptr = buf;
-    for (q = p; q != NULL; q = q->next) {
-        memcpy(bufptr, q->payload, q->len);
-        bufptr += q->len;
-        totalLength += q->len;
+    if (p->len < sizeof(struct eth_hdr)) {
+        return ERR_IF;
     }
     struct eth_hdr* ethhdr;
-    ethhdr = (struct eth_hdr*)buf;
+    ethhdr = (struct eth_hdr*)p->payload;
 
     MAC src_mac;
     MAC dest_mac;
     src_mac.setTo(ethhdr->src.addr, 6);
     dest_mac.setTo(ethhdr->dest.addr, 6);
+    int proto = Utils::ntoh((uint16_t)ethhdr->type);
 
+    // lwIP keeps all headers in the first pbuf. If the TCP checksum has to be
+    // filled in, the segment is summed while it is copied (the checksum field
+    // is zero since lwIP didn't generate it).
+    int tcp_len = 0;
+    int tcp_start = -1;
+    if (! tap->isChecksumOffloadPeer(dest_mac)) {
+        int tcp_off = zts_tcp_fill_offset(
+            (uint8_t*)p->payload + sizeof(struct eth_hdr),
+            p->tot_len - sizeof(struct eth_hdr),
+            p->len - sizeof(struct eth_hdr),
+            proto,
+            &tcp_len);
+        if (tcp_off >= 0) {
+            tcp_start = sizeof(struct eth_hdr) + tcp_off;
+        }
+    }
+    uint32_t tcp_sum = 0;
+    bool tcp_sum_odd = false;
+    bufptr = buf;
+    for (q = p; q != NULL; q = q->next) {
+        int plain = q->len;
+        if (tcp_start >= 0) {
+            plain = std::min(std::max(tcp_start - totalLength, 0), (int)q->len);
+        }
+        memcpy(bufptr, q->payload, plain);
+        if (plain < q->len) {
+            uint16_t part = zts_chksum_copy(bufptr + plain, (char*)q->payload + plain, q->len - plain);
+            // A part following an odd number of bytes is summed with the
+            // bytes of each word swapped
+            tcp_sum += tcp_sum_odd ? (uint16_t)(part << 8 | part >> 8) : part;
+            tcp_sum_odd ^= (q->len - plain) & 1;
+        }
+        bufptr += q->len;
+        totalLength += q->len;
+    }
     char* data = buf + sizeof(struct eth_hdr);
     int len = totalLength - sizeof(struct eth_hdr);
-    int proto = Utils::ntoh((uint16_t)ethhdr->type);
+    if (tcp_start >= 0) {
+        tcp_sum = (tcp_sum & 0xffff) + (tcp_sum >> 16);
+        tcp_sum = (tcp_sum & 0xffff) + (tcp_sum >> 16);
+        zts_tcp_fill_checksum((uint8_t*)data, (uint8_t*)buf + tcp_start, tcp_len, proto, (uint16_t)tcp_sum);
+    }
+    int64_t now = tap->_txShaper.limited() ? OSUtils::now() : 0;
+    if (! tap->_txShaper.admit((uint8_t*)buf, totalLength, now)) {
+        tap->drainTx();   // Queued or dropped, it may still be the next to go
+        return ERR_OK;
+    }
     tap->_handler(tap->_arg, NULL, tap->_net_id, src_mac, dest_mac, proto, 0, data, len);
 
     return ERR_OK;
 }
 
+/**
+ * Send a frame queued by the shaper
+ */
+static void zts_tap_send_queued(VirtualTap* tap, const std::string& frame)
+{
+    const struct eth_hdr* ethhdr = (const struct eth_hdr*)frame.data();
+    MAC src_mac;
+    MAC dest_mac;
+    src_mac.setTo(ethhdr->src.addr, 6);
+    dest_mac.setTo(ethhdr->dest.addr, 6);
+    int proto = Utils::ntoh((uint16_t)ethhdr->type);
+    tap->_handler(
+        tap->_arg,
+        NULL,
+        tap->_net_id,
+        src_mac,
+        dest_mac,
+        proto,
+        0,
+        frame.data() + sizeof(struct eth_hdr),
+        frame.size() - sizeof(struct eth_hdr));
+}
+
+static void zts_tap_drain_tx(void* arg)
+{
+    VirtualTap* tap = (VirtualTap*)arg;
+    tap->_txDrainScheduled = false;
+    tap->drainTx();
+}
+
+void VirtualTap::drainTx()
+{
+    int64_t now = OSUtils::now();
+    std::string frame;
+    while (_txShaper.dequeue(frame, now)) {
+        timers_output_activity();
+        zts_tap_send_queued(this, frame);
+    }
+    int64_t wait = _txShaper.waitTime();
+    if (wait >= 0 && ! _txDrainScheduled) {
+        _txDrainScheduled = true;
+        sys_timeout((u32_t)std::max(wait, (int64_t)1), zts_tap_drain_tx, this);
+    }
+}
+
+void VirtualTap::setTxRate(uint64_t bytesPerSec, unsigned int burst)
+{
+    LOCK_TCPIP_CORE();
+    _txShaper.setRate(bytesPerSec, burst, OSUtils::now());
+    // The next frame may be due sooner (or now) at the new rate
+    sys_untimeout(zts_tap_drain_tx, this);
+    _txDrainScheduled = false;
+    drainTx();
+    UNLOCK_TCPIP_CORE();
+}
+
+void VirtualTap::setTxClassWeight(int cls, unsigned int weight)
+{
+    LOCK_TCPIP_CORE();
+    _txShaper.setWeight(cls, weight);
+    UNLOCK_TCPIP_CORE();
+}
+
+void VirtualTap::getTxClassStats(int cls, zts_tx_class_stats_t* stats)
+{
+    LOCK_TCPIP_CORE();
+    _txShaper.getStats(cls, stats);
+    UNLOCK_TCPIP_CORE();
+}
+
+//----------------------------------------------------------------------------//
+// Receive offload                                                            //
+//----------------------------------------------------------------------------//
+
+/*
+ * ZeroTier delivers inbound frames one at a time, but the service reads them
+ * from the wire in batches (one Phy poll). Within a batch, consecutive
+ * in-order segments of a TCP flow are merged into one large segment before it
+ * is handed to lwIP, so that IP and TCP input, the libzt TCP hooks and the
+ * ACK decision run once per merge instead of once per frame. The batch ends
+ * with VirtualTap::flushReceiveBatch().
+ *
+ * Only plain data segments (ACK, optionally PSH) without IP options or
+ * extension headers are merged, and only if every header field except the
+ * sequence number, lengths, IP ID and checksums matches. Anything else from
+ * the same flow flushes what is held first, so lwIP sees the flow's segments
+ * in order. A PSH segment ends a merge. Checksums of merged segments aren't
+ * recomputed (libzt netifs don't verify them), the IP length is.
+ *
+ * lwIP acknowledges every second segment it receives and delays the ACK for
+ * the others. A merge stands for at least two segments, so a delayed ACK for
+ * it is sent right away instead of up to a timer interval later, which would
+ * stall the sender's ACK clock.
+ */
+
+/**
+ * Return the length of all headers (Ethernet, IP, TCP) of a frame that is a
+ * candidate for merging, or 0 if it isn't
+ */
+static int zts_gro_header_len(const uint8_t* f, int len, unsigned int etherType)
+{
+    const uint8_t* ip = f + sizeof(struct eth_hdr);
+    int ip_len = len - (int)sizeof(struct eth_hdr);
+    int ihl;
+    if (etherType == 0x800) {
+        if (ip_len < 20 || ip[0] != 0x45 || ip[9] != IP_PROTO_TCP || ((ip[6] << 8 | ip[7]) & 0x3fff)
+            || (ip[2] << 8 | ip[3]) != ip_len) {
+            return 0;
+        }
+        ihl = 20;
+    }
+    else if (etherType == 0x86DD) {
+        if (ip_len < 40 || ip[6] != IP_PROTO_TCP || (ip[4] << 8 | ip[5]) != ip_len - 40) {
+            return 0;
+        }
+        ihl = 40;
+    }
+    else {
+        return 0;
+    }
+    const uint8_t* tcp = ip + ihl;
+    int thl = (tcp[12] >> 4) * 4;
+    if (ip_len - ihl < TCP_HLEN || thl < TCP_HLEN || (tcp[13] & ~TCP_PSH) != TCP_ACK) {
+        return 0;
+    }
+    if (ip_len - ihl - thl <= 0) {
+        return 0;
+    }
+    return (int)sizeof(struct eth_hdr) + ihl + thl;
+}
+
+/**
+ * Return whether a TCP segment (IP header at `ip`, TCP header at `ip + tcp_off`)
+ * belongs to the same flow as a held frame
+ */
+static bool zts_gro_same_flow(const uint8_t* held, const uint8_t* ip, int tcp_off, unsigned int etherType)
+{
+    const uint8_t* ip_h = held + sizeof(struct eth_hdr);
+    // Held frames have no IP options or extension headers
+    int ihl = etherType == 0x800 ? 20 : 40;
+    int addr_off = etherType == 0x800 ? 12 : 8;
+    return memcmp(ip_h + addr_off, ip + addr_off, ihl - addr_off) == 0 && memcmp(ip_h + ihl, ip + tcp_off, 4) == 0;
+}
+
+/**
+ * Return whether a candidate frame can be appended to a held frame of the same
+ * flow with the same header length
+ */
+static bool zts_gro_can_merge(const uint8_t* held, const uint8_t* f, unsigned int etherType, int hdr_len)
+{
+    const uint8_t* ip_h = held + sizeof(struct eth_hdr);
+    const uint8_t* ip_f = f + sizeof(struct eth_hdr);
+    int ihl = etherType == 0x800 ? 20 : 40;
+    const uint8_t* tcp_h = ip_h + ihl;
+    const uint8_t* tcp_f = ip_f + ihl;
+    int thl = hdr_len - (int)sizeof(struct eth_hdr) - ihl;
+    if (etherType == 0x800) {
+        // Version, TOS | flags, TTL, protocol
+        if (memcmp(ip_h, ip_f, 2) != 0 || memcmp(ip_h + 6, ip_f + 6, 4) != 0) {
+            return false;
+        }
+    }
+    // Version, traffic class, flow label | next header, hop limit
+    else if (memcmp(ip_h, ip_f, 4) != 0 || memcmp(ip_h + 6, ip_f + 6, 2) != 0) {
+        return false;
+    }
+    // Acknowledgement, data offset | window | options
+    return tcp_h[13] == TCP_ACK && memcmp(tcp_h + 8, tcp_f + 8, 5) == 0 && memcmp(tcp_h + 14, tcp_f + 14, 2) == 0
+           && memcmp(tcp_h + TCP_HLEN, tcp_f + TCP_HLEN, thl - TCP_HLEN) == 0;
+}
+
+/**
+ * Deliver a received frame to the netif for its EtherType
+ */
+static void zts_lwip_eth_input(VirtualTap* tap, struct pbuf* p, unsigned int etherType)
+{
+    struct netif* n = NULL;
+    if (etherType == 0x800 || etherType == 0x806) {
+        n = (struct netif*)tap->netif4;
+    }
+    else if (etherType == 0x86DD) {
+        n = (struct netif*)tap->netif6;
+    }
+    if (! n) {
+        pbuf_free(p);
+        return;
+    }
+    timers_input_activity();
+    if (n->input(p, n) != ERR_OK) {
+        // DEBUG_ERROR("packet input error");
+        pbuf_free(p);
+    }
+}
+
+/**
+ * Send the ACK that lwIP delayed for a merged segment, if any. `ip` holds the
+ * segment's IP header and the first bytes of its TCP header (the ports).
+ */
+static void zts_gro_ack(const uint8_t* ip, unsigned int etherType)
+{
+    // Held frames have no IP options or extension headers
+    int ihl = etherType == 0x800 ? 20 : 40;
+    const uint8_t* src = ip + (etherType == 0x800 ? 12 : 8);
+    const uint8_t* dst = ip + (etherType == 0x800 ? 16 : 24);
+    u16_t src_port = (u16_t)(ip[ihl] << 8 | ip[ihl + 1]);
+    u16_t dst_port = (u16_t)(ip[ihl + 2] << 8 | ip[ihl + 3]);
+    LOCK_TCPIP_CORE();
+    for (struct tcp_pcb* pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+        if (pcb->local_port != dst_port || pcb->remote_port != src_port) {
+            continue;
+        }
+        bool match = etherType == 0x800 ? IP_IS_V4_VAL(pcb->local_ip)
+                                              && memcmp(ip_2_ip4(&pcb->local_ip), dst, 4) == 0
+                                              && memcmp(ip_2_ip4(&pcb->remote_ip), src, 4) == 0
+                                        : IP_IS_V6_VAL(pcb->local_ip)
+                                              && memcmp(ip_2_ip6(&pcb->local_ip)->addr, dst, 16) == 0
+                                              && memcmp(ip_2_ip6(&pcb->remote_ip)->addr, src, 16) == 0;
+        if (! match) {
+            continue;
+        }
+        if (pcb->flags & TF_ACK_DELAY) {
+            tcp_ack_now(pcb);
+            tcp_output(pcb);
+        }
+        break;
+    }
+    UNLOCK_TCPIP_CORE();
+}
+
+/**
+ * Fix up the IP length of a held frame and deliver it. Called with
+ * _groFlows_m held.
+ */
+static void zts_gro_flush(VirtualTap* tap, VirtualTap::GroFlow* flow)
+{
+    struct pbuf* p = (struct pbuf*)flow->p;
+    flow->p = NULL;
+    if (flow->segments == 1) {
+        zts_lwip_eth_input(tap, p, flow->etherType);
+        return;
+    }
+    uint8_t* ip = (uint8_t*)p->payload + sizeof(struct eth_hdr);
+    int ip_len = p->tot_len - (int)sizeof(struct eth_hdr);
+    if (flow->etherType == 0x800) {
+        ip[2] = (uint8_t)(ip_len >> 8);
+        ip[3] = (uint8_t)ip_len;
+    }
+    else {
+        ip[4] = (uint8_t)((ip_len - 40) >> 8);
+        ip[5] = (uint8_t)(ip_len - 40);
+    }
+    // lwIP may free the frame, keep what identifies the connection
+    uint8_t hdr[40 + 4];
+    memcpy(hdr, ip, (flow->etherType == 0x800 ? 20 : 40) + 4);
+    zts_lwip_eth_input(tap, p, flow->etherType);
+    zts_gro_ack(hdr, flow->etherType);
+}
+
+/**
+ * Hold or merge a received frame (Ethernet header included)
+ *
+ * @return Whether the frame was taken over, otherwise the caller delivers it
+ */
+static bool zts_gro_receive(VirtualTap* tap, struct pbuf* p, unsigned int etherType)
+{
+    const uint8_t* f = (const uint8_t*)p->payload;
+    const uint8_t* ip = f + sizeof(struct eth_hdr);
+    int tcp_len;
+    int tcp_off = -1;
+    if (! p->next) {
+        tcp_off = zts_tcp_offset(ip, p->len - (int)sizeof(struct eth_hdr), etherType, &tcp_len);
+    }
+    if (tcp_off < 0) {
+        return false;
+    }
+    const uint8_t* tcp = ip + tcp_off;
+    uint32_t seq;
+    memcpy(&seq, tcp + 4, sizeof(seq));
+    seq = lwip_ntohl(seq);
+    int hdr_len = zts_gro_header_len(f, p->len, etherType);
+    int payload = p->len - hdr_len;
+
+    Mutex::Lock _l(tap->_groFlows_m);
+    VirtualTap::GroFlow* slot = NULL;
+    for (int i = 0; i < ZTS_GRO_MAX_FLOWS; i++) {
+        VirtualTap::GroFlow* flow = &tap->_groFlows[i];
+        if (! flow->p) {
+            slot = slot ? slot : flow;
+            continue;
+        }
+        struct pbuf* held = (struct pbuf*)flow->p;
+        if (flow->etherType != etherType || ! zts_gro_same_flow((uint8_t*)held->payload, ip, tcp_off, etherType)) {
+            continue;
+        }
+        if (hdr_len && hdr_len == flow->hdrLen && seq == flow->nextSeq && held->tot_len + payload <= ZTS_GRO_MAX_SIZE
+            && zts_gro_can_merge((uint8_t*)held->payload, f, etherType, hdr_len)) {
+            pbuf_remove_header(p, hdr_len);
+            pbuf_cat(held, p);
+            flow->nextSeq += payload;
+            flow->segments++;
+            if (tcp[13] & TCP_PSH) {
+                zts_gro_flush(tap, flow);
+            }
+            return true;
+        }
+        // Anything else from this flow goes after what is held
+        zts_gro_flush(tap, flow);
+        slot = flow;
+        break;
+    }
+    // Start a merge, unless the frame ends one or all slots are in use
+    if (! hdr_len || (tcp[13] & TCP_PSH) || ! slot) {
+        return false;
+    }
+    slot->p = p;
+    slot->etherType = etherType;
+    slot->hdrLen = hdr_len;
+    slot->nextSeq = seq + payload;
+    slot->segments = 1;
+    return true;
+}
+
+void VirtualTap::flushReceiveBatch()
+{
+    Mutex::Lock _l(_groFlows_m);
+    for (int i = 0; i < ZTS_GRO_MAX_FLOWS; i++) {
+        if (_groFlows[i].p) {
+            zts_gro_flush(this, &_groFlows[i]);
+        }
+    }
+}
+
 void zts_lwip_eth_rx(
     VirtualTap* tap,
     const MAC& from,
@@ -453,24 +1117,23 @@ void zts_lwip_eth_rx(
         memcpy(q->payload, dataptr, q->len);
         dataptr += q->len;
     }
-    // Feed packet into stack
-    int err;
-
-    if (Utils::ntoh(ethhdr.type) == 0x800 || Utils::ntoh(ethhdr.type) == 0x806) {
-        if (tap->netif4) {
-            if ((err = ((struct netif*)tap->netif4)->input(p, (struct netif*)tap->netif4)) != ERR_OK) {
-                // DEBUG_ERROR("packet input error (%d)", err);
-                pbuf_free(p);
-            }
+    // Handshakes tell whether the remote host verifies TCP checksums
+    int tcp_len;
+    int tcp_off = zts_tcp_offset((const uint8_t*)data, len, etherType, &tcp_len);
+    if (tcp_off >= 0) {
+        const uint8_t* tcp = (const uint8_t*)data + tcp_off;
+        if (tcp[13] & TCP_SYN) {
+            tap->setChecksumOffloadPeer(from, zts_tcp_has_nocsum_opt(tcp, tcp_len));
         }
     }
-    if (Utils::ntoh(ethhdr.type) == 0x86DD) {
-        if (tap->netif6) {
-            if ((err = ((struct netif*)tap->netif6)->input(p, (struct netif*)tap->netif6)) != ERR_OK) {
-                // DEBUG_ERROR("packet input error (%d)", err);
-                pbuf_free(p);
-            }
-        }
+
+    if (tap->netif4 && etherType == 0x800 && len >= 20) {
+        uint32_t src_ip;
+        memcpy(&src_ip, reinterpret_cast<const char*>(data) + 12, sizeof(src_ip));
+        tap->learnNeighbor4(src_ip, from);
+    }
+    if (! zts_gro_receive(tap, p, etherType)) {
+        zts_lwip_eth_input(tap, p, etherType);
     }
 }
 
@@ -485,6 +1148,68 @@ bool zts_lwip_is_netif_up(void* n)
     return result;
 }
 
+/**
+ * Send IPv4 packets to neighbours learned from inbound traffic directly,
+ * without an ARP round trip through the overlay
+ */
+static err_t zts_netif_output4(struct netif* n, struct pbuf* p, const ip4_addr_t* ipaddr)
+{
+    VirtualTap* tap = (VirtualTap*)n->state;
+    MAC mac;
+    if (! ip4_addr_isbroadcast(ipaddr, n) && ! ip4_addr_ismulticast(ipaddr)
+        && ip4_addr_netcmp(ipaddr, netif_ip4_addr(n), netif_ip4_netmask(n)) && tap->neighborMac4(ipaddr->addr, mac)) {
+        struct eth_addr dest;
+        mac.copyTo(dest.addr, 6);
+        return ethernet_output(n, p, (struct eth_addr*)n->hwaddr, &dest, ETHTYPE_IP);
+    }
+    return etharp_output(n, p, ipaddr);
+}
+
+/**
+ * Send IPv6 packets to RFC4193 and 6PLANE addresses directly, the MAC address
+ * of their owner is derived from the address itself, without neighbour
+ * discovery
+ */
+static err_t zts_netif_output6(struct netif* n, struct pbuf* p, const ip6_addr_t* ipaddr)
+{
+    VirtualTap* tap = (VirtualTap*)n->state;
+    MAC mac;
+    if (! ip6_addr_ismulticast(ipaddr) && tap->neighborMac6((const uint8_t*)ipaddr->addr, mac)) {
+        struct eth_addr dest;
+        mac.copyTo(dest.addr, 6);
+        return ethernet_output(n, p, (struct eth_addr*)n->hwaddr, &dest, ETHTYPE_IPV6);
+    }
+    return ethip6_output(n, p, ipaddr);
+}
+
+#if LWIP_IGMP
+/**
+ * Called by lwIP when the first socket joins an IPv4 group on the netif, or the
+ * last one leaves it. Group addresses map to Ethernet multicast addresses as
+ * in RFC 1112.
+ */
+static err_t zts_netif_igmp_mac_filter(struct netif* n, const ip4_addr_t* group, enum netif_mac_filter_action action)
+{
+    VirtualTap* tap = (VirtualTap*)n->state;
+    MAC mac(0x01005e000000ULL | (lwip_ntohl(ip4_addr_get_u32(group)) & 0x7fffff));
+    tap->multicastMembership(MulticastGroup(mac, 0), action == NETIF_ADD_MAC_FILTER);
+    return ERR_OK;
+}
+#endif
+
+#if LWIP_IPV6_MLD
+/**
+ * IPv6 counterpart of zts_netif_igmp_mac_filter(), mapping as in RFC 2464
+ */
+static err_t zts_netif_mld_mac_filter(struct netif* n, const ip6_addr_t* group, enum netif_mac_filter_action action)
+{
+    VirtualTap* tap = (VirtualTap*)n->state;
+    MAC mac(0x333300000000ULL | lwip_ntohl(group->addr[3]));
+    tap->multicastMembership(MulticastGroup(mac, 0), action == NETIF_ADD_MAC_FILTER);
+    return ERR_OK;
+}
+#endif
+
 static err_t zts_netif_init4(struct netif* n)
 {
     if (! n || ! n->state) {
@@ -496,10 +1221,15 @@ static err_t zts_netif_init4(struct netif* n)
     n->name[0] = '4';
     n->name[1] = 'a' + netifCount;
     n->linkoutput = zts_lwip_eth_tx;
-    n->output = etharp_output;
+    n->output = zts_netif_output4;
     n->mtu = std::min(LWIP_MTU, (int)tap->_mtu);
     n->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET | NETIF_FLAG_IGMP | NETIF_FLAG_MLD6
                | NETIF_FLAG_LINK_UP | NETIF_FLAG_UP;
+    // See "Checksum offload"
+    NETIF_SET_CHECKSUM_CTRL(n, NETIF_CHECKSUM_GEN_IP | NETIF_CHECKSUM_GEN_ICMP);
+#if LWIP_IGMP
+    netif_set_igmp_mac_filter(n, zts_netif_igmp_mac_filter);
+#endif
     n->hwaddr_len = sizeof(n->hwaddr);
     tap->_mac.copyTo(n->hwaddr, n->hwaddr_len);
     return ERR_OK;
@@ -518,10 +1248,15 @@ static err_t zts_netif_init6(struct netif* n)
     n->name[0] = '6';
     n->name[1] = 'a' + netifCount;
     n->linkoutput = zts_lwip_eth_tx;
-    n->output_ip6 = ethip6_output;
+    n->output_ip6 = zts_netif_output6;
     n->mtu = std::min(LWIP_MTU, (int)tap->_mtu);
     n->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET | NETIF_FLAG_IGMP | NETIF_FLAG_MLD6
                | NETIF_FLAG_LINK_UP | NETIF_FLAG_UP;
+    // See "Checksum offload"
+    NETIF_SET_CHECKSUM_CTRL(n, NETIF_CHECKSUM_GEN_UDP | NETIF_CHECKSUM_GEN_ICMP6);
+#if LWIP_IPV6_MLD
+    netif_set_mld_mac_filter(n, zts_netif_mld_mac_filter);
+#endif
     return ERR_OK;
 }
 
@@ -598,7 +1333,7 @@ void zts_lwip_init_interface(void* tapref, const InetAddress& ip)
             netif_set_default(n);
         }
         netif_add_ip6_address(n, &ip6, NULL);
-        n->output_ip6 = ethip6_output;
+        n->output_ip6 = zts_netif_output6;
         UNLOCK_TCPIP_CORE();
         snprintf(
             macbuf,
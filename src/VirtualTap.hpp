@@ -25,10 +25,30 @@
 
 #define ZTS_UNUSED_ARG(x) (void)x
 
+// How long an IPv4 neighbour learned from inbound traffic is used without
+// being seen again (ms), same as lwIP's ARP_MAXAGE
+#define ZTS_NEIGHBOR_MAX_AGE 300000
+
+// Experimental TCP option (RFC 6994) sent during the handshake to announce
+// that the sender does not verify TCP checksums, see VirtualTap.cpp
+#define ZTS_TCP_OPT_EXP         253
+#define ZTS_TCP_OPT_EXID_NOCSUM 0x5a54
+#define ZTS_TCP_OPT_LEN_NOCSUM  4
+
+// Receive offload: how many TCP flows per tap may have segments held for
+// merging, and the largest merged frame, see VirtualTap.cpp
+#define ZTS_GRO_MAX_FLOWS 8
+#define ZTS_GRO_MAX_SIZE  65000
+
 #include "Events.hpp"
 #include "MAC.hpp"
+#include "MulticastGroup.hpp"
 #include "Phy.hpp"
 #include "Thread.hpp"
+#include "TxShaper.hpp"
+
+#include <map>
+#include <set>
 
 namespace ZeroTier {
 
@@ -117,10 +137,91 @@ class VirtualTap {
     void scanMulticastGroups(std::vector<MulticastGroup>& added, std::vector<MulticastGroup>& removed);
 
     /**
-     * Set MTU
+     * Set the function called (with the service argument) whenever the network
+     * stack joins or leaves a multicast group, see multicastMembership()
+     */
+    void setMulticastHandler(void (*handler)(void*));
+
+    /**
+     * Record that the network stack joined or left a multicast group (IGMP or
+     * MLD). The service subscribes or unsubscribes with its next
+     * scanMulticastGroups(), which the handler asks for right away.
+     */
+    void multicastMembership(const MulticastGroup& mg, bool join);
+
+    /**
+     * Set MTU, applied to the netifs at once (see zts_lwip_set_mtu)
      */
     void setMtu(unsigned int mtu);
 
+    /**
+     * Record the IPv4 address of the member that sent an inbound frame
+     *
+     * @param ip IPv4 address (network byte order)
+     * @param mac Source MAC address of the frame, ignored unless it is the
+     * ZeroTier-derived MAC address of a member of this network
+     */
+    void learnNeighbor4(uint32_t ip, const MAC& mac);
+
+    /**
+     * Look up the MAC address of an IPv4 neighbour learned from inbound
+     * traffic within the last ZTS_NEIGHBOR_MAX_AGE ms
+     *
+     * @param ip IPv4 address (network byte order)
+     */
+    bool neighborMac4(uint32_t ip, MAC& mac);
+
+    /**
+     * Derive the MAC address of the member that owns an RFC4193 or 6PLANE
+     * address on this network
+     *
+     * @param ip 16-byte IPv6 address
+     * @return Whether the address is an RFC4193 or 6PLANE address of this
+     * network
+     */
+    bool neighborMac6(const uint8_t* ip, MAC& mac) const;
+
+    /**
+     * Forget IPv4 neighbours that have not been seen for
+     * ZTS_NEIGHBOR_MAX_AGE ms
+     *
+     * @return Time (ms) until this should be called again
+     */
+    int64_t expireNeighbors();
+
+    /**
+     * Record whether the member with the given MAC address announced in its
+     * last TCP handshake that it does not verify TCP checksums
+     */
+    void setChecksumOffloadPeer(const MAC& mac, bool offload);
+
+    /**
+     * Return whether TCP checksums may be left out in frames to the member
+     * with the given MAC address
+     */
+    bool isChecksumOffloadPeer(const MAC& mac);
+
+    /**
+     * Hand all TCP segments held for merging to the network stack. Called once
+     * a batch of inbound frames has been presented with put().
+     */
+    void flushReceiveBatch();
+
+    /**
+     * Limit the rate at which frames are sent (see TxShaper)
+     */
+    void setTxRate(uint64_t bytesPerSec, unsigned int burst);
+
+    void setTxClassWeight(int cls, unsigned int weight);
+
+    void getTxClassStats(int cls, zts_tx_class_stats_t* stats);
+
+    /**
+     * Send the queued frames the rate limit allows, and schedule sending the
+     * rest. Called with the core lock held.
+     */
+    void drainTx();
+
     /**
      * Calls main network stack loops
      */
@@ -171,7 +272,33 @@ class VirtualTap {
     int _shutdownSignalPipe[2] = { 0 };
 
     std::vector<MulticastGroup> _multicastGroups;
+    std::set<MulticastGroup> _stackGroups;   // Joined by the network stack
     Mutex _multicastGroups_m;
+    void (*_multicastHandler)(void*) = NULL;
+
+    struct Neighbor {
+        MAC mac;
+        int64_t lastSeen;
+    };
+    std::map<uint32_t, Neighbor> _neighbors4;
+    Mutex _neighbors_m;
+
+    std::set<uint64_t> _checksumOffloadPeers;
+    Mutex _checksumOffloadPeers_m;
+
+    struct GroFlow {
+        void* p;   // Held frame (struct pbuf*), NULL if the slot is free
+        unsigned int etherType;
+        int hdrLen;
+        uint32_t nextSeq;
+        int segments;
+    };
+    GroFlow _groFlows[ZTS_GRO_MAX_FLOWS] = {};
+    Mutex _groFlows_m;
+
+    // Guarded by the core lock
+    TxShaper _txShaper;
+    bool _txDrainScheduled = false;
 
     void phyOnTcpConnect(PhySocket* sock, void** uptr, bool success)
     {
@@ -207,7 +334,8 @@ class VirtualTap {
 bool zts_lwip_is_netif_up(void* netif);
 
 /**
- * @brief Increase the delay multiplier for the main driver loop
+ * @brief Stop the stack's cyclic timers now if there is nothing left for them
+ * to do, instead of after ZTS_HIBERNATE_IDLE_TIME (see Timers.cpp)
  *
  * @usage This should be called when we know the stack won't be used by any
  * virtual taps
@@ -215,9 +343,10 @@ bool zts_lwip_is_netif_up(void* netif);
 void zts_lwip_hibernate_driver();
 
 /**
- * @brief Decrease the delay multiplier for the main driver loop
+ * @brief Restart the stack's cyclic timers if they were stopped
  *
- * @usage This should be called when at least one virtual tap is active
+ * @usage This should be called before using stack state that is aged while
+ * hibernating (lwIP's DNS cache)
  */
 void zts_lwip_wake_driver();
 
@@ -250,6 +379,12 @@ void zts_lwip_driver_shutdown();
  */
 void zts_lwip_remove_netif(void* netif);
 
+/**
+ * @brief Apply a new MTU (capped at LWIP_MTU) to a netif and to the TCP
+ * connections using it
+ */
+void zts_lwip_set_mtu(void* netif, unsigned int mtu);
+
 /**
  * @brief Starts DHCP timers
  */
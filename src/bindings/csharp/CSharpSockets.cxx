@@ -698,6 +698,11 @@ SWIGEXPORT int SWIGSTDCALL CSharp_zts_init_set_port(unsigned short port)
     return zts_init_set_port(port);
 }
 
+SWIGEXPORT int SWIGSTDCALL CSharp_zts_init_set_max_sockets(unsigned int max_sockets)
+{
+    return zts_init_set_max_sockets(max_sockets);
+}
+
 SWIGEXPORT int SWIGSTDCALL CSharp_zts_init_set_random_port_range(unsigned short start_port, unsigned short end_port)
 {
     return zts_init_set_random_port_range(start_port, end_port);
@@ -1841,6 +1846,63 @@ SWIGEXPORT int SWIGSTDCALL CSharp_zts_get_keepalive(int jarg1)
     return jresult;
 }
 
+SWIGEXPORT int SWIGSTDCALL CSharp_zts_get_tcp_info(int jarg1, void* jarg2)
+{
+    int jresult;
+    int arg1;
+    zts_tcp_info_t* arg2 = (zts_tcp_info_t*)0;
+    int result;
+    arg1 = (int)jarg1;
+    arg2 = (zts_tcp_info_t*)jarg2;
+    result = (int)zts_get_tcp_info(arg1, arg2);
+    jresult = result;
+    return jresult;
+}
+
+SWIGEXPORT int SWIGSTDCALL CSharp_zts_set_tcp_mem_limit(unsigned int jarg1)
+{
+    int jresult;
+    unsigned int arg1;
+    int result;
+    arg1 = (unsigned int)jarg1;
+    result = (int)zts_set_tcp_mem_limit(arg1);
+    jresult = result;
+    return jresult;
+}
+
+SWIGEXPORT int SWIGSTDCALL CSharp_zts_get_tcp_mem_usage()
+{
+    int jresult;
+    int result;
+    result = (int)zts_get_tcp_mem_usage();
+    jresult = result;
+    return jresult;
+}
+
+SWIGEXPORT int SWIGSTDCALL CSharp_zts_set_congestion_control(int jarg1, int jarg2)
+{
+    int jresult;
+    int arg1;
+    int arg2;
+    int result;
+    arg1 = (int)jarg1;
+    arg2 = (int)jarg2;
+    result = (int)zts_set_congestion_control(arg1, arg2);
+    jresult = result;
+    return jresult;
+}
+
+SWIGEXPORT int SWIGSTDCALL CSharp_zts_get_congestion_control(int jarg1)
+{
+    int jresult;
+    int arg1;
+    int result;
+    arg1 = (int)jarg1;
+    result = (int)zts_get_congestion_control(arg1);
+    jresult = result;
+    return jresult;
+}
+
 SWIGEXPORT void* SWIGSTDCALL CSharp_zts_bsd_gethostbyname(char* jarg1)
 {
     void* jresult;
@@ -203,6 +203,11 @@ public class Constants {
     public static readonly short TCP_KEEPIDLE = 0x0003;
     public static readonly short TCP_KEEPINTVL = 0x0004;
     public static readonly short TCP_KEEPCNT = 0x0005;
+    public static readonly short TCP_INFO = 0x000b;
+    public static readonly short TCP_CONGESTION = 0x000d;
+    public static readonly int TCP_CC_NEWRENO = 0;
+    public static readonly int TCP_CC_CUBIC = 1;
+    public static readonly int TCP_CC_BBR = 2;
     // IPPROTO_IPV6 options
     public static readonly short IPV6_CHECKSUM =
         0x0007;   // RFC3542: calculate and insert the ICMPv6 checksum for raw sockets.
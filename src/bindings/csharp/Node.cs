@@ -101,6 +101,11 @@ namespace ZeroTier.Core
             return res;
         }
 
+        public int InitSetMaxSockets(UInt32 maxSockets)
+        {
+            return zts_init_set_max_sockets(maxSockets);
+        }
+
         public int InitSetRandomPortRange(UInt16 startPort, UInt16 endPort)
         {
             return zts_init_set_random_port_range(startPort, endPort);
@@ -626,6 +631,9 @@ namespace ZeroTier.Core
         [DllImport("libzt", EntryPoint = "CSharp_zts_init_set_port")]
         static extern int zts_init_set_port(ushort arg1);
 
+        [DllImport("libzt", EntryPoint = "CSharp_zts_init_set_max_sockets")]
+        static extern int zts_init_set_max_sockets(uint arg1);
+
         [DllImport("libzt", EntryPoint = "CSharp_zts_init_set_random_port_range")]
         static extern int zts_init_set_random_port_range(ushort arg1, ushort arg2);
 
@@ -449,6 +449,37 @@ namespace ZeroTier.Sockets
             }
         }
 
+        /// <summary>Snapshot of the internal state of the TCP connection (TCP_INFO)</summary>
+        public TcpInfo GetTcpInfo()
+        {
+            if (_isClosed) {
+                throw new ObjectDisposedException("Socket has been closed");
+            }
+            IntPtr infoPtr = Marshal.AllocHGlobal(Marshal.SizeOf(typeof(TcpInfo)));
+            int err = zts_get_tcp_info(_fd, infoPtr);
+            if (err < 0) {
+                Marshal.FreeHGlobal(infoPtr);
+                throw new ZeroTier.Sockets.SocketException(err, ZeroTier.Core.Node.ErrNo);
+            }
+            TcpInfo info = (TcpInfo)Marshal.PtrToStructure(infoPtr, typeof(TcpInfo));
+            Marshal.FreeHGlobal(infoPtr);
+            return info;
+        }
+
+        /// <summary>Congestion control algorithm (Constants.TCP_CC_*)</summary>
+        public int CongestionControl
+        {
+            get {
+                return zts_get_congestion_control(_fd);
+            }
+            set {
+                int err = zts_set_congestion_control(_fd, value);
+                if (err < 0) {
+                    throw new ZeroTier.Sockets.SocketException(err, ZeroTier.Core.Node.ErrNo);
+                }
+            }
+        }
+
         public bool Connected
         {
             get {
@@ -679,6 +710,15 @@ namespace ZeroTier.Sockets
         [DllImport("libzt", EntryPoint = "CSharp_zts_get_keepalive")]
         static extern int zts_get_keepalive(int fd);
 
+        [DllImport("libzt", EntryPoint = "CSharp_zts_get_tcp_info")]
+        static extern int zts_get_tcp_info(int fd, IntPtr info);
+
+        [DllImport("libzt", EntryPoint = "CSharp_zts_set_congestion_control")]
+        static extern int zts_set_congestion_control(int fd, int algorithm);
+
+        [DllImport("libzt", EntryPoint = "CSharp_zts_get_congestion_control")]
+        static extern int zts_get_congestion_control(int fd);
+
         [DllImport("libzt", EntryPoint = "CSharp_zts_add_dns_nameserver")]
         static extern int zts_add_dns_nameserver(IntPtr arg1);
 
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+using System.Runtime.InteropServices;
+
+namespace ZeroTier.Sockets
+{
+    /// <summary>
+    /// Snapshot of the internal state of a TCP connection. Layout matches
+    /// zts_tcp_info_t. Times are in milliseconds, windows and buffers in bytes.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct TcpInfo {
+        /// <summary>lwIP TCP state (4 = ESTABLISHED)</summary>
+        public uint State;
+        /// <summary>Maximum segment size used for sending</summary>
+        public uint Mss;
+        /// <summary>Smoothed round-trip time estimate</summary>
+        public uint SrttMs;
+        /// <summary>Round-trip time variance estimate</summary>
+        public uint RttvarMs;
+        /// <summary>Current retransmission timeout</summary>
+        public uint RtoMs;
+        /// <summary>Congestion window</summary>
+        public uint Cwnd;
+        /// <summary>Slow start threshold</summary>
+        public uint Ssthresh;
+        /// <summary>Send window most recently advertised by the remote host</summary>
+        public uint SndWnd;
+        /// <summary>Largest send window ever advertised by the remote host</summary>
+        public uint SndWndMax;
+        /// <summary>Receive window currently available</summary>
+        public uint RcvWnd;
+        /// <summary>Receive window most recently announced to the remote host</summary>
+        public uint RcvAnnWnd;
+        /// <summary>Window scale factor applied to the send window</summary>
+        public uint SndWscale;
+        /// <summary>Window scale factor applied to the receive window</summary>
+        public uint RcvWscale;
+        /// <summary>Available space in the send buffer</summary>
+        public uint SndBuf;
+        /// <summary>Number of pbufs currently queued for sending</summary>
+        public uint SndQueuelen;
+        /// <summary>Bytes sent but not yet acknowledged</summary>
+        public uint BytesInFlight;
+        /// <summary>Bytes queued but not yet sent</summary>
+        public uint BytesUnsent;
+        /// <summary>Consecutive retransmissions of the oldest unacknowledged segment</summary>
+        public uint Retransmits;
+        /// <summary>Duplicate ACKs received for the current lastack</summary>
+        public uint DupAcks;
+        /// <summary>Out-of-order segments held in the reassembly queue</summary>
+        public uint OoseqSegs;
+        /// <summary>Bytes held in the reassembly queue</summary>
+        public uint OoseqBytes;
+        /// <summary>1 if the connection is currently in fast recovery</summary>
+        public uint InFastRecovery;
+        /// <summary>Autotuned upper bound of the receive window</summary>
+        public uint RcvWndLimit;
+        /// <summary>Autotuned size of the send buffer</summary>
+        public uint SndBufLimit;
+    }
+}
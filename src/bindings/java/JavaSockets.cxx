@@ -526,6 +526,12 @@ Java_com_zerotier_sockets_ZeroTierNative_zts_1init_1set_1port(JNIEnv* jenv, jcla
     return zts_init_set_port(port);
 }
 
+JNIEXPORT jint JNICALL
+Java_com_zerotier_sockets_ZeroTierNative_zts_1init_1set_1max_1sockets(JNIEnv* jenv, jclass clazz, jint max_sockets)
+{
+    return zts_init_set_max_sockets(max_sockets);
+}
+
 JNIEXPORT jint JNICALL
 Java_com_zerotier_sockets_ZeroTierNative_zts_1init_1from_1memory(JNIEnv* jenv, jobject thisObj, char* key, int len)
 {
@@ -967,6 +973,68 @@ Java_com_zerotier_sockets_ZeroTierNative_zts_1get_1keepalive(JNIEnv* jenv, jclas
     return zts_get_keepalive(fd);
 }
 
+JNIEXPORT jint JNICALL
+Java_com_zerotier_sockets_ZeroTierNative_zts_1set_1tcp_1mem_1limit(JNIEnv* jenv, jclass clazz, jint max_bytes)
+{
+    return zts_set_tcp_mem_limit(max_bytes);
+}
+
+JNIEXPORT jint JNICALL Java_com_zerotier_sockets_ZeroTierNative_zts_1get_1tcp_1mem_1usage(JNIEnv* jenv, jclass clazz)
+{
+    return zts_get_tcp_mem_usage();
+}
+
+JNIEXPORT jint JNICALL
+Java_com_zerotier_sockets_ZeroTierNative_zts_1set_1congestion_1control(JNIEnv* jenv, jclass clazz, jint fd, jint algorithm)
+{
+    return zts_set_congestion_control(fd, algorithm);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_zerotier_sockets_ZeroTierNative_zts_1get_1congestion_1control(JNIEnv* jenv, jclass clazz, jint fd)
+{
+    return zts_get_congestion_control(fd);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_zerotier_sockets_ZeroTierNative_zts_1get_1tcp_1info(JNIEnv* jenv, jclass clazz, jint fd, jobject info)
+{
+    zts_tcp_info_t ti;
+    int retval = zts_get_tcp_info(fd, &ti);
+    if (retval != ZTS_ERR_OK) {
+        return retval;
+    }
+    jclass c = jenv->GetObjectClass(info);
+    if (! c) {
+        return ZTS_ERR_ARG;
+    }
+    jenv->SetIntField(info, jenv->GetFieldID(c, "state", "I"), ti.state);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "mss", "I"), ti.mss);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "srttMs", "I"), ti.srtt_ms);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "rttvarMs", "I"), ti.rttvar_ms);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "rtoMs", "I"), ti.rto_ms);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "cwnd", "I"), ti.cwnd);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "ssthresh", "I"), ti.ssthresh);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "sndWnd", "I"), ti.snd_wnd);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "sndWndMax", "I"), ti.snd_wnd_max);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "rcvWnd", "I"), ti.rcv_wnd);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "rcvAnnWnd", "I"), ti.rcv_ann_wnd);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "sndWscale", "I"), ti.snd_wscale);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "rcvWscale", "I"), ti.rcv_wscale);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "sndBuf", "I"), ti.snd_buf);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "sndQueuelen", "I"), ti.snd_queuelen);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "bytesInFlight", "I"), ti.bytes_in_flight);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "bytesUnsent", "I"), ti.bytes_unsent);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "retransmits", "I"), ti.retransmits);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "dupacks", "I"), ti.dupacks);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "ooseqSegs", "I"), ti.ooseq_segs);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "ooseqBytes", "I"), ti.ooseq_bytes);
+    jenv->SetBooleanField(info, jenv->GetFieldID(c, "inFastRecovery", "Z"), ti.in_fast_recovery != 0);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "rcvWndLimit", "I"), ti.rcv_wnd_limit);
+    jenv->SetIntField(info, jenv->GetFieldID(c, "sndBufLimit", "I"), ti.snd_buf_limit);
+    return ZTS_ERR_OK;
+}
+
 struct hostent*
 Java_com_zerotier_sockets_ZeroTierNative_zts_1bsd_1gethostbyname(JNIEnv* jenv, jobject thisObj, jstring name)
 {
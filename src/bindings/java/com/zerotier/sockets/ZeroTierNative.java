@@ -250,6 +250,11 @@ public class ZeroTierNative {
     public static int ZTS_TCP_KEEPIDLE = 0x00000003;
     public static int ZTS_TCP_KEEPINTVL = 0x00000004;
     public static int ZTS_TCP_KEEPCNT = 0x00000005;
+    public static int ZTS_TCP_INFO = 0x0000000b;
+    public static int ZTS_TCP_CONGESTION = 0x0000000d;
+    public static int ZTS_TCP_CC_NEWRENO = 0;
+    public static int ZTS_TCP_CC_CUBIC = 1;
+    public static int ZTS_TCP_CC_BBR = 2;
 
     //----------------------------------------------------------------------------//
     // Error codes                                                                //
@@ -425,6 +430,7 @@ public class ZeroTierNative {
     public static native int zts_init_from_storage(String path);
     public static native int zts_init_set_event_handler(ZeroTierEventListener callbackClass);
     public static native int zts_init_set_port(short port);
+    public static native int zts_init_set_max_sockets(int max_sockets);
     // public static native int zts_init_from_memory(/*const*/ char* key,  int len);
     public static native int zts_init_blacklist_if(/*const*/ String prefix, int len);
     // public static native int zts_init_set_roots(/*const*/ void* roots_data,  int len);
@@ -486,6 +492,11 @@ public class ZeroTierNative {
     public static native int zts_get_blocking(int fd);
     public static native int zts_set_keepalive(int fd, int enabled);
     public static native int zts_get_keepalive(int fd);
+    public static native int zts_get_tcp_info(int fd, ZeroTierTcpInfo info);
+    public static native int zts_set_congestion_control(int fd, int algorithm);
+    public static native int zts_set_tcp_mem_limit(int max_bytes);
+    public static native int zts_get_tcp_mem_usage();
+    public static native int zts_get_congestion_control(int fd);
     // struct hostent* gethostbyname(/*const*/ String name);
     // public static native int zts_dns_set_server(uint8_t index, /*const*/ ip_addr* addr);
     // ip_addr* dns_get_server(uint8_t index);
@@ -125,6 +125,20 @@ public class ZeroTierNode {
         return ZeroTierNative.zts_init_set_port(port);
     }
 
+    /**
+     * (Optional) Set the maximum number of sockets that can be open at any
+     * one time. Note that this is an initialization method that can only be
+     * called before {@code start()}.
+     *
+     * @param maxSockets Number of sockets
+     *
+     * @return return
+     */
+    public int initSetMaxSockets(int maxSockets)
+    {
+        return ZeroTierNative.zts_init_set_max_sockets(maxSockets);
+    }
+
     /**
      * (Optional) Set the event handler function. Note that this is an
      * initialization method that can only be called before {@code start()}.
@@ -267,6 +267,55 @@ public class ZeroTierSocket {
         return ZeroTierNative.zts_get_keepalive(_zfd) == 1;
     }
 
+    /**
+     * Return a snapshot of the internal state of the TCP connection (TCP_INFO)
+     * @return RTT/RTO estimates, windows, bytes in flight and loss counters
+     * @exception SocketException when an error occurs in the native socket layer
+     */
+    public ZeroTierTcpInfo getTcpInfo() throws SocketException
+    {
+        if (_isClosed) {
+            throw new SocketException("Error: ZeroTierSocket is closed");
+        }
+        ZeroTierTcpInfo info = new ZeroTierTcpInfo();
+        if (ZeroTierNative.zts_get_tcp_info(_zfd, info) != ZeroTierNative.ZTS_ERR_OK) {
+            throw new SocketException("Error: Could not get TCP_INFO");
+        }
+        return info;
+    }
+
+    /**
+     * Select the congestion control algorithm (ZTS_TCP_CC_NEWRENO, ZTS_TCP_CC_CUBIC or ZTS_TCP_CC_BBR)
+     * @param algorithm Congestion control algorithm
+     * @exception SocketException when an error occurs in the native socket layer
+     */
+    public void setCongestionControl(int algorithm) throws SocketException
+    {
+        if (_isClosed) {
+            throw new SocketException("Error: ZeroTierSocket is closed");
+        }
+        if (ZeroTierNative.zts_set_congestion_control(_zfd, algorithm) != ZeroTierNative.ZTS_ERR_OK) {
+            throw new SocketException("Error: Could not set TCP_CONGESTION");
+        }
+    }
+
+    /**
+     * Return the congestion control algorithm
+     * @return ZTS_TCP_CC_NEWRENO, ZTS_TCP_CC_CUBIC or ZTS_TCP_CC_BBR
+     * @exception SocketException when an error occurs in the native socket layer
+     */
+    public int getCongestionControl() throws SocketException
+    {
+        if (_isClosed) {
+            throw new SocketException("Error: ZeroTierSocket is closed");
+        }
+        int algorithm = ZeroTierNative.zts_get_congestion_control(_zfd);
+        if (algorithm < 0) {
+            throw new SocketException("Error: Could not get TCP_CONGESTION");
+        }
+        return algorithm;
+    }
+
     /**
      * Get the local port to which this ZeroTierSocket is bound
      * @return Local port
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+package com.zerotier.sockets;
+
+import com.zerotier.sockets.*;
+
+/**
+ * This class encapsulates a snapshot of the internal state of a TCP connection.
+ * Times are in milliseconds, windows and buffers in bytes.
+ */
+public class ZeroTierTcpInfo {
+    /**
+     * lwIP TCP state (4 = ESTABLISHED)
+     */
+    public int state;
+
+    /**
+     * Maximum segment size used for sending
+     */
+    public int mss;
+
+    /**
+     * Smoothed round-trip time estimate
+     */
+    public int srttMs;
+
+    /**
+     * Round-trip time variance estimate
+     */
+    public int rttvarMs;
+
+    /**
+     * Current retransmission timeout
+     */
+    public int rtoMs;
+
+    /**
+     * Congestion window
+     */
+    public int cwnd;
+
+    /**
+     * Slow start threshold
+     */
+    public int ssthresh;
+
+    /**
+     * Send window most recently advertised by the remote host
+     */
+    public int sndWnd;
+
+    /**
+     * Largest send window ever advertised by the remote host
+     */
+    public int sndWndMax;
+
+    /**
+     * Receive window currently available
+     */
+    public int rcvWnd;
+
+    /**
+     * Receive window most recently announced to the remote host
+     */
+    public int rcvAnnWnd;
+
+    /**
+     * Window scale factor applied to the send window
+     */
+    public int sndWscale;
+
+    /**
+     * Window scale factor applied to the receive window
+     */
+    public int rcvWscale;
+
+    /**
+     * Available space in the send buffer
+     */
+    public int sndBuf;
+
+    /**
+     * Number of pbufs currently queued for sending
+     */
+    public int sndQueuelen;
+
+    /**
+     * Bytes sent but not yet acknowledged
+     */
+    public int bytesInFlight;
+
+    /**
+     * Bytes queued but not yet sent
+     */
+    public int bytesUnsent;
+
+    /**
+     * Number of consecutive retransmissions of the oldest unacknowledged segment
+     */
+    public int retransmits;
+
+    /**
+     * Number of duplicate ACKs received for the current lastack
+     */
+    public int dupacks;
+
+    /**
+     * Number of out-of-order segments held in the reassembly queue
+     */
+    public int ooseqSegs;
+
+    /**
+     * Number of bytes held in the reassembly queue
+     */
+    public int ooseqBytes;
+
+    /**
+     * Whether the connection is currently in fast recovery
+     */
+    public boolean inFastRecovery;
+
+    /**
+     * Autotuned upper bound of the receive window
+     */
+    public int rcvWndLimit;
+
+    /**
+     * Autotuned size of the send buffer
+     */
+    public int sndBufLimit;
+}
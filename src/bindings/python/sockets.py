@@ -430,6 +430,35 @@ class socket:
         """Get a socket option value"""
         return libzt.zts_py_getsockopt(self._fd, (level, optname))
 
+    def get_tcp_info(self):
+        """Return a snapshot of the TCP connection's internal state
+
+        :return: RTT/RTO estimates, windows, bytes in flight, retransmit,
+            duplicate-ACK and out-of-order counters
+        :rtype: libzt.zts_tcp_info_t
+        """
+        info = libzt.zts_tcp_info_t()
+        err = libzt.zts_get_tcp_info(self._fd, info)
+        if err < 0:
+            handle_error(err)
+        return info
+
+    def set_congestion_control(self, algorithm):
+        """Select the congestion control algorithm
+
+        :param algorithm: ZTS_TCP_CC_NEWRENO, ZTS_TCP_CC_CUBIC or ZTS_TCP_CC_BBR
+        """
+        err = libzt.zts_set_congestion_control(self._fd, algorithm)
+        if err < 0:
+            handle_error(err)
+
+    def get_congestion_control(self):
+        """Return the congestion control algorithm (ZTS_TCP_CC_*)"""
+        algorithm = libzt.zts_get_congestion_control(self._fd)
+        if algorithm < 0:
+            handle_error(algorithm)
+        return algorithm
+
     def ioctl(self, request, arg=0, mutate_flag=True):
         """Perform I/O control operations"""
         return libzt.zts_py_ioctl(self._fd, request, arg, mutate_flag)
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c)2013-2021 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2026-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+/**
+ * @file
+ *
+ * Prototypes of the lwIP hook functions implemented by libzt. This file is
+ * included by lwIP (see LWIP_HOOK_FILENAME in lwipopts.h) and must remain
+ * valid C.
+ */
+
+#ifndef ZTS_LWIP_HOOKS_H
+#define ZTS_LWIP_HOOKS_H
+
+#include "lwip/err.h"
+#include "lwip/opt.h"
+#include "lwip/sockets.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct lwip_sock;
+struct tcp_pcb;
+struct tcp_hdr;
+struct pbuf;
+
+/**
+ * Runs TIME_WAIT recycling (see TcpTimeWait.cpp), SYN cookies (see
+ * TcpSynCookies.cpp), PAWS and SACK recovery (see
+ * TcpRecovery.cpp), congestion control (see TcpCongestion.cpp) and buffer
+ * autotuning (see TcpAutotune.cpp) for every inbound TCP segment before lwIP
+ * processes it. lwIP has already converted the port, sequence, acknowledgement
+ * and window fields of `hdr` to host byte order.
+ *
+ * @return `ERR_OK`, or any other value to drop the segment
+ */
+err_t zts_lwip_hook_tcp_inpacket(
+    struct tcp_pcb* pcb,
+    struct tcp_hdr* hdr,
+    u16_t optlen,
+    u16_t opt1len,
+    u8_t* opt2,
+    struct pbuf* p);
+
+/**
+ * Reserves space for the checksum offload option (see VirtualTap.cpp) in the
+ * segments of a TCP handshake. `pcb` may be `NULL`.
+ *
+ * @return Length of all options of the segment
+ */
+u8_t zts_lwip_hook_tcp_out_tcpopt_length(const struct tcp_pcb* pcb, u8_t internal_len);
+
+/**
+ * Applies the autotuned receive window (see TcpAutotune.cpp) to every outgoing
+ * TCP segment and fills in the checksum offload option where space for it was
+ * reserved. Segments of a connection that will be fragmented get their
+ * checksum from lwIP. `pcb` is `NULL` for segments not belonging to a
+ * connection.
+ *
+ * @return End of the options written by libzt
+ */
+u32_t* zts_lwip_hook_tcp_out_add_tcpopts(struct pbuf* p, struct tcp_hdr* hdr, const struct tcp_pcb* pcb, u32_t* opts);
+
+/**
+ * Handles libzt-specific socket options (e.g. `ZTS_TCP_CONGESTION`) before
+ * lwIP's own setsockopt implementation. Called with the TCP/IP core lock held.
+ *
+ * @return `1` if the option was handled (result in `err`), otherwise `0`
+ */
+int zts_lwip_hook_setsockopt(
+    int s,
+    struct lwip_sock* sock,
+    int level,
+    int optname,
+    const void* optval,
+    socklen_t optlen,
+    int* err);
+
+/**
+ * Handles libzt-specific socket options (e.g. `ZTS_TCP_INFO`) before lwIP's
+ * own getsockopt implementation. Called with the TCP/IP core lock held.
+ *
+ * @return `1` if the option was handled (result in `err`), otherwise `0`
+ */
+int zts_lwip_hook_getsockopt(
+    int s,
+    struct lwip_sock* sock,
+    int level,
+    int optname,
+    void* optval,
+    socklen_t* optlen,
+    int* err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
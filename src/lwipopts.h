@@ -79,19 +79,39 @@
 #define LWIP_NETIF_LINK_CALLBACK        0
 #define LWIP_NETIF_REMOVE_CALLBACK      0
 #define LWIP_NETIF_LOOPBACK             1
+#define LWIP_CHECKSUM_CTRL_PER_NETIF    1   // See zts_netif_init4/6
+// hooks (implemented by libzt, see lwip_hooks.h)
+#define LWIP_HOOK_FILENAME              "lwip_hooks.h"
+#define LWIP_HOOK_SOCKETS_GETSOCKOPT(s, sock, level, optname, optval, optlen, err) \
+    zts_lwip_hook_getsockopt(s, sock, level, optname, optval, optlen, err)
+#define LWIP_HOOK_SOCKETS_SETSOCKOPT(s, sock, level, optname, optval, optlen, err) \
+    zts_lwip_hook_setsockopt(s, sock, level, optname, optval, optlen, err)
+#define LWIP_HOOK_TCP_INPACKET_PCB(pcb, hdr, optlen, opt1len, opt2, p) \
+    zts_lwip_hook_tcp_inpacket(pcb, hdr, optlen, opt1len, opt2, p)
+#define LWIP_HOOK_TCP_OUT_TCPOPT_LENGTH(pcb, internal_len) \
+    zts_lwip_hook_tcp_out_tcpopt_length(pcb, internal_len)
+#define LWIP_HOOK_TCP_OUT_ADD_TCPOPTS(p, hdr, pcb, opts) \
+    zts_lwip_hook_tcp_out_add_tcpopts(p, hdr, pcb, opts)
+// checksum (implemented by libzt, see Checksum.h)
+#include "Checksum.h"
+#define LWIP_CHKSUM                     zts_chksum
+#define LWIP_CHKSUM_COPY(dst, src, len) zts_chksum_copy(dst, src, len)
 
 /*------------------------------------------------------------------------------
 ------------------------------------ Presets -----------------------------------
 ------------------------------------------------------------------------------*/
 
-#define LWIP_MTU                        2800
-#define LWIP_CHKSUM_ALGORITHM           2
+#define LWIP_MTU                        10000   // ZT_MAX_MTU, netifs follow the network MTU (see setMtu())
 // memory
-#define MEMP_NUM_NETCONN                1024
+#define MEMP_NUM_NETCONN                16384   // Ceiling, see zts_init_set_max_sockets()
+#define MEMP_NUM_TCP_PCB                MEMP_NUM_NETCONN
+#define MEMP_NUM_UDP_PCB                MEMP_NUM_NETCONN
 #define MEMP_NUM_NETBUF                 2
 #define MEMP_NUM_TCPIP_MSG_API          1024
 #define MEMP_NUM_TCPIP_MSG_INPKT        1024
 #define PBUF_POOL_SIZE                  1024
+// Frames are received into PBUF_RAM, pool pbufs stay sized for the default MTU
+#define PBUF_POOL_BUFSIZE               LWIP_MEM_ALIGN_SIZE(2800 + PBUF_LINK_ENCAPSULATION_HLEN + PBUF_LINK_HLEN)
 #define TCP_DEFAULT_LISTEN_BACKLOG      0xff
 // arp
 #define ARP_TABLE_SIZE                  64
@@ -101,25 +121,35 @@
 // ip
 #define IP_REASS_MAXAGE                 15
 #define IP_REASS_MAX_PBUFS              32
+// multicast (memberships are mirrored to ZeroTier, see VirtualTap::multicastMembership())
+#define LWIP_IGMP                       1
+#define MEMP_NUM_IGMP_GROUP             64
+#define MEMP_NUM_MLD6_GROUP             64
+// dns (libzt's resolver, see Resolver.cpp, uses one timeout of its own)
+#define MEMP_NUM_SYS_TIMEOUT            (LWIP_NUM_SYS_TIMEOUT_INTERNAL + 1)
 // tcp
 #define TCP_TMR_INTERVAL                250
-#define TCP_WND                         0xffff0
+#define TCP_WND                         0xffff0   // Upper bound, see TcpAutotune.cpp
 #define TCP_MAXRTX                      12
 #define TCP_SYNMAXRTX                   12
-#define LWIP_TCP_SACK_OUT               1
+#define TCP_MSL                         30000UL   // 60 s TIME_WAIT, see TcpTimeWait.cpp
+#define LWIP_TCP_SACK_OUT               1   // SACK recovery, see TcpRecovery.cpp
+#define LWIP_TCP_TIMESTAMPS             1
 #define LWIP_TCP_MAX_SACK_NUM           4
 #define TCP_MSS                         (LWIP_MTU - 40)
-#define TCP_SND_BUF                     (64 * TCP_MSS)
+#define TCP_SND_BUF                     (256 * 2760)   // 256 segments at the default MTU, upper bound (see TcpAutotune.cpp)
 #define TCP_SND_QUEUELEN                (64 * (2 * (TCP_SND_BUF/TCP_MSS)))
 #define TCP_SNDLOWAT                    (0xffff - (4*TCP_MSS) - 1)
 #define TCP_SNDQUEUELOWAT               LWIP_MAX(((TCP_SND_QUEUELEN)/2), 5)
 #define TCP_WND_UPDATE_THRESHOLD        LWIP_MIN((TCP_WND / 4), (TCP_MSS * 4))
 #define LWIP_WND_SCALE                  1
 #define TCP_RCV_SCALE                   4
+#define LWIP_TCP_PCB_NUM_EXT_ARGS       3   // Congestion control, autotuning, SACK
 // tcpip
 #define TCPIP_MBOX_SIZE                 0
 #define LWIP_TCPIP_CORE_LOCKING         1
 #define LWIP_TCPIP_CORE_LOCKING_INPUT   1
+#define LWIP_TIMERS_CUSTOM              1   // Cyclic timers stop while idle, see Timers.cpp
 // netconn
 #define LWIP_NETCONN_FULLDUPLEX         0
 // netif
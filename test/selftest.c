@@ -15,7 +15,17 @@
 
 #define LIBZT_DEBUG 1
 
+#ifndef ZTS_DISABLE_CENTRAL_API
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "../src/Checksum.h"
+#include "../src/ChecksumOffload.h"
 #include "../src/Debug.hpp"
+#include "../src/ResolverParse.h"
 
 #pragma GCC diagnostic ignored "-Wunused-value"
 
@@ -819,6 +829,51 @@ void api_value_arg_test(int tid, uint8_t num, int8_t i8, int16_t i16, int32_t i3
             assert(zts_util_ipstr_to_saddr(i32, NULL, i32, null_addr, NULL) == ZTS_ERR_SERVICE);
             break;
             */
+        case 177:
+            assert(zts_get_tcp_info(i32, NULL) == ZTS_ERR_SERVICE);
+            break;
+        case 178:
+            assert(zts_set_congestion_control(i32, i32) == ZTS_ERR_SERVICE);
+            break;
+        case 179:
+            assert(zts_get_congestion_control(i32) == ZTS_ERR_SERVICE);
+            break;
+        case 180:
+            assert(zts_set_tcp_mem_limit(i32) == ZTS_ERR_SERVICE);
+            break;
+        case 181:
+            assert(zts_get_tcp_mem_usage() == ZTS_ERR_SERVICE);
+            break;
+        case 182:
+            assert(zts_getaddrinfo_async(NULL, i32, NULL, NULL) == ZTS_ERR_SERVICE);
+            break;
+        case 183:
+            assert(zts_core_query_snapshot(NULL, NULL, NULL) == ZTS_ERR_SERVICE);
+            break;
+        case 184:
+            assert(zts_net_set_tx_rate(i64, i64, i32) == ZTS_ERR_SERVICE);
+            break;
+        case 185:
+            assert(zts_net_set_tx_class_weight(i64, i32, i32) == ZTS_ERR_SERVICE);
+            break;
+        case 186:
+            assert(zts_net_get_tx_class_stats(i64, i32, NULL) == ZTS_ERR_SERVICE);
+            break;
+        case 187:
+            assert(zts_set_tx_class(i32, i32) == ZTS_ERR_SERVICE);
+            break;
+        case 188:
+            assert(zts_init_set_event_mask((uint64_t)i64 | 0x100) == ZTS_ERR_ARG);
+            break;
+        case 189:
+            assert(zts_event_disable((uint64_t)i64 | 0x100) != ZTS_ERR_OK);
+            break;
+        case 190:
+            assert(zts_init_set_event_queue_len(0) == ZTS_ERR_ARG);
+            break;
+        case 191:
+            assert(zts_event_get_stats(ZTS_EVENT_CLASS_ALL, NULL) != ZTS_ERR_OK);
+            break;
         default:
             break;
     }
@@ -1103,6 +1158,13 @@ void test_sockets()
 #define BUFLEN           128
 char* msg = "welcome to the machine";
 
+// Bulk transfer from client to server. A receiver that holds back ACKs for a
+// timer interval slows the sender down to a few segments per interval, which
+// takes far longer than this.
+#define BULK_LEN      (4 * 1024 * 1024)
+#define BULK_MAX_TIME 10   // s
+char bulkbuf[16384];
+
 void test_server_socket_usage(uint16_t port4, uint16_t port6)
 {
     int err = ZTS_ERR_OK;
@@ -1165,6 +1227,20 @@ void test_server_socket_usage(uint16_t port4, uint16_t port6)
     DEBUG_INFO("server4: wrote (%d) bytes", bytes_sent);
     assert(bytes_sent == msglen && zts_errno == 0);
 
+    // Receive bulk data
+
+    int bulk_read = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (bulk_read < BULK_LEN) {
+        int n = zts_bsd_read(acc4, bulkbuf, sizeof(bulkbuf));
+        assert(n > 0 && zts_errno == 0);
+        bulk_read += n;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    time_diff = (now.tv_sec - start.tv_sec);
+    DEBUG_INFO("server4: read (%d) bulk bytes in %d s", bulk_read, time_diff);
+    assert(bulk_read == BULK_LEN && time_diff < BULK_MAX_TIME);
+
     zts_bsd_close(s4);
     assert(err == ZTS_ERR_OK && zts_errno == 0);
 
@@ -1288,6 +1364,32 @@ void test_client_socket_usage(char* ip4, uint16_t port4, char* ip6, uint16_t por
     DEBUG_INFO("client4: read (%d) bytes", bytes_read);
     assert(bytes_sent == bytes_read && zts_errno == 0);
 
+    // Send bulk data
+    int bulk_sent = 0;
+    while (bulk_sent < BULK_LEN) {
+        int n = zts_bsd_write(s4, bulkbuf, sizeof(bulkbuf));
+        assert(n > 0 && zts_errno == 0);
+        bulk_sent += n;
+    }
+    DEBUG_INFO("client4: wrote (%d) bulk bytes", bulk_sent);
+
+    zts_tcp_info_t tcp_info;
+    assert(zts_get_tcp_info(s4, NULL) == ZTS_ERR_ARG);
+    assert(zts_get_tcp_info(s4, &tcp_info) == ZTS_ERR_OK);
+    DEBUG_INFO(
+        "client4: srtt=%d ms, rto=%d ms, cwnd=%d, in_flight=%d",
+        tcp_info.srtt_ms,
+        tcp_info.rto_ms,
+        tcp_info.cwnd,
+        tcp_info.bytes_in_flight);
+    assert(tcp_info.state == 4 && tcp_info.mss > 0 && tcp_info.cwnd > 0);
+    assert(tcp_info.rcv_wnd_limit > 0 && tcp_info.snd_buf_limit > 0);
+    assert(zts_get_tcp_mem_usage() >= (int)(tcp_info.rcv_wnd_limit + tcp_info.snd_buf_limit));
+    assert(zts_get_congestion_control(s4) == ZTS_TCP_CC_NEWRENO);
+    assert(zts_set_congestion_control(s4, -1) == ZTS_ERR_ARG);
+    assert(zts_set_congestion_control(s4, ZTS_TCP_CC_CUBIC) == ZTS_ERR_OK);
+    assert(zts_get_congestion_control(s4) == ZTS_TCP_CC_CUBIC);
+
     zts_bsd_close(s4);
     assert(err == ZTS_ERR_OK && zts_errno == 0);
 
@@ -1405,7 +1507,15 @@ int test_start_node(
     }
     if (use_callbacks) {
         assert(zts_init_set_event_handler(&on_zts_event) == ZTS_ERR_OK);
-    }
+        // Peer events are enabled once online
+        assert(zts_init_set_event_mask(ZTS_EVENT_CLASS_ALL + 1) == ZTS_ERR_ARG);
+        assert(zts_init_set_event_mask(ZTS_EVENT_CLASS_ALL & ~ZTS_EVENT_CLASS_PEER) == ZTS_ERR_OK);
+        assert(zts_init_set_event_queue_len(0) == ZTS_ERR_ARG);
+        assert(zts_init_set_event_queue_len(ZTS_EVENT_QUEUE_DEFAULT_LEN) == ZTS_ERR_OK);
+    }
+    assert(zts_init_set_max_sockets(0) == ZTS_ERR_ARG);
+    assert(zts_init_set_max_sockets(ZTS_MAX_SOCKETS + 1) == ZTS_ERR_ARG);
+    assert(zts_init_set_max_sockets(ZTS_MAX_SOCKETS) == ZTS_ERR_OK);
     if (use_identity) {
         // TODO: tomorrow
         assert(zts_init_from_memory(keypair, ZTS_ID_STR_BUF_LEN) == ZTS_ERR_OK);
@@ -1423,6 +1533,12 @@ int test_start_node(
         DEBUG_INFO("Node failed to come online");
         exit(-1);
     }
+    assert(zts_event_enable(ZTS_EVENT_CLASS_ALL + 1) == ZTS_ERR_ARG);
+    assert(zts_event_enable(ZTS_EVENT_CLASS_PEER) == ZTS_ERR_OK);
+    zts_event_stats_t ev_stats;
+    assert(zts_event_get_stats(ZTS_EVENT_CLASS_ALL, &ev_stats) == ZTS_ERR_ARG);
+    assert(zts_event_get_stats(ZTS_EVENT_CLASS_NODE, &ev_stats) == ZTS_ERR_OK);
+    assert(ev_stats.dropped == 0);
 
     // Test identity handling
     char keypair_i[ZTS_ID_STR_BUF_LEN] = { 0 };
@@ -1565,6 +1681,29 @@ int test_start_node(
 
         zts_core_lock_release();
 
+        // Test bulk snapshot of the same state
+
+        unsigned int snap_len = 0;
+        uint64_t snap_gen = 0;
+        assert(zts_core_query_snapshot(NULL, &snap_len, &snap_gen) == ZTS_ERR_ARG);
+        assert(snap_len >= sizeof(zts_snapshot_t) && snap_gen == 0);
+        snap_len += 4096;   // Room for peers found in between
+        void* snap_buf = malloc(snap_len);
+        assert(zts_core_query_snapshot(snap_buf, &snap_len, &snap_gen) == ZTS_ERR_OK);
+        zts_snapshot_t* snap = (zts_snapshot_t*)snap_buf;
+        assert(snap->generation == snap_gen && snap->net_count > 0);
+        for (unsigned int i = 0; i < snap->net_count; i++) {
+            zts_snapshot_net_t* net = &(snap->nets[i]);
+            assert(net->addr_first + net->addr_count <= snap->addr_count);
+            DEBUG_INFO("net = %llx, addr_count = %d, route_count = %d, mc_count = %d",
+                (unsigned long long)net->net_id, net->addr_count, net->route_count, net->mc_count);
+        }
+        DEBUG_INFO("peer_count = %d, path_count = %d", snap->peer_count, snap->path_count);
+        for (unsigned int i = 0; i < snap->peer_count; i++) {
+            assert(zts_core_query_path_count(snap->peers[i].peer_id) >= 0);
+        }
+        free(snap_buf);
+
     }   // join network
 
     if (! use_callbacks) {
@@ -1648,6 +1787,23 @@ void test_identity_key_handling()
     DEBUG_INFO("Checking validity of identity that is corrupted (should be false)");
     DEBUG_INFO("Identity = [%s]", keypair);
     assert(zts_id_pair_is_valid(keypair, ZTS_ID_STR_BUF_LEN) == 0);
+
+    // Test pre-generated keys
+
+    char keypair_pool[ZTS_ID_STR_BUF_LEN] = { 0 };
+    unsigned int keypair_pool_len = ZTS_ID_STR_BUF_LEN;
+    DEBUG_INFO("Taking identity from pool");
+    assert(zts_id_pool_take(keypair_pool, NULL) == ZTS_ERR_ARG);
+    assert(zts_id_pool_start(0) == ZTS_ERR_ARG);
+    assert(zts_id_pool_start(2) == ZTS_ERR_OK);
+    while (zts_id_pool_take(keypair_pool, &keypair_pool_len) == ZTS_ERR_NO_RESULT) {
+        zts_util_delay(50);
+    }
+    DEBUG_INFO("Identity = [%s]", keypair_pool);
+    assert(zts_id_pair_is_valid(keypair_pool, ZTS_ID_STR_BUF_LEN) == 1);
+    assert(zts_id_pool_stop() == ZTS_ERR_OK);
+    keypair_pool_len = ZTS_ID_STR_BUF_LEN;
+    assert(zts_id_pool_take(keypair_pool, &keypair_pool_len) == ZTS_ERR_NO_RESULT);
 }
 
 void test_addr_computation()
@@ -1826,6 +1982,14 @@ int test_stats()
         s.nd6_rx,
         s.nd6_drop,
         s.nd6_err);
+    printf("   tcp_time_wait=%9d,    tcp_time_wait_recycled=%9d\n", s.tcp_time_wait, s.tcp_time_wait_recycled);
+    printf(
+        "   tcp_listen_queued=%9d,    tcp_listen_overflows=%9d,    tcp_syncookies_sent=%9d,    "
+        "tcp_syncookies_accepted=%9d\n",
+        s.tcp_listen_queued,
+        s.tcp_listen_overflows,
+        s.tcp_syncookies_sent,
+        s.tcp_syncookies_accepted);
     return 0;
 }
 
@@ -1870,6 +2034,586 @@ int test_utils()
     return 0;
 }
 
+int test_chksum()
+{
+    DEBUG_INFO("\n\n***\ttest_chksum (kernel: %s)", zts_chksum_kernel());
+
+    uint8_t src[4096 + 64], dst[4096 + 64];
+    for (int i = 0; i < sizeof(src); i++) {
+        src[i] = (uint8_t)random32();
+    }
+    // Example from RFC 1071, section 3: the sum is 0xddf2 in network byte order
+    uint8_t rfc[] = { 0x00, 0x01, 0xf2, 0x03, 0xf4, 0xf5, 0xf6, 0xf7 };
+    uint16_t rfc_sum = zts_chksum(rfc, sizeof(rfc));
+    assert(((uint8_t*)&rfc_sum)[0] == 0xdd && ((uint8_t*)&rfc_sum)[1] == 0xf2);
+    // All lengths and alignments, against the portable kernel
+    for (int len = 0; len <= 4096; len += (len < 300 ? 1 : 97)) {
+        int off = random32() & 63;
+        uint16_t sum = zts_chksum_generic(src + off, len);
+        assert(zts_chksum(src + off, len) == sum);
+        memset(dst, 0, sizeof(dst));
+        assert(zts_chksum_copy(dst + (off ^ 1), src + off, len) == sum);
+        assert(memcmp(dst + (off ^ 1), src + off, len) == 0);
+    }
+    // Carries are folded back in
+    memset(src, 0xff, sizeof(src));
+    assert(zts_chksum(src, sizeof(src)) == 0xffff);
+    return 0;
+}
+
+//----------------------------------------------------------------------------//
+// DNS response parsing                                                       //
+//----------------------------------------------------------------------------//
+
+#define DNS_ID    0x1234
+#define DNS_A     1
+#define DNS_CNAME 5
+#define DNS_SOA   6
+
+typedef struct {
+    uint8_t b[512];
+    unsigned int len;
+} dns_msg_t;
+
+void dns_put16(dns_msg_t* m, uint16_t v)
+{
+    m->b[m->len++] = v >> 8;
+    m->b[m->len++] = v & 0xff;
+}
+
+void dns_put32(dns_msg_t* m, uint32_t v)
+{
+    dns_put16(m, v >> 16);
+    dns_put16(m, v & 0xffff);
+}
+
+// Uncompressed, unless `ptr` is non-zero: then `name` is followed by a pointer
+void dns_put_name(dns_msg_t* m, const char* name, uint16_t ptr)
+{
+    while (*name) {
+        const char* dot = strchr(name, '.');
+        int l = dot ? dot - name : strlen(name);
+        m->b[m->len++] = l;
+        memcpy(m->b + m->len, name, l);
+        m->len += l;
+        name += dot ? l + 1 : l;
+    }
+    if (ptr) {
+        dns_put16(m, 0xc000 | ptr);
+    }
+    else {
+        m->b[m->len++] = 0;
+    }
+}
+
+// Header and question for `name` (type A) at offset 12
+void dns_begin(dns_msg_t* m, uint16_t id, uint16_t flags, uint16_t ancount, uint16_t nscount, const char* name)
+{
+    m->len = 0;
+    dns_put16(m, id);
+    dns_put16(m, flags);
+    dns_put16(m, 1);
+    dns_put16(m, ancount);
+    dns_put16(m, nscount);
+    dns_put16(m, 0);
+    dns_put_name(m, name, 0);
+    dns_put16(m, DNS_A);
+    dns_put16(m, 1);
+}
+
+// Record with the owner written by the caller, rdata to follow
+void dns_put_rr(dns_msg_t* m, uint16_t type, uint32_t ttl, uint16_t rdlength)
+{
+    dns_put16(m, type);
+    dns_put16(m, 1);
+    dns_put32(m, ttl);
+    dns_put16(m, rdlength);
+}
+
+void dns_put_a(dns_msg_t* m, uint32_t ttl, uint8_t last)
+{
+    dns_put_rr(m, DNS_A, ttl, 4);
+    uint8_t a[4] = { 10, 0, 0, last };
+    memcpy(m->b + m->len, a, 4);
+    m->len += 4;
+}
+
+void dns_put_soa(dns_msg_t* m, uint32_t ttl, uint32_t minimum)
+{
+    dns_put16(m, 0xc000 | 12);
+    dns_put_rr(m, DNS_SOA, ttl, 2 + 2 + 20);
+    dns_put16(m, 0xc000 | 12);   // MNAME
+    dns_put16(m, 0xc000 | 12);   // RNAME
+    for (int i = 0; i < 4; i++) {
+        dns_put32(m, 1);   // SERIAL, REFRESH, RETRY, EXPIRE
+    }
+    dns_put32(m, minimum);
+}
+
+int dns_parse(dns_msg_t* m, const char* name, int* err, uint32_t* ttl, unsigned int* count, uint8_t* last)
+{
+    struct zts_sockaddr_storage addrs[4];
+    *count = 4;
+    int res = zts_dns_parse(DNS_ID, name, DNS_A, m->b, m->len, err, addrs, count, ttl);
+    if (*count > 0) {
+        struct zts_sockaddr_in* in4 = (struct zts_sockaddr_in*)&addrs[0];
+        assert(in4->sin_family == ZTS_AF_INET);
+        *last = ((uint8_t*)&in4->sin_addr.s_addr)[3];
+    }
+    return res;
+}
+
+int test_dns_parse()
+{
+    DEBUG_INFO("\n\n***\ttest_dns_parse");
+    dns_msg_t m;
+    int err;
+    uint32_t ttl;
+    unsigned int count;
+    uint8_t last = 0;
+
+    // Answer owned by a compression pointer to the question
+    dns_begin(&m, DNS_ID, 0x8180, 1, 0, "www.example.com");
+    dns_put16(&m, 0xc000 | 12);
+    dns_put_a(&m, 300, 1);
+    assert(dns_parse(&m, "www.example.com", &err, &ttl, &count, &last) == ZTS_DNS_PARSE_DONE);
+    assert(err == ZTS_ERR_OK && count == 1 && last == 1 && ttl == 300);
+    // Names compare in lower case
+    m.b[13] = 'W';
+    assert(dns_parse(&m, "www.example.com", &err, &ttl, &count, &last) == ZTS_DNS_PARSE_DONE && count == 1);
+
+    // Not ours: other ID, other question, not a response
+    assert(zts_dns_parse(DNS_ID + 1, "www.example.com", DNS_A, m.b, m.len, &err, NULL, &count, &ttl)
+           == ZTS_DNS_PARSE_IGNORE);
+    assert(dns_parse(&m, "www.example.org", &err, &ttl, &count, &last) == ZTS_DNS_PARSE_IGNORE);
+    assert(zts_dns_parse(DNS_ID, "www.example.com", 28, m.b, m.len, &err, NULL, &count, &ttl)
+           == ZTS_DNS_PARSE_IGNORE);
+    m.b[2] &= ~0x80;
+    assert(dns_parse(&m, "www.example.com", &err, &ttl, &count, &last) == ZTS_DNS_PARSE_IGNORE);
+    m.len = 11;
+    assert(dns_parse(&m, "www.example.com", &err, &ttl, &count, &last) == ZTS_DNS_PARSE_IGNORE);
+
+    // Pointers to themselves, forwards or past the end are malformed
+    for (int i = 0; i < 3; i++) {
+        dns_begin(&m, DNS_ID, 0x8180, 1, 0, "www.example.com");
+        uint16_t at = m.len;
+        uint16_t targets[] = { at, at + 2, 0x3fff };
+        dns_put16(&m, 0xc000 | targets[i]);
+        dns_put_a(&m, 300, 1);
+        assert(dns_parse(&m, "www.example.com", &err, &ttl, &count, &last) == ZTS_DNS_PARSE_RETRY);
+    }
+    // A loop through two names
+    dns_begin(&m, DNS_ID, 0x8180, 2, 0, "www.example.com");
+    uint16_t first = m.len;
+    dns_put_name(&m, "a", first + 4 + 10 + 4);
+    dns_put_a(&m, 300, 1);
+    dns_put_name(&m, "b", first);
+    dns_put_a(&m, 300, 2);
+    assert(dns_parse(&m, "www.example.com", &err, &ttl, &count, &last) == ZTS_DNS_PARSE_RETRY);
+
+    // CNAME chain, with the smallest TTL along the way, and an unrelated A
+    dns_begin(&m, DNS_ID, 0x8180, 4, 0, "www.example.com");
+    dns_put_name(&m, "other", 16);   // 16: example.com in the question
+    dns_put_a(&m, 30, 9);
+    dns_put16(&m, 0xc000 | 12);
+    dns_put_rr(&m, DNS_CNAME, 200, 4);
+    uint16_t a_name = m.len;
+    dns_put_name(&m, "a", 16);
+    dns_put16(&m, 0xc000 | a_name);
+    dns_put_rr(&m, DNS_CNAME, 100, 4);
+    uint16_t b_name = m.len;
+    dns_put_name(&m, "b", 16);
+    dns_put16(&m, 0xc000 | b_name);
+    dns_put_a(&m, 300, 3);
+    assert(dns_parse(&m, "www.example.com", &err, &ttl, &count, &last) == ZTS_DNS_PARSE_DONE);
+    assert(err == ZTS_ERR_OK && count == 1 && last == 3 && ttl == 100);
+    // A chain that loops ends without addresses
+    dns_begin(&m, DNS_ID, 0x8180, 2, 0, "www.example.com");
+    dns_put16(&m, 0xc000 | 12);
+    dns_put_rr(&m, DNS_CNAME, 200, 4);
+    a_name = m.len;
+    dns_put_name(&m, "a", 16);
+    dns_put16(&m, 0xc000 | a_name);
+    dns_put_rr(&m, DNS_CNAME, 200, 2);
+    dns_put16(&m, 0xc000 | 12);
+    assert(dns_parse(&m, "www.example.com", &err, &ttl, &count, &last) == ZTS_DNS_PARSE_DONE);
+    assert(err == ZTS_ERR_NO_RESULT && count == 0);
+
+    // Negative answers last as long as the SOA says, within bounds
+    dns_begin(&m, DNS_ID, 0x8183, 0, 1, "nx.example.com");
+    dns_put_soa(&m, 900, 300);
+    assert(dns_parse(&m, "nx.example.com", &err, &ttl, &count, &last) == ZTS_DNS_PARSE_DONE);
+    assert(err == ZTS_ERR_NO_RESULT && count == 0 && ttl == 300);
+    dns_begin(&m, DNS_ID, 0x8180, 0, 1, "nx.example.com");
+    dns_put_soa(&m, 120, 300);
+    assert(dns_parse(&m, "nx.example.com", &err, &ttl, &count, &last) == ZTS_DNS_PARSE_DONE);
+    assert(err == ZTS_ERR_NO_RESULT && ttl == 120);
+    dns_begin(&m, DNS_ID, 0x8183, 0, 1, "nx.example.com");
+    dns_put_soa(&m, 86400, 86400);
+    assert(dns_parse(&m, "nx.example.com", &err, &ttl, &count, &last) == ZTS_DNS_PARSE_DONE);
+    assert(err == ZTS_ERR_NO_RESULT && ttl == 3600);   // ZTS_DNS_MAX_NEGATIVE_TTL
+    dns_begin(&m, DNS_ID, 0x8183, 0, 0, "nx.example.com");
+    assert(dns_parse(&m, "nx.example.com", &err, &ttl, &count, &last) == ZTS_DNS_PARSE_DONE);
+    assert(err == ZTS_ERR_NO_RESULT && ttl == 60);   // ZTS_DNS_NEGATIVE_TTL
+
+    // Truncated: complete records are used, otherwise ask again
+    dns_begin(&m, DNS_ID, 0x8380, 2, 0, "www.example.com");
+    dns_put16(&m, 0xc000 | 12);
+    dns_put_a(&m, 300, 4);
+    dns_put16(&m, 0xc000 | 12);
+    dns_put_a(&m, 300, 5);
+    m.len -= 3;
+    assert(dns_parse(&m, "www.example.com", &err, &ttl, &count, &last) == ZTS_DNS_PARSE_DONE);
+    assert(err == ZTS_ERR_OK && count == 1 && last == 4);
+    dns_begin(&m, DNS_ID, 0x8380, 1, 0, "www.example.com");
+    assert(dns_parse(&m, "www.example.com", &err, &ttl, &count, &last) == ZTS_DNS_PARSE_RETRY);
+    // Without TC, a cut-off record is malformed
+    dns_begin(&m, DNS_ID, 0x8180, 1, 0, "www.example.com");
+    dns_put16(&m, 0xc000 | 12);
+    dns_put_a(&m, 300, 4);
+    m.len -= 1;
+    assert(dns_parse(&m, "www.example.com", &err, &ttl, &count, &last) == ZTS_DNS_PARSE_RETRY);
+
+    // Server failure
+    dns_begin(&m, DNS_ID, 0x8182, 0, 0, "www.example.com");
+    assert(dns_parse(&m, "www.example.com", &err, &ttl, &count, &last) == ZTS_DNS_PARSE_RETRY);
+    return 0;
+}
+
+//----------------------------------------------------------------------------//
+// Checksum offload                                                           //
+//----------------------------------------------------------------------------//
+
+/**
+ * One's complement sum of a TCP segment in an IPv4 packet (header without
+ * options) and its pseudo header
+ */
+uint16_t tcp4_sum(const uint8_t* seg, int tcp_len, const uint8_t* ip)
+{
+    uint8_t pseudo[12] = { 0 };
+    memcpy(pseudo, ip + 12, 8);
+    pseudo[9] = 6;
+    pseudo[10] = (uint8_t)(tcp_len >> 8);
+    pseudo[11] = (uint8_t)tcp_len;
+    uint32_t sum = (uint32_t)zts_chksum(pseudo, sizeof(pseudo)) + zts_chksum(seg, tcp_len);
+    sum = (sum & 0xffff) + (sum >> 16);
+    return (uint16_t)sum;
+}
+
+void ip4_header(uint8_t* ip, int len, uint16_t frag)
+{
+    uint8_t hdr[20] = { 0x45, 0, (uint8_t)(len >> 8), (uint8_t)len, 0x12, 0x34, (uint8_t)(frag >> 8),
+                        (uint8_t)frag, 64, 6, 0, 0, 10, 0, 0, 1, 10, 0, 0, 2 };
+    memcpy(ip, hdr, sizeof(hdr));
+}
+
+int test_chksum_offload()
+{
+    DEBUG_INFO("\n\n***\ttest_chksum_offload");
+    // A segment queued for an MTU of 2800 and sent after it was lowered to 1280
+    enum { TCP_LEN = 2020, MTU = 1280, FRAG = (MTU - 20) & ~7 };
+    assert(zts_tcp_fits_mtu(TCP_LEN, 0, 2800) && ! zts_tcp_fits_mtu(TCP_LEN, 0, MTU));
+    assert(zts_tcp_fits_mtu(MTU - 20, 0, MTU) && ! zts_tcp_fits_mtu(MTU - 19, 0, MTU));
+    assert(zts_tcp_fits_mtu(MTU - 40, 1, MTU) && ! zts_tcp_fits_mtu(MTU - 39, 1, MTU));
+    assert(zts_tcp_fits_mtu(TCP_LEN, 1, 0));
+
+    uint8_t pkt[20 + TCP_LEN];
+    ip4_header(pkt, sizeof(pkt), 0);
+    uint8_t* tcp = pkt + 20;
+    for (int i = 0; i < TCP_LEN; i++) {
+        tcp[i] = (uint8_t)random32();
+    }
+    tcp[12] = 5 << 4;   // No options
+    tcp[13] = 0x10;     // ACK
+    tcp[16] = tcp[17] = 0;
+    // Filled in by the tap for a peer without offload if sent whole
+    int tcp_len = 0;
+    assert(zts_tcp_fill_offset(pkt, sizeof(pkt), sizeof(pkt), 0x800, &tcp_len) == 20 && tcp_len == TCP_LEN);
+    assert(zts_tcp_fill_offset(pkt, sizeof(pkt), 39, 0x800, &tcp_len) == -1);
+
+    // Too large for the MTU, so lwIP generates the checksum, which the tap keeps
+    uint16_t chksum = (uint16_t)~tcp4_sum(tcp, TCP_LEN, pkt);
+    memcpy(tcp + 16, &chksum, sizeof(chksum));
+    assert(zts_tcp_fill_offset(pkt, sizeof(pkt), sizeof(pkt), 0x800, &tcp_len) == -1);
+
+    // The fragments are sent as they are, and the reassembled segment checks
+    uint8_t frag1[20 + FRAG], frag2[20 + TCP_LEN - FRAG], seg[TCP_LEN];
+    ip4_header(frag1, sizeof(frag1), 0x2000);
+    memcpy(frag1 + 20, tcp, FRAG);
+    ip4_header(frag2, sizeof(frag2), FRAG / 8);
+    memcpy(frag2 + 20, tcp + FRAG, TCP_LEN - FRAG);
+    assert(sizeof(frag1) <= MTU && sizeof(frag2) <= MTU);
+    assert(zts_tcp_fill_offset(frag1, sizeof(frag1), sizeof(frag1), 0x800, &tcp_len) == -1);
+    assert(zts_tcp_fill_offset(frag2, sizeof(frag2), sizeof(frag2), 0x800, &tcp_len) == -1);
+    memcpy(seg, frag1 + 20, FRAG);
+    memcpy(seg + FRAG, frag2 + 20, TCP_LEN - FRAG);
+    assert(tcp4_sum(seg, TCP_LEN, frag1) == 0xffff);
+
+    // IPv6: whole segments are filled in, fragments (extension header) aren't
+    uint8_t pkt6[40 + 8 + 40] = { 0x60 };
+    pkt6[5] = 40;
+    pkt6[6] = 6;
+    pkt6[40 + 12] = 5 << 4;
+    assert(zts_tcp_fill_offset(pkt6, 80, 80, 0x86DD, &tcp_len) == 40 && tcp_len == 40);
+    pkt6[5] = 48;
+    pkt6[6] = 44;
+    assert(zts_tcp_fill_offset(pkt6, 88, 88, 0x86DD, &tcp_len) == -1);
+    return 0;
+}
+
+
+#ifndef ZTS_DISABLE_CENTRAL_API
+
+//----------------------------------------------------------------------------//
+// Central API (against a local stand-in server)                              //
+//----------------------------------------------------------------------------//
+
+#define STUB_BUF_LEN    4096
+#define STUB_DEAD_NODE  0xdeadULL
+#define BATCH_COUNT     64
+#define BATCH_PARALLEL  8
+#define BULK_COUNT      16
+
+// Minimal HTTP/1.1 server with keep-alive. Each connection gets a thread.
+struct central_stub {
+    int fd;
+    pthread_t thread;
+    pthread_mutex_t m;
+    int conns;
+    int inflight;
+    int max_inflight;
+    int members_full;
+    int members_not_modified;
+    int posts;
+    int members_version;
+} stub;
+
+void* central_stub_conn(void* arg)
+{
+    int fd = (int)(intptr_t)arg;
+    char buf[STUB_BUF_LEN + 1], out[STUB_BUF_LEN];
+    int len = 0;
+    for (;;) {
+        // Request line and headers
+        char* end;
+        buf[len] = 0;
+        while (! (end = strstr(buf, "\r\n\r\n"))) {
+            int n = recv(fd, buf + len, STUB_BUF_LEN - len, 0);
+            if (n <= 0) {
+                close(fd);
+                return NULL;
+            }
+            len += n;
+            buf[len] = 0;
+        }
+        *end = 0;
+        char method[8] = { 0 }, path[256] = { 0 }, etag[32] = { 0 };
+        sscanf(buf, "%7s %255s", method, path);
+        char* h = strstr(buf, "\r\nContent-Length:");
+        int body_len = h ? atoi(h + 17) : 0;
+        if ((h = strstr(buf, "\r\nIf-None-Match:"))) {
+            sscanf(h + 16, " %31s", etag);
+        }
+        // Body
+        int used = (end + 4 - buf) + body_len;
+        while (len < used) {
+            int n = recv(fd, buf + len, STUB_BUF_LEN - len, 0);
+            if (n <= 0) {
+                close(fd);
+                return NULL;
+            }
+            len += n;
+        }
+
+        pthread_mutex_lock(&stub.m);
+        if (++stub.inflight > stub.max_inflight) {
+            stub.max_inflight = stub.inflight;
+        }
+        char current[32];
+        snprintf(current, sizeof(current), "\"v%d\"", stub.members_version);
+        int code = 200, is_members = ! strcmp(method, "GET") && strstr(path, "/member") == path + strlen(path) - 7;
+        char body[512];
+        snprintf(body, sizeof(body), "{\"method\":\"%s\",\"path\":\"%s\"}", method, path);
+        if (is_members) {
+            if (! strcmp(etag, current)) {
+                code = 304;
+                body[0] = 0;
+                stub.members_not_modified++;
+            }
+            else {
+                snprintf(body, sizeof(body), "{\"members\":%d}", stub.members_version);
+                stub.members_full++;
+            }
+        }
+        if (! strcmp(method, "POST")) {
+            stub.posts++;
+            char dead[32];
+            snprintf(dead, sizeof(dead), "/member/%llx", STUB_DEAD_NODE);
+            if (strstr(path, dead)) {
+                code = 403;
+            }
+        }
+        pthread_mutex_unlock(&stub.m);
+
+        // Give concurrent requests a chance to overlap
+        zts_util_delay(2);
+        int n = snprintf(
+            out,
+            sizeof(out),
+            "HTTP/1.1 %d X\r\n%s%s%sContent-Length: %d\r\n\r\n%s",
+            code,
+            is_members ? "ETag: " : "",
+            is_members ? current : "",
+            is_members ? "\r\n" : "",
+            (int)strlen(body),
+            body);
+        pthread_mutex_lock(&stub.m);
+        stub.inflight--;
+        pthread_mutex_unlock(&stub.m);
+        if (send(fd, out, n, 0) != n) {
+            close(fd);
+            return NULL;
+        }
+        memmove(buf, buf + used, len - used);
+        len -= used;
+    }
+}
+
+void* central_stub_accept(void* arg)
+{
+    int fd;
+    while ((fd = accept(stub.fd, NULL, NULL)) >= 0) {
+        pthread_mutex_lock(&stub.m);
+        stub.conns++;
+        pthread_mutex_unlock(&stub.m);
+        pthread_t thread;
+        pthread_create(&thread, NULL, central_stub_conn, (void*)(intptr_t)fd);
+        pthread_detach(thread);
+    }
+    return NULL;
+}
+
+int central_stub_start()
+{
+    memset(&stub, 0, sizeof(stub));
+    pthread_mutex_init(&stub.m, NULL);
+    stub.members_version = 1;
+    struct sockaddr_in in4 = { 0 };
+    socklen_t in4_len = sizeof(in4);
+    in4.sin_family = AF_INET;
+    in4.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    stub.fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(bind(stub.fd, (struct sockaddr*)&in4, sizeof(in4)) == 0);
+    assert(listen(stub.fd, 64) == 0);
+    assert(getsockname(stub.fd, (struct sockaddr*)&in4, &in4_len) == 0);
+    pthread_create(&stub.thread, NULL, central_stub_accept, NULL);
+    return ntohs(in4.sin_port);
+}
+
+void central_stub_stop()
+{
+    shutdown(stub.fd, SHUT_RDWR);
+    pthread_join(stub.thread, NULL);
+    close(stub.fd);
+}
+
+int test_central()
+{
+    DEBUG_INFO("\n\n***\ttest_central");
+    char url[ZTS_CENTRAL_MAX_URL_LEN];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d", central_stub_start());
+    static char resp_buf[STUB_BUF_LEN];
+    int code = 0;
+    assert(zts_central_init(url, "0123456789abcdef0123456789abcdef", resp_buf, sizeof(resp_buf)) == ZTS_ERR_OK);
+
+    // Sequential requests reuse one connection
+
+    for (int i = 0; i < 50; i++) {
+        assert(zts_central_status_get(&code) == ZTS_ERR_OK && code == 200);
+    }
+    assert(strstr(resp_buf, "\"path\":\"/api/status\""));
+    assert(stub.conns == 1);
+
+    // Concurrent requests, each with its own response buffer
+
+    static zts_central_req_t reqs[BATCH_COUNT];
+    static char routes[BATCH_COUNT][32], bufs[BATCH_COUNT][128];
+    memset(reqs, 0, sizeof(reqs));
+    for (int i = 0; i < BATCH_COUNT; i++) {
+        snprintf(routes[i], sizeof(routes[i]), "/api/network/%d", i);
+        reqs[i].method = i % 2 ? ZTS_HTTP_POST : ZTS_HTTP_GET;
+        reqs[i].route = routes[i];
+        reqs[i].post_data = "{}";
+        reqs[i].resp_buf = bufs[i];
+        reqs[i].resp_buf_len = sizeof(bufs[i]);
+    }
+    reqs[3].route = NULL;
+    zts_central_set_access_mode(ZTS_CENTRAL_READ | ZTS_CENTRAL_WRITE);
+    assert(zts_central_req_batch(reqs, BATCH_COUNT, BATCH_PARALLEL) == ZTS_ERR_OK);
+    for (int i = 0; i < BATCH_COUNT; i++) {
+        if (i == 3) {
+            assert(reqs[i].err == ZTS_ERR_ARG && reqs[i].http_resp_code == 0);
+            continue;
+        }
+        char want[64];
+        snprintf(want, sizeof(want), "{\"method\":\"%s\",\"path\":\"%s\"}", i % 2 ? "POST" : "GET", routes[i]);
+        assert(reqs[i].err == ZTS_ERR_OK && reqs[i].http_resp_code == 200);
+        assert(! strcmp(bufs[i], want) && reqs[i].resp_len == strlen(want));
+    }
+    assert(stub.max_inflight > 1 && stub.max_inflight <= BATCH_PARALLEL);
+    assert(stub.conns <= 1 + BATCH_PARALLEL);
+    // The single request buffer is left alone
+    assert(strstr(resp_buf, "\"path\":\"/api/status\""));
+
+    // Member lists are only downloaded again once they change
+
+    for (int i = 0; i < 3; i++) {
+        assert(zts_central_net_get_members(&code, 0xabc) == ZTS_ERR_OK && code == 200);
+        assert(! strcmp(resp_buf, "{\"members\":1}"));
+    }
+    assert(stub.members_full == 1 && stub.members_not_modified == 2);
+    pthread_mutex_lock(&stub.m);
+    stub.members_version++;
+    pthread_mutex_unlock(&stub.m);
+    assert(zts_central_net_get_members(&code, 0xabc) == ZTS_ERR_OK && code == 200);
+    assert(! strcmp(resp_buf, "{\"members\":2}"));
+    assert(stub.members_full == 2 && stub.members_not_modified == 2);
+
+    // Bulk operations report per item
+
+    zts_central_member_op_t ops[BULK_COUNT];
+    memset(ops, 0, sizeof(ops));
+    for (int i = 0; i < BULK_COUNT; i++) {
+        ops[i].net_id = 0x8056c2e21c000001ULL;
+        ops[i].node_id = 0x1000 + i;
+    }
+    ops[4].node_id = STUB_DEAD_NODE;
+    ops[5].node_id = 0;
+    zts_central_set_access_mode(ZTS_CENTRAL_READ);
+    assert(zts_central_node_auth_bulk(ops, BULK_COUNT, 1, 4) == ZTS_ERR_OK);
+    for (int i = 0; i < BULK_COUNT; i++) {
+        assert(ops[i].err == (i == 5 ? ZTS_ERR_ARG : ZTS_ERR_SERVICE));
+    }
+    int posts = stub.posts;
+    zts_central_set_access_mode(ZTS_CENTRAL_READ | ZTS_CENTRAL_WRITE);
+    assert(zts_central_node_auth_bulk(ops, BULK_COUNT, 1, 4) == ZTS_ERR_OK);
+    for (int i = 0; i < BULK_COUNT; i++) {
+        if (i == 5) {
+            assert(ops[i].err == ZTS_ERR_ARG && ops[i].http_resp_code == 0);
+            continue;
+        }
+        assert(ops[i].err == ZTS_ERR_OK && ops[i].http_resp_code == (i == 4 ? 403 : 200));
+    }
+    assert(stub.posts == posts + BULK_COUNT - 1);
+
+    zts_central_cleanup();
+    assert(zts_central_status_get(&code) == ZTS_ERR_SERVICE);
+    central_stub_stop();
+    return 0;
+}
+
+#endif   // ZTS_DISABLE_CENTRAL_API
+
 //----------------------------------------------------------------------------//
 // Main                                                                       //
 //----------------------------------------------------------------------------//
@@ -1886,6 +2630,9 @@ int main(int argc, char** argv)
         srand(time(NULL));
         DEBUG_INFO("Single node test");
         test_utils();
+        test_chksum();
+        test_dns_parse();
+        test_chksum_offload();
         test_pre_service_fuzz();
         test_thread_safety();
         test_identity_key_handling();
@@ -1894,6 +2641,9 @@ int main(int argc, char** argv)
         test_start_sequences();
         test_api_abuse();
         test_stats();
+#ifndef ZTS_DISABLE_CENTRAL_API
+        test_central();
+#endif
         // test_sockets();
     }
 